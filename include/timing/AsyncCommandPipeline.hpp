@@ -0,0 +1,129 @@
+/**
+ * @file AsyncCommandPipeline.hpp
+ *
+ * AsyncCommandPipeline queues variable length (async) endpoint
+ * commands for a master and returns their replies through futures.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TIMING_INCLUDE_TIMING_ASYNCCOMMANDPIPELINE_HPP_
+#define TIMING_INCLUDE_TIMING_ASYNCCOMMANDPIPELINE_HPP_
+
+#include "timing/EndpointCommandBuilder.hpp"
+#include "timing/MasterNode.hpp"
+
+// C++ Headers
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dunedaq {
+namespace timing {
+
+/**
+ * @brief      Reply and latency of one submitted command set.
+ */
+struct AsyncCommandResult
+{
+  uint16_t endpoint_address; // NOLINT(build/unsigned)
+  /// Sequence numbers of the packets sent for the command set
+  std::vector<uint8_t> sequences; // NOLINT(build/unsigned)
+  /// Read data for each transaction, empty for writes
+  std::vector<std::vector<uint32_t>> data; // NOLINT(build/unsigned)
+  /// Time between submission and the first packet write
+  std::chrono::microseconds queue_time;
+  /// Time between the first packet write and the last reply
+  std::chrono::microseconds service_time;
+};
+
+/**
+ * @brief      Running latency statistics of a pipeline.
+ */
+struct AsyncCommandLatencyStats
+{
+  uint64_t completed = 0;     // NOLINT(build/unsigned)
+  uint64_t failed = 0;        // NOLINT(build/unsigned)
+  double mean_queue_us = 0.;
+  double mean_service_us = 0.;
+  int64_t max_queue_us = 0;
+  int64_t min_service_us = 0;
+  int64_t max_service_us = 0;
+};
+
+/**
+ * @brief      Worker thread serialising endpoint commands through the master async buffer.
+ *
+ * Commands for any number of endpoints can be submitted without blocking.
+ * Each packet gets a rolling sequence number and its reply is checked
+ * against it. The master has a single async buffer, so packets are sent
+ * one after the other. The caller does not have to wait for each one,
+ * and it can keep preparing and submitting work while earlier commands
+ * are in flight. Direct calls to the master's async methods must not be
+ * interleaved with an active pipeline.
+ */
+class AsyncCommandPipeline
+{
+public:
+  explicit AsyncCommandPipeline(const MasterNode& master, int reply_timeout = 500);
+  ~AsyncCommandPipeline();
+
+  AsyncCommandPipeline(const AsyncCommandPipeline&) = delete;
+  AsyncCommandPipeline& operator=(const AsyncCommandPipeline&) = delete;
+
+  /**
+   * @brief      Queue the transactions of a command builder.
+   *
+   * @return     Future for the reply; it holds the exception if the transfer failed
+   */
+  std::future<AsyncCommandResult> submit(const EndpointCommandBuilder& commands, bool wait_for_reply = true);
+
+  /**
+   * @brief      Block until every submitted command has completed.
+   */
+  void flush();
+
+  /**
+   * @brief      Number of submitted command sets not yet completed.
+   */
+  size_t get_number_of_outstanding() const;
+
+  AsyncCommandLatencyStats get_latency_stats() const;
+
+private:
+  struct Request
+  {
+    EndpointCommandBuilder commands;
+    bool wait_for_reply;
+    std::chrono::steady_clock::time_point submitted;
+    std::promise<AsyncCommandResult> promise;
+  };
+
+  void run();
+  AsyncCommandResult execute(Request& request) const;
+
+  const MasterNode& m_master;
+  int m_reply_timeout;
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_request_cv;
+  std::condition_variable m_idle_cv;
+  std::deque<Request> m_requests;
+  size_t m_outstanding;
+  bool m_stop;
+  AsyncCommandLatencyStats m_stats;
+
+  std::thread m_worker;
+};
+
+} // namespace timing
+} // namespace dunedaq
+
+#endif // TIMING_INCLUDE_TIMING_ASYNCCOMMANDPIPELINE_HPP_
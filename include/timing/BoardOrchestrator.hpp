@@ -0,0 +1,118 @@
+/**
+ * @file BoardOrchestrator.hpp
+ *
+ * BoardOrchestrator runs reset, configure and status operations on many
+ * timing boards in parallel, in dependency order.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TIMING_INCLUDE_TIMING_BOARDORCHESTRATOR_HPP_
+#define TIMING_INCLUDE_TIMING_BOARDORCHESTRATOR_HPP_
+
+#include "timing/TopDesignInterface.hpp"
+#include "timing/definitions.hpp"
+
+#include "timing/timingfirmwareinfo/Nljs.hpp"
+#include "timing/timingfirmwareinfo/Structs.hpp"
+
+// C++ Headers
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace timing {
+
+enum BoardRole
+{
+  kMasterBoard = 0,  ///< drives the timing links
+  kFanoutBoard = 1,  ///< recovers the master clock and repeats it
+  kEndpointBoard = 2 ///< recovers the clock of a master or fanout
+};
+
+/**
+ * @brief      Outcome of one operation on one board.
+ */
+struct BoardResult
+{
+  std::string name;
+  BoardRole role = kEndpointBoard;
+  bool success = false;
+  bool skipped = false;
+  std::string error;
+  int64_t start_us = 0; ///< since the start of the operation
+  int64_t duration_us = 0;
+  std::string status;                        ///< get_status only
+  timingfirmwareinfo::TimingDeviceInfo info; ///< get_info only
+};
+
+/**
+ * @brief      Outcome of one operation on all boards.
+ */
+struct OrchestrationResult
+{
+  std::vector<BoardResult> boards; ///< in the order the boards were added
+  bool success = false;
+  int64_t duration_us = 0;
+};
+
+/**
+ * @brief      Parallel operations on a set of boards.
+ *
+ * Operations which change the clock tree run in stages: every master,
+ * then every fanout, then every endpoint, since a board can only lock
+ * to a clock which is already there. Within a stage, boards run in
+ * parallel on up to number_of_threads threads, so a stage takes as long
+ * as its slowest board. By default, a failure in one stage skips the
+ * later ones. Read-only operations run on all boards at once.
+ *
+ * The designs must outlive the orchestrator, and no two boards may
+ * share an IPbus client.
+ */
+class BoardOrchestrator
+{
+public:
+  /**
+   * @param      number_of_threads  Maximum number of boards handled at once, 0 for one thread per board
+   */
+  explicit BoardOrchestrator(size_t number_of_threads = 0);
+
+  void add_board(const std::string& name, const TopDesignInterface& design, BoardRole role);
+
+  /**
+   * @brief      Whether a failed stage skips the later ones.
+   */
+  void set_stop_on_failure(bool stop_on_failure) { m_stop_on_failure = stop_on_failure; }
+
+  OrchestrationResult reset_io(const ClockSource& clock_source) const;
+  OrchestrationResult configure() const;
+  OrchestrationResult get_status() const;
+  OrchestrationResult get_info() const;
+
+  size_t get_number_of_boards() const { return m_boards.size(); }
+
+private:
+  struct Board
+  {
+    std::string name;
+    const TopDesignInterface* design;
+    BoardRole role;
+  };
+
+  using Action = std::function<void(const TopDesignInterface&, BoardResult&)>;
+
+  OrchestrationResult run(const Action& action, bool staged) const;
+
+  size_t m_number_of_threads;
+  bool m_stop_on_failure;
+  std::vector<Board> m_boards;
+};
+
+} // namespace timing
+} // namespace dunedaq
+
+#endif // TIMING_INCLUDE_TIMING_BOARDORCHESTRATOR_HPP_
@@ -68,6 +68,11 @@ public:
    */
   uint64_t read_last_pulse_timestamp() const; // NOLINT(build/unsigned)
 
+  /**
+   * @brief      Read the last pulse timestamp, bracketed by host clock reads.
+   */
+  TimestampSample sample_last_pulse_timestamp() const;
+
 private:
   void enable(uint32_t address = 0, uint32_t partition = 0) const override; // NOLINT(build/unsigned)
   void reset(uint32_t address = 0, uint32_t partition = 0) const override; // NOLINT(build/unsigned)
@@ -0,0 +1,91 @@
+/**
+ * @file CommandCounterSampler.hpp
+ *
+ * CommandCounterSampler reads the command counters of a master or
+ * endpoint and tracks their per-command deltas and rates.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TIMING_INCLUDE_TIMING_COMMANDCOUNTERSAMPLER_HPP_
+#define TIMING_INCLUDE_TIMING_COMMANDCOUNTERSAMPLER_HPP_
+
+#include "timing/TimingNode.hpp"
+
+#include "timing/timingendpointinfo/Nljs.hpp"
+#include "timing/timingendpointinfo/Structs.hpp"
+
+// C++ Headers
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace dunedaq {
+namespace timing {
+
+/**
+ * @brief      Incremental sampler of a cmd_ctrs block.
+ *
+ * All buffers are sized once, on construction, and the deltas and rates
+ * are integer. Only the counters which changed in the last interval are
+ * published.
+ */
+class CommandCounterSampler
+{
+public:
+  /**
+   * @param      node  Node with a cmd_ctrs block, e.g. a master or an endpoint
+   */
+  explicit CommandCounterSampler(const TimingNode& node);
+
+  /**
+   * @brief      Read the counters and update the deltas.
+   *
+   * @return     Number of counters which changed since the previous sample
+   */
+  size_t sample();
+
+  uint32_t get_counts(uint32_t command) const { return m_counts.at(command); } // NOLINT(build/unsigned)
+  uint32_t get_delta(uint32_t command) const { return m_deltas.at(command); }  // NOLINT(build/unsigned)
+
+  /**
+   * @brief      Rate of a command over the last interval in mHz.
+   */
+  uint64_t get_rate_mhz(uint32_t command) const; // NOLINT(build/unsigned)
+
+  /**
+   * @brief      Commands whose counter changed in the last interval.
+   */
+  const std::vector<uint32_t>& get_changed() const { return m_changed; } // NOLINT(build/unsigned)
+
+  uint64_t get_interval_us() const { return m_interval_us; } // NOLINT(build/unsigned)
+
+  /**
+   * @brief      Sum of the deltas of all counters over the last interval.
+   */
+  uint64_t get_total_delta() const; // NOLINT(build/unsigned)
+
+  /**
+   * @brief      Fill the monitoring structure with the changed counters.
+   */
+  void get_info(timingendpointinfo::CommandCountersMonitorData& mon_data) const;
+
+private:
+  const TimingNode& m_node;
+  size_t m_number_of_counters;
+
+  std::vector<uint32_t> m_counts;  // NOLINT(build/unsigned)
+  std::vector<uint32_t> m_deltas;  // NOLINT(build/unsigned)
+  std::vector<uint32_t> m_changed; // NOLINT(build/unsigned)
+
+  bool m_primed;
+  std::chrono::steady_clock::time_point m_last_sample;
+  uint64_t m_interval_us; // NOLINT(build/unsigned)
+};
+
+} // namespace timing
+} // namespace dunedaq
+
+#endif // TIMING_INCLUDE_TIMING_COMMANDCOUNTERSAMPLER_HPP_
@@ -0,0 +1,106 @@
+/**
+ * @file CommandLogReader.hpp
+ *
+ * CommandLogReader polls the master command log and keeps a history
+ * of the captured commands.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TIMING_INCLUDE_TIMING_COMMANDLOGREADER_HPP_
+#define TIMING_INCLUDE_TIMING_COMMANDLOGREADER_HPP_
+
+#include "timing/MasterNode.hpp"
+
+#include "timing/timingfirmwareinfo/Nljs.hpp"
+#include "timing/timingfirmwareinfo/Structs.hpp"
+
+// C++ Headers
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace dunedaq {
+namespace timing {
+
+/**
+ * @brief      Host side history ring of the master command log.
+ *
+ * The firmware log only holds the most recent command. Each poll reads
+ * optionally the sent command counters, then the log, in one dispatch.
+ * A caller which already samples the counters, e.g. with a
+ * CommandCounterSampler, builds the reader without them and passes the
+ * number of commands sent to poll(sent) instead, after its counter read.
+ * A new log timestamp is a new entry; when the commands sent are known,
+ * those which were sent between two polls and overwritten in the log
+ * are counted as missed against the entry which follows them.
+ */
+class CommandLogReader
+{
+public:
+  explicit CommandLogReader(const MasterNode& master, size_t capacity = 1024, bool read_counters = true);
+
+  /**
+   * @brief      Read the command log once.
+   *
+   * @return     Number of new entries
+   */
+  size_t poll();
+
+  /**
+   * @brief      Read the command log once, given the commands sent since the previous poll.
+   *
+   * The counters giving sent must have been read before this call.
+   *
+   * @return     Number of new entries
+   */
+  size_t poll(uint64_t sent); // NOLINT(build/unsigned)
+
+  /**
+   * @brief      Entries in the history, oldest first.
+   */
+  timingfirmwareinfo::CommandLogEntryVector get_history() const;
+
+  /**
+   * @brief      Drop the history and the totals. The next poll starts a new baseline.
+   */
+  void clear();
+
+  /**
+   * @brief      Fill the command log monitoring structure with up to max_entries recent entries.
+   */
+  void get_info(timingfirmwareinfo::CommandLogHistory& mon_data, size_t max_entries = 64) const;
+
+  uint64_t get_number_of_missed() const; // NOLINT(build/unsigned)
+
+private:
+  size_t update(uint64_t timestamp, uint32_t command, bool counted, uint64_t sent); // NOLINT(build/unsigned)
+  void push(const timingfirmwareinfo::CommandLogEntry& entry);
+
+  const MasterNode& m_master;
+  bool m_read_counters;
+
+  mutable std::mutex m_mutex;
+  std::vector<timingfirmwareinfo::CommandLogEntry> m_ring;
+  size_t m_next;
+  size_t m_size;
+
+  bool m_primed;
+  uint64_t m_last_timestamp;           // NOLINT(build/unsigned)
+  std::vector<uint32_t> m_last_counts; // NOLINT(build/unsigned)
+  /// commands counted but not yet matched to a log entry
+  uint64_t m_uncaptured; // NOLINT(build/unsigned)
+  /// the last entry was logged before its command was counted
+  bool m_logged_uncounted;
+
+  uint64_t m_polls;    // NOLINT(build/unsigned)
+  uint64_t m_captured; // NOLINT(build/unsigned)
+  uint64_t m_missed;   // NOLINT(build/unsigned)
+};
+
+} // namespace timing
+} // namespace dunedaq
+
+#endif // TIMING_INCLUDE_TIMING_COMMANDLOGREADER_HPP_
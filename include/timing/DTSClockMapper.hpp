@@ -0,0 +1,152 @@
+/**
+ * @file DTSClockMapper.hpp
+ *
+ * DTSClockMapper tracks the relation between the host clocks and a
+ * board timestamp, so that conversions can be answered without
+ * reading the hardware.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TIMING_INCLUDE_TIMING_DTSCLOCKMAPPER_HPP_
+#define TIMING_INCLUDE_TIMING_DTSCLOCKMAPPER_HPP_
+
+#include "timing/EndpointNode.hpp"
+#include "timing/IRIGTimestampNode.hpp"
+#include "timing/MasterNode.hpp"
+#include "timing/TimingIssues.hpp"
+
+#include "timing/timingfirmwareinfo/Nljs.hpp"
+#include "timing/timingfirmwareinfo/Structs.hpp"
+
+// C++ Headers
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace dunedaq {
+namespace timing {
+
+/**
+ * @brief      Linear model of the board timestamp against the host monotonic clock.
+ *
+ * timestamp = reference_timestamp + ticks_per_ns * (monotonic_ns - reference_monotonic_ns)
+ */
+struct DTSClockFit
+{
+  bool valid = false;
+  int64_t reference_monotonic_ns = 0;
+  uint64_t reference_timestamp = 0; // NOLINT(build/unsigned)
+  double ticks_per_ns = 0.;
+  /// realtime minus monotonic host clock at the last sample
+  int64_t realtime_offset_ns = 0;
+  /// rate of the board clock relative to its nominal frequency, in parts per million
+  double drift_ppm = 0.;
+  /// spread (1.4826 * MAD) of the fit residuals
+  double jitter_ns = 0.;
+  /// largest residual plus half the median sampling bracket
+  double error_ns = 0.;
+  uint32_t samples = 0; // NOLINT(build/unsigned)
+};
+
+/**
+ * @brief      Host to DTS clock mapping with drift tracking.
+ *
+ * The board timestamp is sampled between two reads of each host clock,
+ * on demand or from a background thread, and a Theil-Sen fit over the
+ * last samples gives offset and rate. Samples with an unusually wide
+ * bracket are left out of the fit. The fit is published through a
+ * sequence lock, so any number of threads can convert times without
+ * taking a lock or touching the hardware.
+ */
+class DTSClockMapper
+{
+public:
+  DTSClockMapper(const MasterNode& master,
+                 uint32_t clock_frequency_hz, // NOLINT(build/unsigned)
+                 size_t window = 64);
+  DTSClockMapper(const EndpointNode& endpoint,
+                 uint32_t clock_frequency_hz, // NOLINT(build/unsigned)
+                 size_t window = 64);
+  DTSClockMapper(const IRIGTimestampNode& irig,
+                 uint32_t clock_frequency_hz, // NOLINT(build/unsigned)
+                 size_t window = 64);
+  ~DTSClockMapper();
+
+  DTSClockMapper(const DTSClockMapper&) = delete;
+  DTSClockMapper& operator=(const DTSClockMapper&) = delete;
+
+  /**
+   * @brief      Take one sample and refit.
+   */
+  TimestampSample sample();
+
+  /**
+   * @brief      Sample periodically from a background thread.
+   */
+  void start(std::chrono::milliseconds period);
+  void stop();
+
+  /**
+   * @brief      Current fit; lock free.
+   */
+  DTSClockFit get_fit() const;
+
+  /**
+   * @brief      Conversions; throw ClockMappingNotReady until two samples have been fitted.
+   */
+  uint64_t get_timestamp_at_monotonic(int64_t monotonic_ns) const; // NOLINT(build/unsigned)
+  uint64_t get_timestamp_at_realtime(int64_t realtime_ns) const;   // NOLINT(build/unsigned)
+  int64_t get_monotonic_at_timestamp(uint64_t timestamp) const;    // NOLINT(build/unsigned)
+  int64_t get_realtime_at_timestamp(uint64_t timestamp) const;     // NOLINT(build/unsigned)
+
+  /**
+   * @brief      Board timestamp now, from the fit.
+   */
+  uint64_t get_timestamp_now() const; // NOLINT(build/unsigned)
+
+  void get_info(timingfirmwareinfo::DTSClockMapperMonitorData& mon_data) const;
+
+private:
+  DTSClockMapper(std::function<TimestampSample()> reader,
+                 uint32_t clock_frequency_hz, // NOLINT(build/unsigned)
+                 size_t window);
+
+  void fit();
+  void publish(const DTSClockFit& fit);
+  DTSClockFit get_valid_fit() const;
+  void run(std::chrono::milliseconds period);
+
+  std::function<TimestampSample()> m_reader;
+  uint32_t m_clock_frequency_hz; // NOLINT(build/unsigned)
+  size_t m_window;
+
+  // guards the sample window and the counters; never held by readers of the fit
+  mutable std::mutex m_sample_mutex;
+  std::deque<TimestampSample> m_samples;
+  uint64_t m_number_of_samples;  // NOLINT(build/unsigned)
+  uint64_t m_number_of_failures; // NOLINT(build/unsigned)
+  int64_t m_last_bracket_ns;
+
+  static constexpr size_t fit_words = (sizeof(DTSClockFit) + sizeof(uint64_t) - 1) / sizeof(uint64_t); // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_fit_sequence;                     // NOLINT(build/unsigned)
+  std::array<std::atomic<uint64_t>, fit_words> m_fit_words; // NOLINT(build/unsigned)
+
+  std::mutex m_run_mutex;
+  std::condition_variable m_run_cv;
+  bool m_stop;
+  std::thread m_worker;
+};
+
+} // namespace timing
+} // namespace dunedaq
+
+#endif // TIMING_INCLUDE_TIMING_DTSCLOCKMAPPER_HPP_
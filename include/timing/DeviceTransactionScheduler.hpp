@@ -0,0 +1,180 @@
+/**
+ * @file DeviceTransactionScheduler.hpp
+ *
+ * DeviceTransactionScheduler serialises the logical operations run on
+ * one device by concurrent threads, giving control operations priority
+ * over monitoring.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TIMING_INCLUDE_TIMING_DEVICETRANSACTIONSCHEDULER_HPP_
+#define TIMING_INCLUDE_TIMING_DEVICETRANSACTIONSCHEDULER_HPP_
+
+#include "timing/timingfirmwareinfo/Nljs.hpp"
+#include "timing/timingfirmwareinfo/Structs.hpp"
+
+#include "uhal/uhal.hpp"
+
+// C++ Headers
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace dunedaq {
+namespace timing {
+
+enum TransactionPriority
+{
+  kControlTransaction = 0,   ///< time critical: fast commands, timestamp loading, async packets
+  kMonitoringTransaction = 1 ///< get_info and other periodic reads
+};
+
+/**
+ * @brief      Queueing statistics of one priority class.
+ */
+struct TransactionQueueStats
+{
+  uint64_t transactions = 0;  // NOLINT(build/unsigned)
+  uint64_t total_wait_ns = 0; // NOLINT(build/unsigned)
+  uint64_t max_wait_ns = 0;   // NOLINT(build/unsigned)
+};
+
+/**
+ * @brief      Priority lock of one device.
+ *
+ * One transaction runs at a time. When the device is released, waiting
+ * control transactions go before waiting monitoring ones. Monitoring
+ * transactions reach yield points during long sequences, e.g. between
+ * I2C bytes, where they give the device to waiting control transactions
+ * and queue again.
+ *
+ * A control transaction let in at a yield point finds the I2C master
+ * of the yielding transaction in the middle of a transfer, and must not
+ * use it. The control operations of this package do not, except through
+ * a DeviceMuxLock.
+ *
+ * The I2C mux selection of the device has one owner at a time. A holder
+ * which needs the mux while a yielded transaction owns it gives the
+ * device back until the owner is done with the mux.
+ */
+class DeviceTransactionScheduler
+{
+public:
+  DeviceTransactionScheduler();
+
+  DeviceTransactionScheduler(const DeviceTransactionScheduler&) = delete;
+  DeviceTransactionScheduler& operator=(const DeviceTransactionScheduler&) = delete;
+
+  /**
+   * @brief      Scheduler of the device behind an IPbus client.
+   */
+  static DeviceTransactionScheduler& get(const uhal::ClientInterface& client);
+
+  void acquire(TransactionPriority priority);
+  void release();
+
+  /**
+   * @brief      Let waiting control transactions run, then take the device back.
+   *
+   * Called by the holder of a monitoring transaction.
+   */
+  void yield();
+
+  /**
+   * @brief      Take the I2C mux selection, reentrant per thread.
+   *
+   * Called by the holder of the device, with the priority of its
+   * transaction.
+   */
+  void acquire_mux(TransactionPriority priority);
+  void release_mux();
+
+  bool has_waiting_control() const { return m_waiting_control.load(std::memory_order_relaxed); }
+
+  TransactionQueueStats get_stats(TransactionPriority priority) const;
+  uint64_t get_number_of_yields() const; // NOLINT(build/unsigned)
+
+  void get_info(timingfirmwareinfo::DeviceTransactionSchedulerMonitorData& mon_data) const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  void wait_for_device(std::unique_lock<std::mutex>& lock, TransactionPriority priority);
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_cv;
+  bool m_busy;
+  std::array<uint32_t, 2> m_waiting;       // NOLINT(build/unsigned)
+  std::atomic<uint32_t> m_waiting_control; // NOLINT(build/unsigned)
+  std::thread::id m_mux_owner;
+  uint32_t m_mux_depth; // NOLINT(build/unsigned)
+
+  std::array<TransactionQueueStats, 2> m_stats;
+  uint64_t m_yields; // NOLINT(build/unsigned)
+};
+
+/**
+ * @brief      Holds a device for the enclosing scope.
+ *
+ * Transactions are reentrant: a transaction on a device already held by
+ * the calling thread does not queue again. A control transaction nested
+ * in a monitoring one suspends its yield points.
+ */
+class DeviceTransaction
+{
+public:
+  DeviceTransaction(const uhal::ClientInterface& client, TransactionPriority priority);
+  DeviceTransaction(DeviceTransactionScheduler& scheduler, TransactionPriority priority);
+  ~DeviceTransaction();
+
+  DeviceTransaction(const DeviceTransaction&) = delete;
+  DeviceTransaction& operator=(const DeviceTransaction&) = delete;
+
+  /**
+   * @brief      Yield the monitoring transactions held by this thread to waiting control ones.
+   *
+   * Does nothing outside a monitoring transaction, so it can be called
+   * from any long sequence.
+   */
+  static void yield_point();
+
+private:
+  DeviceTransactionScheduler* m_scheduler;
+  TransactionPriority m_priority;
+  DeviceTransaction* m_parent;
+  DeviceTransaction* m_promoted;
+};
+
+/**
+ * @brief      Holds a device and its I2C mux selection for the enclosing scope.
+ *
+ * Used around every sequence which selects a mux channel and then talks
+ * to the device behind it. Monitoring reads keep their yield points; a
+ * control operation let in at one waits for the read before it switches
+ * the mux.
+ */
+class DeviceMuxLock
+{
+public:
+  DeviceMuxLock(const uhal::ClientInterface& client, TransactionPriority priority);
+  ~DeviceMuxLock();
+
+  DeviceMuxLock(const DeviceMuxLock&) = delete;
+  DeviceMuxLock& operator=(const DeviceMuxLock&) = delete;
+
+private:
+  DeviceTransaction m_transaction;
+  DeviceTransactionScheduler& m_scheduler;
+};
+
+} // namespace timing
+} // namespace dunedaq
+
+#endif // TIMING_INCLUDE_TIMING_DEVICETRANSACTIONSCHEDULER_HPP_
@@ -18,11 +18,30 @@
 // uHal Headers
 #include "uhal/DerivedNode.hpp"
 
+#include <map>
 #include <string>
+#include <vector>
 
 namespace dunedaq {
 namespace timing {
 
+/**
+ * @brief      Statistics of a series of round-trip time measurements.
+ */
+struct EchoDelayStatistics
+{
+  std::vector<uint32_t> samples; // NOLINT(build/unsigned)
+  uint32_t min = 0;              // NOLINT(build/unsigned)
+  uint32_t median = 0;           // NOLINT(build/unsigned)
+  uint32_t max = 0;              // NOLINT(build/unsigned)
+  double mean = 0.;
+  double stddev = 0.;
+  /// number of samples for each measured value
+  std::map<uint32_t, uint32_t> histogram; // NOLINT(build/unsigned)
+  /// spread of the samples larger than the allowed one
+  bool unstable = false;
+};
+
 /**
  * @brief      Class for master global node.
  */
@@ -40,6 +59,21 @@ public:
    */
   virtual uint64_t send_echo_and_measure_delay(int64_t timeout = 500) const; // NOLINT(build/unsigned)
 
+  /**
+   * @brief      Send a series of echoes back to back and collect round-trip time statistics.
+   *
+   * Each go write is dispatched on its own before the status is polled,
+   * so that a poll can not return the done flag and delay of the
+   * previous echo.
+   *
+   * @param      number_of_samples  Number of echoes
+   * @param      max_spread         Largest max - min, in round-trip time units, for a stable link
+   * @param      timeout            Timeout per echo [ms]
+   */
+  EchoDelayStatistics measure_delay_statistics(uint32_t number_of_samples = 16, // NOLINT(build/unsigned)
+                                               uint32_t max_spread = 1,         // NOLINT(build/unsigned)
+                                               int64_t timeout = 500) const;
+
   /**
    * @brief     Get status string, optionally print.
    */
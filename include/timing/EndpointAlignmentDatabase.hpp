@@ -0,0 +1,79 @@
+/**
+ * @file EndpointAlignmentDatabase.hpp
+ *
+ * EndpointAlignmentDatabase is a file backed store of the last
+ * measured round trip time and applied delays of each endpoint.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TIMING_INCLUDE_TIMING_ENDPOINTALIGNMENTDATABASE_HPP_
+#define TIMING_INCLUDE_TIMING_ENDPOINTALIGNMENTDATABASE_HPP_
+
+#include "timing/TimingIssues.hpp"
+
+#include "timing/timingfirmware/Nljs.hpp"
+#include "timing/timingfirmware/Structs.hpp"
+
+// C++ Headers
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace dunedaq {
+namespace timing {
+
+/**
+ * @brief      Alignment records keyed by endpoint address, stored as json.
+ *
+ * The file is read on construction; a missing file gives an empty
+ * database. Records only reach the file on save().
+ */
+class EndpointAlignmentDatabase
+{
+public:
+  explicit EndpointAlignmentDatabase(const std::string& file_path);
+
+  /**
+   * @brief      Replace the records with the file contents.
+   */
+  void load();
+
+  /**
+   * @brief      Write the records to the file, replacing it atomically.
+   */
+  void save() const;
+
+  /**
+   * @brief      Record of an endpoint, nullptr if there is none.
+   */
+  const timingfirmware::EndpointAlignmentRecord* find(uint32_t address) const; // NOLINT(build/unsigned)
+
+  /**
+   * @brief      Add or replace the record of an endpoint.
+   */
+  void update(const timingfirmware::EndpointAlignmentRecord& record);
+
+  void remove(uint32_t address); // NOLINT(build/unsigned)
+
+  void clear() { m_records.clear(); }
+
+  size_t size() const { return m_records.size(); }
+
+  timingfirmware::EndpointAlignmentRecordVector get_records() const;
+
+  const std::string& get_file_path() const { return m_file_path; }
+
+  static constexpr uint32_t format_version = 1; // NOLINT(build/unsigned)
+
+private:
+  std::string m_file_path;
+  std::map<uint32_t, timingfirmware::EndpointAlignmentRecord> m_records; // NOLINT(build/unsigned)
+};
+
+} // namespace timing
+} // namespace dunedaq
+
+#endif // TIMING_INCLUDE_TIMING_ENDPOINTALIGNMENTDATABASE_HPP_
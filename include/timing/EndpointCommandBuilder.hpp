@@ -0,0 +1,112 @@
+/**
+ * @file EndpointCommandBuilder.hpp
+ *
+ * EndpointCommandBuilder accumulates register transactions for a single
+ * endpoint and packs them into variable length (async) command packets.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TIMING_INCLUDE_TIMING_ENDPOINTCOMMANDBUILDER_HPP_
+#define TIMING_INCLUDE_TIMING_ENDPOINTCOMMANDBUILDER_HPP_
+
+#include "timing/TimingIssues.hpp"
+
+// C++ Headers
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace timing {
+
+/**
+ * @brief      One variable length command packet, together with the
+ *             location of the read data in its reply.
+ */
+struct EndpointCommandPacket
+{
+  std::vector<uint32_t> words; // NOLINT(build/unsigned)
+  /// (transaction index, number of reply words) for each read segment, in reply order
+  std::vector<std::pair<size_t, uint32_t>> read_segments; // NOLINT(build/unsigned)
+};
+
+/**
+ * @brief      Builds the minimum number of async packets for a list of
+ *             register reads and writes on one endpoint.
+ *
+ * Packets are limited by the 0x20 word depth of the master tx and rx
+ * buffers; transactions which do not fit are split across packets.
+ * Replies are demultiplexed into one result per transaction (empty for
+ * writes).
+ */
+class EndpointCommandBuilder
+{
+public:
+  explicit EndpointCommandBuilder(uint16_t endpoint_address, bool address_mode = true); // NOLINT(build/unsigned)
+
+  /**
+   * @brief      Queue a register write. Writes contiguous with the previous
+   *             write are merged into it when the address mode auto-increments.
+   *
+   * @return     Index of the transaction the write belongs to
+   */
+  size_t add_write(uint8_t reg_address, const std::vector<uint8_t>& data); // NOLINT(build/unsigned)
+
+  /**
+   * @brief      Queue a register read of data_length words.
+   *
+   * @return     Index of the transaction
+   */
+  size_t add_read(uint8_t reg_address, uint8_t data_length); // NOLINT(build/unsigned)
+
+  /**
+   * @brief      Pack the queued transactions into packets.
+   */
+  std::vector<EndpointCommandPacket> build_packets(uint8_t sequence = 0xab) const; // NOLINT(build/unsigned)
+
+  /**
+   * @brief      Copy the read data of one packet reply into the per-transaction results.
+   */
+  void parse_reply(const EndpointCommandPacket& packet,
+                   const std::vector<uint32_t>& reply,                 // NOLINT(build/unsigned)
+                   std::vector<std::vector<uint32_t>>& results) const; // NOLINT(build/unsigned)
+
+  size_t get_number_of_transactions() const { return m_transactions.size(); }
+
+  bool has_reads() const;
+
+  uint16_t get_endpoint_address() const { return m_endpoint_address; } // NOLINT(build/unsigned)
+
+  void clear() { m_transactions.clear(); }
+
+  /// Depth of the master async tx/rx buffers
+  static constexpr uint32_t max_packet_words = 0x20;          // NOLINT(build/unsigned)
+  /// Maximum length of a single transaction
+  static constexpr uint32_t max_transaction_length = 0x3f;    // NOLINT(build/unsigned)
+  /// Packet and reply header: two address words and the sequence
+  static constexpr uint32_t packet_header_words = 0x3;        // NOLINT(build/unsigned)
+
+private:
+  struct Transaction
+  {
+    bool write;
+    uint8_t reg_address;       // NOLINT(build/unsigned)
+    uint8_t length;            // NOLINT(build/unsigned)
+    std::vector<uint8_t> data; // NOLINT(build/unsigned)
+  };
+
+  void validate_length(uint8_t reg_address, size_t length) const; // NOLINT(build/unsigned)
+
+  uint16_t m_endpoint_address; // NOLINT(build/unsigned)
+  bool m_address_mode;
+  std::vector<Transaction> m_transactions;
+};
+
+} // namespace timing
+} // namespace dunedaq
+
+#endif // TIMING_INCLUDE_TIMING_ENDPOINTCOMMANDBUILDER_HPP_
@@ -0,0 +1,165 @@
+/**
+ * @file EndpointDelayAligner.hpp
+ *
+ * EndpointDelayAligner measures the round trip time of a set of
+ * endpoints and computes and applies the delays which equalise them.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TIMING_INCLUDE_TIMING_ENDPOINTDELAYALIGNER_HPP_
+#define TIMING_INCLUDE_TIMING_ENDPOINTDELAYALIGNER_HPP_
+
+#include "timing/EndpointAlignmentDatabase.hpp"
+#include "timing/MasterDesignInterface.hpp"
+#include "timing/MasterNode.hpp"
+#include "timing/SFPMuxDesignInterface.hpp"
+#include "timing/definitions.hpp"
+
+#include "timing/timingfirmware/Nljs.hpp"
+#include "timing/timingfirmware/Structs.hpp"
+
+// C++ Headers
+#include <cstdint>
+#include <vector>
+
+namespace dunedaq {
+namespace timing {
+
+/**
+ * @brief      How endpoint delays translate into round trip time.
+ *
+ * The two ratios depend on the firmware and have no default; the
+ * aligner refuses a model which leaves either at 0.
+ */
+struct EndpointDelayModel
+{
+  /// round trip time units added by one coarse delay step
+  uint32_t rtt_per_coarse_step = 0; // NOLINT(build/unsigned)
+  uint32_t max_coarse_delay = 0xf;  // NOLINT(build/unsigned)
+  /// fine delay steps per round trip time unit
+  uint32_t fine_steps_per_rtt = 0;  // NOLINT(build/unsigned)
+  uint32_t max_fine_delay = 0xfff;  // NOLINT(build/unsigned)
+};
+
+/**
+ * @brief      Aligns all endpoints of a master to the largest measured round trip time.
+ *
+ * Endpoints behind a fanout are reached by switching the fanout mux
+ * channel; on a master with its own sfp mux the endpoint mux is used.
+ * With an alignment database only endpoints whose path, link state or
+ * round trip time changed since the stored alignment are re-measured.
+ */
+class EndpointDelayAligner
+{
+public:
+  EndpointDelayAligner(const MasterDesignInterface& master_design,
+                       const std::vector<const SFPMuxDesignInterface*>& fanout_designs,
+                       const EndpointDelayModel& model);
+
+  /**
+   * @brief      Measure, align and verify a set of endpoints.
+   *
+   * The delays already applied in the endpoints are read back and taken
+   * out of the measured round trip times, so that re-aligning an aligned
+   * set leaves the delays unchanged. Inactive endpoints are skipped, and
+   * have no entry in the results.
+   *
+   * @param      number_of_samples  Echoes per round trip time measurement
+   * @param      tolerance          Largest accepted residual after alignment
+   */
+  timingfirmware::EndpointAlignmentResultVector align(const std::vector<ActiveEndpointConfig>& endpoints,
+                                                      uint32_t number_of_samples = 16, // NOLINT(build/unsigned)
+                                                      uint32_t tolerance = 0) const;   // NOLINT(build/unsigned)
+
+  /**
+   * @brief      Align a set of endpoints, starting from the stored alignments.
+   *
+   * Endpoints with a stored alignment are spot-checked with a state read
+   * and a single echo. Only those which moved, lost their link or drifted
+   * by more than drift_tolerance are measured in full; the others keep
+   * their stored round trip time. Delays are re-applied where the target
+   * changes. The database is updated and saved.
+   */
+  timingfirmware::EndpointAlignmentResultVector align(const std::vector<ActiveEndpointConfig>& endpoints,
+                                                      EndpointAlignmentDatabase& database,
+                                                      uint32_t number_of_samples = 16,     // NOLINT(build/unsigned)
+                                                      uint32_t tolerance = 0,              // NOLINT(build/unsigned)
+                                                      uint32_t drift_tolerance = 1) const; // NOLINT(build/unsigned)
+
+  /**
+   * @brief      Read the state and a single round trip time of an endpoint.
+   *
+   * @return     false if the endpoint did not respond
+   */
+  bool spot_check(const ActiveEndpointConfig& endpoint,
+                  uint32_t& state,                  // NOLINT(build/unsigned)
+                  uint32_t& round_trip_time) const; // NOLINT(build/unsigned)
+
+  /**
+   * @brief      Round trip time added by a pair of delays.
+   */
+  uint32_t get_delay_round_trip_time(uint32_t coarse_delay, uint32_t fine_delay) const; // NOLINT(build/unsigned)
+
+  /**
+   * @brief      Measure the round trip time statistics of one endpoint into result.
+   *
+   * The delays applied in the endpoint are read back in the same link
+   * session, into previous_coarse_delay and previous_fine_delay. The
+   * round trip time and statistics are as measured, i.e. include them.
+   */
+  EchoDelayStatistics measure(const ActiveEndpointConfig& endpoint,
+               timingfirmware::EndpointAlignmentResult& result,
+               uint32_t number_of_samples) const; // NOLINT(build/unsigned)
+
+  /**
+   * @brief      Take the round trip time of the delays read back from an endpoint out of its measurement.
+   *
+   * @return     false, and the endpoint marked as not alive, if the measurement is below the applied delays
+   */
+  bool subtract_applied_delays(timingfirmware::EndpointAlignmentResult& result, EchoDelayStatistics& stats) const;
+
+  /**
+   * @brief      Compute the delays which bring an endpoint to the target round trip time.
+   *
+   * @return     false if the required delay is out of range
+   */
+  bool compute_delays(timingfirmware::EndpointAlignmentResult& result, uint32_t target_rtt) const; // NOLINT(build/unsigned)
+
+  /**
+   * @brief      Apply the computed delays of the selected endpoints, one async packet per endpoint.
+   */
+  void apply_delays(const std::vector<ActiveEndpointConfig>& endpoints,
+                    const timingfirmware::EndpointAlignmentResultVector& results,
+                    const std::vector<size_t>& selection) const;
+
+  /**
+   * @brief      Re-measure the selected endpoints and fill in the residuals.
+   */
+  void verify(const std::vector<ActiveEndpointConfig>& endpoints,
+              timingfirmware::EndpointAlignmentResultVector& results,
+              const std::vector<size_t>& selection,
+              uint32_t number_of_samples, // NOLINT(build/unsigned)
+              uint32_t tolerance) const;  // NOLINT(build/unsigned)
+
+  const MasterNode& get_master_node() const { return *m_master; }
+
+private:
+  /**
+   * @brief      Route the upstream path to the endpoint through fanout or master mux.
+   */
+  void select_path(const ActiveEndpointConfig& endpoint) const;
+
+  const MasterDesignInterface& m_master_design;
+  const MasterNode* m_master;
+  const SFPMuxDesignInterface* m_master_mux;
+  std::vector<const SFPMuxDesignInterface*> m_fanout_designs;
+  EndpointDelayModel m_model;
+};
+
+} // namespace timing
+} // namespace dunedaq
+
+#endif // TIMING_INCLUDE_TIMING_ENDPOINTDELAYALIGNER_HPP_
@@ -73,6 +73,11 @@ public:
    */
   void get_info(timingfirmwareinfo::TimingDeviceInfo& mon_data) const override;
 
+  /**
+   * @brief    Register monitoring contributions by tier.
+   */
+  void register_monitoring(MonitoringScheduler& scheduler) const override;
+
 };
 
 } // namespace timing
@@ -24,6 +24,7 @@
 
 // C++ Headers
 #include <chrono>
+#include <memory>
 #include <string>
 
 namespace dunedaq {
@@ -37,6 +38,7 @@ class EndpointNode : public EndpointNodeInterface
   UHAL_DERIVEDNODE(EndpointNode)
 public:
   explicit EndpointNode(const uhal::Node& node);
+  EndpointNode(const EndpointNode& other);
   virtual ~EndpointNode();
 
   /**
@@ -72,6 +74,11 @@ public:
    */
   virtual uint64_t read_timestamp() const; // NOLINT(build/unsigned)
 
+  /**
+   * @brief      Read the current timestamp, bracketed by host clock reads.
+   */
+  TimestampSample sample_timestamp() const;
+
   /**
    * @brief      Read the endpoint clock frequency.
    *
@@ -82,6 +89,7 @@ public:
   /**
    * @brief     Collect monitoring information for timing endpoint
    *
+   * Each call also samples the command counters, and publishes those which changed.
    */
   void get_info(timingendpointinfo::TimingEndpointInfo& mon_data) const override;
 
@@ -107,6 +115,11 @@ protected:
     { 0xe, "Time check error (0xe)" },                     // 0b1110 when ST_ERR_T, -- Time check error
     { 0xf, "Protocol error (0xf)" },                       // 0b1111 when ST_ERR_X; -- Protocol error
   };
+
+private:
+  /// sampler kept between get_info calls; a copy of the node starts its own
+  struct MonitoringState;
+  std::unique_ptr<MonitoringState> m_monitoring;
 };
 
 } // namespace timing
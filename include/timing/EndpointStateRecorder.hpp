@@ -0,0 +1,161 @@
+/**
+ * @file EndpointStateRecorder.hpp
+ *
+ * EndpointStateRecorder samples the state of many endpoints at a high
+ * rate and records their transitions, so that short drop-outs between
+ * monitoring polls become visible.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TIMING_INCLUDE_TIMING_ENDPOINTSTATERECORDER_HPP_
+#define TIMING_INCLUDE_TIMING_ENDPOINTSTATERECORDER_HPP_
+
+#include "timing/EndpointNodeInterface.hpp"
+
+#include "timing/timingfirmwareinfo/Nljs.hpp"
+#include "timing/timingfirmwareinfo/Structs.hpp"
+
+#include "uhal/uhal.hpp"
+
+// C++ Headers
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dunedaq {
+namespace timing {
+
+/**
+ * @brief      Transition timeline and time in state statistics of endpoints.
+ *
+ * Each sample reads the csr.stat word of every endpoint, with one
+ * dispatch per device, and decodes ep_stat and ep_rdy from it. A change
+ * of either is a transition: it is stored, with the host time of the
+ * sample and the time since the previous successful read of the same
+ * device, in a ring of fixed capacity. The time spent in each state, and without ep_rdy, is
+ * accumulated per endpoint.
+ *
+ * Sampling runs either on demand, with sample(), or from a background
+ * thread at a fixed period, by default 2 kHz. The endpoints must
+ * outlive the recorder; they can be added while sampling.
+ */
+class EndpointStateRecorder
+{
+public:
+  explicit EndpointStateRecorder(size_t capacity = 4096);
+  ~EndpointStateRecorder();
+
+  EndpointStateRecorder(const EndpointStateRecorder&) = delete;
+  EndpointStateRecorder& operator=(const EndpointStateRecorder&) = delete;
+
+  void add_endpoint(const std::string& name, const EndpointNodeInterface& endpoint);
+
+  void set_period(std::chrono::microseconds period) { m_period = period; }
+
+  /**
+   * @brief      Read the state of every endpoint once.
+   *
+   * @return     Number of transitions recorded
+   */
+  size_t sample();
+
+  /**
+   * @brief      Sample from a background thread until stop() is called.
+   */
+  void start();
+  void stop();
+
+  /**
+   * @brief      Transitions in the ring, oldest first.
+   */
+  timingfirmwareinfo::EndpointStateTransitionVector get_transitions() const;
+
+  /**
+   * @brief      Time in state statistics of every endpoint, including the time spent so far in the current state.
+   */
+  timingfirmwareinfo::EndpointStateSummaryVector get_summaries() const;
+
+  /**
+   * @brief      Drop the transitions and statistics. The next sample starts a new baseline.
+   */
+  void clear();
+
+  void get_info(timingfirmwareinfo::EndpointStateRecorderMonitorData& mon_data, size_t max_transitions = 64) const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr size_t s_number_of_states = 16;
+
+  struct Endpoint
+  {
+    std::string name;
+    const uhal::Node* stat;
+    uint32_t state_mask;  // NOLINT(build/unsigned)
+    uint32_t state_shift; // NOLINT(build/unsigned)
+    uint32_t ready_mask;  // NOLINT(build/unsigned)
+
+    bool primed;
+    uint32_t state; // NOLINT(build/unsigned)
+    bool ready;
+    Clock::time_point since;
+    Clock::time_point not_ready_since;
+    uint64_t transitions;          // NOLINT(build/unsigned)
+    uint64_t not_ready_periods;    // NOLINT(build/unsigned)
+    uint64_t not_ready_time_us;    // NOLINT(build/unsigned)
+    uint64_t longest_not_ready_us; // NOLINT(build/unsigned)
+    std::array<uint64_t, s_number_of_states> time_in_state_us; // NOLINT(build/unsigned)
+    std::array<uint64_t, s_number_of_states> entries;          // NOLINT(build/unsigned)
+  };
+
+  struct Device
+  {
+    uhal::ClientInterface* client;
+    std::vector<size_t> endpoints;
+    std::vector<uhal::ValWord<uint32_t>> words; // NOLINT(build/unsigned)
+    bool sampled;
+    Clock::time_point last_sample; ///< last successful read, which bounds the time of a transition
+  };
+
+  bool update(Endpoint& endpoint,
+              uint32_t word, // NOLINT(build/unsigned)
+              Clock::time_point now,
+              int64_t now_ns,
+              uint64_t uncertainty_us); // NOLINT(build/unsigned)
+  void run();
+
+  /// serialises samples and additions of endpoints
+  std::mutex m_sample_mutex;
+  std::vector<Endpoint> m_endpoints;
+  std::vector<Device> m_devices;
+  std::chrono::microseconds m_period;
+
+  mutable std::mutex m_mutex;
+  std::vector<timingfirmwareinfo::EndpointStateTransition> m_ring;
+  size_t m_next;
+  size_t m_size;
+  uint64_t m_samples;                 // NOLINT(build/unsigned)
+  uint64_t m_late_samples;            // NOLINT(build/unsigned)
+  uint64_t m_failed_reads;            // NOLINT(build/unsigned)
+  uint64_t m_max_sample_us;           // NOLINT(build/unsigned)
+  uint64_t m_transitions;             // NOLINT(build/unsigned)
+  uint64_t m_overwritten_transitions; // NOLINT(build/unsigned)
+
+  std::mutex m_run_mutex;
+  std::condition_variable m_run_cv;
+  bool m_stop;
+  std::thread m_worker;
+};
+
+} // namespace timing
+} // namespace dunedaq
+
+#endif // TIMING_INCLUDE_TIMING_ENDPOINTSTATERECORDER_HPP_
@@ -13,6 +13,7 @@
 #define TIMING_INCLUDE_TIMING_FLCMDGENERATORNODE_HPP_
 
 // PDT Headers
+#include "timing/FLCmdRatePlanner.hpp"
 #include "timing/definitions.hpp"
 #include "timing/TimestampGeneratorNode.hpp"
 #include "timing/TimingNode.hpp"
@@ -46,6 +47,21 @@ public:
    */
   virtual void send_fl_cmd(uint32_t command,        // NOLINT(build/unsigned)
                            uint32_t channel) const; // NOLINT(build/unsigned)
+
+  /**
+   * @brief     Clear a channel and set the command it sends, without dispatching
+   */
+  void prepare_fl_cmd_channel(uint32_t command,        // NOLINT(build/unsigned)
+                              uint32_t channel) const; // NOLINT(build/unsigned)
+
+  /**
+   * @brief     Queue a force pulse on a prepared channel, without dispatching
+   *
+   * Force high and force low are queued together, so the pulse lasts one
+   * packet, unlike send_fl_cmd which dispatches each edge.
+   */
+  void queue_fl_cmd(uint32_t channel) const; // NOLINT(build/unsigned)
+
   /**
    * @brief     Configure fake trigger
    */
@@ -80,6 +96,11 @@ public:
                            uint32_t prescale, // NOLINT(build/unsigned)
                            bool poisson) const;
   
+  /**
+   * @brief     Enable several command generators with the settings of a rate plan
+   */
+  void enable_periodic_fl_cmd(const FLCmdMultiChannelPlan& plan) const;
+
   /**
    * @brief     Clear fake trigger configuration
    */
@@ -0,0 +1,133 @@
+/**
+ * @file FLCmdRatePlanner.hpp
+ *
+ * FLCmdRatePlanner finds the generator settings closest to a requested
+ * fixed length command rate, for one channel or for several together.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TIMING_INCLUDE_TIMING_FLCMDRATEPLANNER_HPP_
+#define TIMING_INCLUDE_TIMING_FLCMDRATEPLANNER_HPP_
+
+#include "timing/TimingIssues.hpp"
+
+#include "uhal/Node.hpp"
+
+// C++ Headers
+#include <cstdint>
+#include <vector>
+
+namespace dunedaq {
+namespace timing {
+
+/**
+ * @brief      Generator settings for one rate.
+ */
+struct FLCmdRatePlan
+{
+  double requested_rate = 0.;
+  double actual_rate = 0.;
+  /// (actual - requested) / requested
+  double relative_error = 0.;
+  uint32_t divisor = 0;  // NOLINT(build/unsigned)
+  uint32_t prescale = 1; // NOLINT(build/unsigned)
+  /// clock ticks between commands, 256 * prescale * 2^divisor
+  uint64_t period = 0; // NOLINT(build/unsigned)
+};
+
+/**
+ * @brief      Rate requested for one generator channel.
+ */
+struct FLCmdChannelRequest
+{
+  uint32_t channel; // NOLINT(build/unsigned)
+  uint32_t command; // NOLINT(build/unsigned)
+  double rate;
+  bool poisson;
+};
+
+/**
+ * @brief      Planned rate of one generator channel.
+ */
+struct FLCmdChannelPlan
+{
+  uint32_t channel; // NOLINT(build/unsigned)
+  uint32_t command; // NOLINT(build/unsigned)
+  bool poisson;
+  FLCmdRatePlan plan;
+};
+
+/**
+ * @brief      Settings and load of several generator channels.
+ */
+struct FLCmdMultiChannelPlan
+{
+  std::vector<FLCmdChannelPlan> channels;
+  double total_rate = 0.;
+  /// total rate as a fraction of the command slots, one every 256 clock ticks
+  double load = 0.;
+  /// expected rate at which two channels fire in the same command slot
+  double coincidence_rate = 0.;
+};
+
+/**
+ * @brief      Exhaustive search of the generator rate settings.
+ *
+ * Rate = clock_frequency_hz / (256 * 2^d * p), d in [0,15], p in [1,255],
+ * the prescale being an 8 bit register.
+ * The achievable periods do not depend on the clock frequency, so they
+ * are tabulated once, sorted and de-duplicated, and a request is a
+ * binary search.
+ */
+class FLCmdRatePlanner
+{
+public:
+  explicit FLCmdRatePlanner(uint32_t clock_frequency_hz); // NOLINT(build/unsigned)
+
+  /**
+   * @brief      Closest achievable rate.
+   *
+   * Throws BadRequestedFakeTriggerRate if the rate is not positive or
+   * more than a factor two outside the achievable range.
+   */
+  FLCmdRatePlan plan(double requested_rate) const;
+
+  /**
+   * @brief      Plan several channels and report their combined load and coincidences.
+   */
+  FLCmdMultiChannelPlan plan(const std::vector<FLCmdChannelRequest>& requests) const;
+
+  double get_min_rate() const;
+  double get_max_rate() const;
+
+  /**
+   * @brief      Throw InvalidFixedLatencyCommandRateSettings if a plan does not fit the generator registers.
+   */
+  static void validate_settings(const FLCmdRatePlan& plan, const uhal::Node& divisor_node, const uhal::Node& prescale_node);
+
+  static constexpr uint32_t max_divisor = 15;   // NOLINT(build/unsigned)
+  static constexpr uint32_t max_prescale = 255; // NOLINT(build/unsigned)
+  static constexpr uint32_t pre_division = 256; // NOLINT(build/unsigned)
+
+private:
+  struct Setting
+  {
+    uint64_t period;   // NOLINT(build/unsigned)
+    uint32_t divisor;  // NOLINT(build/unsigned)
+    uint32_t prescale; // NOLINT(build/unsigned)
+  };
+
+  static const std::vector<Setting>& get_settings();
+
+  FLCmdRatePlan make_plan(double requested_rate, const Setting& setting) const;
+
+  uint32_t m_clock_frequency_hz; // NOLINT(build/unsigned)
+};
+
+} // namespace timing
+} // namespace dunedaq
+
+#endif // TIMING_INCLUDE_TIMING_FLCMDRATEPLANNER_HPP_
@@ -68,6 +68,11 @@ public:
    * @brief    Give info to collector.
    */
   void get_info(timingfirmwareinfo::TimingDeviceInfo& mon_data) const override;
+
+  /**
+   * @brief    Register monitoring contributions by tier.
+   */
+  void register_monitoring(MonitoringScheduler& scheduler) const override;
 };
 
 } // namespace timing
@@ -0,0 +1,246 @@
+/**
+ * @file FleetGuardian.hpp
+ *
+ * FleetGuardian watches the health of many timing boards from a single
+ * event loop, reports faults as they appear and clear, and attempts
+ * automatic recovery.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TIMING_INCLUDE_TIMING_FLEETGUARDIAN_HPP_
+#define TIMING_INCLUDE_TIMING_FLEETGUARDIAN_HPP_
+
+#include "timing/EndpointNodeInterface.hpp"
+#include "timing/MasterNodeInterface.hpp"
+#include "timing/SI534xNode.hpp"
+#include "timing/TimingIssues.hpp"
+#include "timing/TopDesignInterface.hpp"
+
+#include "timing/timingfirmwareinfo/Nljs.hpp"
+#include "timing/timingfirmwareinfo/Structs.hpp"
+
+#include "uhal/uhal.hpp"
+
+// C++ Headers
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace timing {
+
+enum GuardedCondition
+{
+  kBoardUnreachable = 0,         ///< the board did not answer a poll
+  kCDRLossOfLock = 1,            ///< io csr.stat.cdr_lol
+  kCDRLossOfSignal = 2,          ///< io csr.stat.cdr_los
+  kSFPLossOfSignal = 3,          ///< io csr.stat.sfp_los
+  kSFPFault = 4,                 ///< io csr.stat.sfp_flt
+  kPLLLossOfLock = 5,            ///< PLL LOL, read over I2C
+  kPLLLossOfSignal = 6,          ///< PLL LOS on the inputs of the LOS mask, read over I2C
+  kEndpointNotReady = 7,         ///< an endpoint of the design is not ready
+  kUpstreamEndpointNotReady = 8, ///< the upstream endpoint of a master is not ready
+  kHSIBufferWarning = 9,         ///< HSI csr.stat.buf_warn
+  kNumberOfGuardedConditions = 10
+};
+
+enum RecoveryAction
+{
+  kNoRecovery = 0,
+  kResetEndpoint = 1,         ///< reset the endpoints which are not ready, keeping their address and partition
+  kEnableUpstreamEndpoint = 2 ///< resync the upstream CDR and endpoint of a master
+};
+
+std::string
+get_guarded_condition_name(GuardedCondition condition);
+
+std::string
+get_recovery_action_name(RecoveryAction action);
+
+/**
+ * @brief      Current state of one condition of one board.
+ */
+struct GuardedConditionStatus
+{
+  GuardedCondition condition = kBoardUnreachable;
+  bool active = false;
+  int64_t active_for_ms = 0;
+  uint32_t raised = 0;              // NOLINT(build/unsigned)
+  uint32_t recovery_attempts = 0;   // NOLINT(build/unsigned)
+  std::string detail;
+};
+
+/**
+ * @brief      Current state of one board.
+ */
+struct GuardedBoardStatus
+{
+  std::string name;
+  uint64_t polls = 0;                             // NOLINT(build/unsigned)
+  std::vector<GuardedConditionStatus> conditions; ///< the conditions watched on this board
+};
+
+/**
+ * @brief      Watchdog of a fleet of timing boards.
+ *
+ * Each board is polled on a fast period, with one dispatch of the
+ * status registers its design has (CDR and SFP flags of the IO, ready
+ * flags of the endpoints and upstream endpoint, HSI buffer warning),
+ * and on a slow period, with one read of its PLL status over I2C. The
+ * cost of a poll is therefore bounded by the design, not by the fleet.
+ * Polls are spread over the period and driven by one timerfd armed for
+ * the earliest deadline, so one thread handles hundreds of boards.
+ *
+ * A condition must be seen on debounce consecutive polls before it is
+ * raised, and be absent as long before it is cleared. Raising and
+ * clearing are reported immediately, but at most once per report
+ * interval per board and condition: edges in between are counted and
+ * summarised in the next report, and an active condition is reminded
+ * once per interval. Raised conditions with a recovery policy are
+ * recovered at most once per holdoff, and at most max_attempts times
+ * until they clear.
+ *
+ * A board which failed debounce consecutive polls is polled at twice
+ * the previous interval after every further failure, up to the maximum
+ * backoff, so that dead boards do not stall the loop on their timeouts
+ * every period. The first successful poll restores the fast period.
+ *
+ * Configure the guardian before run(); the designs must outlive it.
+ */
+class FleetGuardian
+{
+public:
+  FleetGuardian();
+  ~FleetGuardian();
+
+  FleetGuardian(const FleetGuardian&) = delete;
+  FleetGuardian& operator=(const FleetGuardian&) = delete;
+
+  void add_board(const std::string& name, const TopDesignInterface& design);
+
+  void set_fast_period(std::chrono::milliseconds period) { m_fast_period = period; }
+  void set_slow_period(std::chrono::milliseconds period) { m_slow_period = period; }
+
+  /**
+   * @brief      Number of consecutive polls needed to raise or clear a condition.
+   */
+  void set_debounce(uint32_t polls) { m_debounce = polls ? polls : 1; } // NOLINT(build/unsigned)
+
+  void set_report_interval(std::chrono::seconds interval) { m_report_interval = interval; }
+
+  /**
+   * @brief      Longest interval between the polls of an unreachable board.
+   */
+  void set_max_unreachable_backoff(std::chrono::milliseconds backoff) { m_max_unreachable_backoff = backoff; }
+
+  /**
+   * @brief      Whether a condition is watched; kUpstreamEndpointNotReady is not by default.
+   */
+  void set_watched(GuardedCondition condition, bool watched) { m_watched.at(condition) = watched; }
+
+  /**
+   * @brief      PLL inputs whose loss of signal raises kPLLLossOfSignal; none by default.
+   */
+  void set_pll_los_mask(uint32_t mask) { m_pll_los_mask = mask; } // NOLINT(build/unsigned)
+
+  /**
+   * @brief      Recovery of a condition; kEndpointNotReady and kUpstreamEndpointNotReady have one by default.
+   */
+  void set_recovery(GuardedCondition condition, RecoveryAction action) { m_recovery.at(condition) = action; }
+  void set_recovery_holdoff(std::chrono::seconds holdoff) { m_recovery_holdoff = holdoff; }
+  void set_max_recovery_attempts(uint32_t attempts) { m_max_recovery_attempts = attempts; } // NOLINT(build/unsigned)
+
+  /**
+   * @brief      Watch the boards until stop() is called.
+   */
+  void run();
+
+  /**
+   * @brief      Make run() return; safe to call from a signal handler.
+   */
+  void stop();
+
+  std::vector<GuardedBoardStatus> get_board_statuses() const;
+
+  void get_info(timingfirmwareinfo::FleetGuardianMonitorData& mon_data) const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct ConditionState
+  {
+    bool active = false;
+    uint32_t streak = 0; // NOLINT(build/unsigned)
+    Clock::time_point since;
+    Clock::time_point last_report;
+    bool reported = false;
+    uint32_t suppressed = 0;         // NOLINT(build/unsigned)
+    uint32_t raised = 0;             // NOLINT(build/unsigned)
+    uint32_t recovery_attempts = 0;  // NOLINT(build/unsigned)
+    Clock::time_point last_recovery;
+    std::string detail;
+  };
+
+  struct Board
+  {
+    std::string name;
+    const TopDesignInterface* design;
+    std::array<const uhal::Node*, kNumberOfGuardedConditions> flags; ///< single register conditions, if present
+    std::vector<const EndpointNodeInterface*> endpoints;
+    std::vector<size_t> endpoints_not_ready;
+    const MasterNodeInterface* master;
+    std::unique_ptr<const SI534xSlave> pll;
+    std::array<ConditionState, kNumberOfGuardedConditions> conditions;
+    Clock::time_point next_fast;
+    Clock::time_point next_slow;
+    uint64_t polls;                // NOLINT(build/unsigned)
+    uint32_t consecutive_failures; // NOLINT(build/unsigned)
+  };
+
+  bool is_watched(const Board& board, GuardedCondition condition) const;
+  std::chrono::milliseconds get_fast_interval(const Board& board) const;
+  void poll_fast(Board& board, Clock::time_point now);
+  void poll_slow(Board& board, Clock::time_point now);
+  void update(Board& board, GuardedCondition condition, bool present, const std::string& detail, Clock::time_point now);
+  void report(Board& board, GuardedCondition condition, Clock::time_point now);
+  void recover(Board& board, GuardedCondition condition, Clock::time_point now);
+
+  std::vector<std::unique_ptr<Board>> m_boards;
+  mutable std::mutex m_boards_mutex;
+
+  std::chrono::milliseconds m_fast_period;
+  std::chrono::milliseconds m_slow_period;
+  uint32_t m_debounce; // NOLINT(build/unsigned)
+  std::chrono::seconds m_report_interval;
+  std::chrono::milliseconds m_max_unreachable_backoff;
+  std::array<bool, kNumberOfGuardedConditions> m_watched;
+  uint32_t m_pll_los_mask; // NOLINT(build/unsigned)
+  std::array<RecoveryAction, kNumberOfGuardedConditions> m_recovery;
+  std::chrono::seconds m_recovery_holdoff;
+  uint32_t m_max_recovery_attempts; // NOLINT(build/unsigned)
+
+  int m_stop_fd;
+
+  std::atomic<uint64_t> m_polls;                // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_failed_polls;         // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_late_polls;           // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_conditions_raised;    // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_conditions_active;    // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_reports_suppressed;   // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_recoveries_attempted; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_recoveries_failed;    // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_max_poll_us;          // NOLINT(build/unsigned)
+};
+
+} // namespace timing
+} // namespace dunedaq
+
+#endif // TIMING_INCLUDE_TIMING_FLEETGUARDIAN_HPP_
@@ -14,6 +14,7 @@
 
 // PDT Headers
 #include "TimingIssues.hpp"
+#include "timing/DeviceTransactionScheduler.hpp"
 #include "timing/HSINode.hpp"
 #include "timing/EndpointDesignInterface.hpp"
 
@@ -82,6 +83,7 @@ public:
    */
   void get_info(timingfirmwareinfo::TimingDeviceInfo& mon_data) const override
   {
+    DeviceTransaction transaction(getClient(), kMonitoringTransaction);
     EndpointDesignInterface::get_info(0, mon_data.endpoint_info);
     HSIDesignInterface::get_info(mon_data.hsi_info);
   }
@@ -63,6 +63,21 @@ public:
   uhal::ValVector<uint32_t> read_data_buffer(bool read_all = false, // NOLINT(build/unsigned)
                                              bool fail_on_error = false) const;
 
+  /**
+   * @brief      Read a known number of words from the data buffer together with the buffer state, in one dispatch.
+   *
+   * The words are read before the state, so the word count returned in buffer_state describes what is left in
+   * the buffer after this read. Passing the complete events found in that count to the next call gives a readout
+   * loop with a single dispatch per iteration.
+   *
+   * @param      words_to_read  Number of words known to be in the buffer, e.g. from the previous call
+   * @param      buffer_state   Buffer error/warning/word count, encoded as by read_buffer_state
+   *
+   * @return     The buffer words read
+   */
+  uhal::ValVector<uint32_t> read_data_buffer_fused(uint32_t words_to_read,         // NOLINT(build/unsigned)
+                                                   uint32_t& buffer_state) const; // NOLINT(build/unsigned)
+
   /**
    * @brief      Print the contents of the endpoint data buffer.
    *
@@ -0,0 +1,187 @@
+/**
+ * @file HardwareBroker.hpp
+ *
+ * HardwareBroker owns the IPbus connection to one device and executes
+ * whole logical operations for clients connected to a local socket;
+ * HardwareBrokerClient is the client side.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TIMING_INCLUDE_TIMING_HARDWAREBROKER_HPP_
+#define TIMING_INCLUDE_TIMING_HARDWAREBROKER_HPP_
+
+#include "timing/TimingIssues.hpp"
+
+#include "timing/timingfirmwareinfo/Nljs.hpp"
+#include "timing/timingfirmwareinfo/Structs.hpp"
+
+#include "uhal/uhal.hpp"
+
+#include <nlohmann/json.hpp>
+
+// C++ Headers
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace timing {
+
+/**
+ * @brief      Default socket path of the broker of a device.
+ */
+std::string
+get_hardware_broker_path(const std::string& device);
+
+/**
+ * @brief      Serves logical operations on one device to local clients.
+ *
+ * Clients connect to a Unix domain socket and send requests framed as a
+ * 32 bit length followed by a JSON object; each request gets one reply
+ * on the same connection. The operations are:
+ *
+ *  - read: registers ("paths") and blocks ("blocks") read in one dispatch
+ *  - write: registers ("writes") and blocks ("blocks") written in one dispatch
+ *  - i2c: one I2C transaction on the bus at "bus": write "write", then read "read" bytes
+ *  - async_packet: one packet exchanged by the master at "master"
+ *  - status: get_status of the timing node at "path"
+ *  - stats: counters of the broker
+ *
+ * Every operation runs inside a DeviceTransaction on the device, so it
+ * executes atomically with respect to the other clients and to anything
+ * else in the broker process using the same scheduler. Writes, I2C
+ * transfers and packets are control transactions; reads and status are
+ * monitoring ones. Identical read requests which arrive while one is in
+ * flight wait for it and share its values, instead of reading again.
+ *
+ * The socket is only accessible to its owner.
+ */
+class HardwareBroker
+{
+public:
+  HardwareBroker(uhal::HwInterface& hw, const std::string& socket_path);
+  ~HardwareBroker();
+
+  HardwareBroker(const HardwareBroker&) = delete;
+  HardwareBroker& operator=(const HardwareBroker&) = delete;
+
+  /**
+   * @brief      Listen on the socket and serve clients from background threads.
+   */
+  void start();
+
+  /**
+   * @brief      Close the socket and every connection, waiting for the requests in progress.
+   */
+  void stop();
+
+  /**
+   * @brief      Execute one request, as if received from a client.
+   */
+  nlohmann::json execute(const nlohmann::json& request);
+
+  void get_info(timingfirmwareinfo::HardwareBrokerMonitorData& mon_data) const;
+
+  const std::string& get_socket_path() const { return m_socket_path; }
+
+private:
+  void accept_connections();
+  void serve_connection(int fd);
+
+  nlohmann::json execute_read(const nlohmann::json& request);
+  nlohmann::json read(const nlohmann::json& request);
+  nlohmann::json write(const nlohmann::json& request);
+  nlohmann::json transfer_i2c(const nlohmann::json& request);
+  nlohmann::json transmit_async_packet(const nlohmann::json& request);
+  nlohmann::json get_status(const nlohmann::json& request);
+  nlohmann::json get_stats() const;
+
+  uhal::HwInterface& m_hw;
+  std::string m_socket_path;
+  int m_listen_fd;
+  std::thread m_acceptor;
+
+  mutable std::mutex m_connections_mutex;
+  std::condition_variable m_connections_cv;
+  std::set<int> m_connections;
+  bool m_stopping;
+
+  std::mutex m_in_flight_mutex;
+  std::map<std::string, std::shared_future<nlohmann::json>> m_in_flight_reads;
+
+  std::atomic<uint64_t> m_connections_accepted; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_requests;             // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_failed_requests;      // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_dispatched_reads;     // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_coalesced_reads;      // NOLINT(build/unsigned)
+};
+
+/**
+ * @brief      Connection to a HardwareBroker.
+ *
+ * Requests on one connection are serialised; use one client per thread
+ * for concurrent requests. Failed operations throw HardwareBrokerRequestFailed.
+ */
+class HardwareBrokerClient
+{
+public:
+  explicit HardwareBrokerClient(const std::string& socket_path);
+  ~HardwareBrokerClient();
+
+  HardwareBrokerClient(const HardwareBrokerClient&) = delete;
+  HardwareBrokerClient& operator=(const HardwareBrokerClient&) = delete;
+
+  std::map<std::string, uint32_t> read(const std::vector<std::string>& paths) const; // NOLINT(build/unsigned)
+  uint32_t read(const std::string& path) const;                                      // NOLINT(build/unsigned)
+  std::vector<uint32_t> read_block(const std::string& path, uint32_t size) const;    // NOLINT(build/unsigned)
+
+  void write(const std::vector<std::pair<std::string, uint32_t>>& writes) const;     // NOLINT(build/unsigned)
+  void write(const std::string& path, uint32_t value) const;                         // NOLINT(build/unsigned)
+  void write_block(const std::string& path, const std::vector<uint32_t>& values) const; // NOLINT(build/unsigned)
+
+  /**
+   * @brief      One I2C transaction: write bytes, then read some back.
+   *
+   * The write is not terminated with a stop when bytes are read, as
+   * when addressing a register before reading it.
+   */
+  std::vector<uint8_t> transfer_i2c(const std::string& bus,                  // NOLINT(build/unsigned)
+                                    uint8_t i2c_device_address,              // NOLINT(build/unsigned)
+                                    const std::vector<uint8_t>& write_data,  // NOLINT(build/unsigned)
+                                    uint32_t number_of_bytes_to_read) const; // NOLINT(build/unsigned)
+
+  std::vector<uint32_t> transmit_async_packet(const std::vector<uint32_t>& packet, // NOLINT(build/unsigned)
+                                              int timeout = 500,
+                                              const std::string& master = "master") const;
+
+  std::string get_status(const std::string& path = "") const;
+
+  nlohmann::json get_stats() const;
+
+  /**
+   * @brief      Send a raw request and return the "result" of its reply.
+   */
+  nlohmann::json request(const nlohmann::json& request) const;
+
+private:
+  std::string m_socket_path;
+  int m_fd;
+  mutable std::mutex m_mutex;
+  mutable uint64_t m_next_id; // NOLINT(build/unsigned)
+};
+
+} // namespace timing
+} // namespace dunedaq
+
+#endif // TIMING_INCLUDE_TIMING_HARDWAREBROKER_HPP_
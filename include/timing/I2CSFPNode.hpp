@@ -17,6 +17,9 @@
 #include "timing/I2CSlave.hpp"
 #include "timing/toolbox.hpp"
 
+#include "timing/timinghardwareinfo/Nljs.hpp"
+#include "timing/timinghardwareinfo/Structs.hpp"
+
 #include "ers/Issue.hpp"
 
 #include <map>
@@ -180,10 +183,10 @@ public:
    */
   std::string get_status(bool print_out = false) const;
 
-  // /**
-  //  * @brief      Get and fill SFP hardware data
-  //  */
-  // void get_info(timinghardwareinfo::TimingSFPMonitorData& mon_data) const;
+  /**
+   * @brief      Get and fill SFP hardware data
+   */
+  void get_info(timinghardwareinfo::TimingSFPMonitorData& mon_data) const;
 
 
 protected:
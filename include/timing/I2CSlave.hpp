@@ -76,11 +76,14 @@ public:
   bool ping() const;
 
   std::string get_master_id() const;
+  std::string get_master_uri() const;
 
 protected:
   // Private constructor, accessible to I2CMaster
   I2CSlave(const I2CMasterNode* i2c_master, uint8_t i2c_device_address); // NOLINT(build/unsigned)
 
+  const I2CMasterNode& get_i2c_master() const { return *m_i2c_master; }
+
 private:
   const I2CMasterNode* m_i2c_master;
 
@@ -56,6 +56,11 @@ public:
    */
   uint64_t read_timestamp() const; // NOLINT(build/unsigned)
 
+  /**
+   * @brief      Read the current timestamp, bracketed by host clock reads.
+   */
+  TimestampSample sample_timestamp() const;
+
   /**
    * @brief      Set IRIG epoch: TAI/UNIX
    */
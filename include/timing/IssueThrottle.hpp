@@ -0,0 +1,127 @@
+/**
+ * @file IssueThrottle.hpp
+ *
+ * IssueThrottle rate limits issues raised on hot paths, aggregating
+ * repeats into periodic summaries.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TIMING_INCLUDE_TIMING_ISSUETHROTTLE_HPP_
+#define TIMING_INCLUDE_TIMING_ISSUETHROTTLE_HPP_
+
+#include "timing/TimingIssues.hpp"
+
+#include "timing/timingfirmwareinfo/Nljs.hpp"
+#include "timing/timingfirmwareinfo/Structs.hpp"
+
+#include "ers/Issue.hpp"
+
+// C++ Headers
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace dunedaq {
+namespace timing {
+
+enum IssueSeverity
+{
+  kIssueWarning = 0,
+  kIssueError = 1
+};
+
+/**
+ * @brief      Rate limiter of repeated issues.
+ *
+ * Issues are keyed by their class and a context chosen by the caller,
+ * e.g. the node or device they concern. The first issue of a key is
+ * reported immediately; repeats within the summary interval are only
+ * counted, and reported as one IssueRepeated summary, carrying the last
+ * message, when the interval has passed. A key whose interval passes
+ * without repeats is quiet again, and its next issue is reported
+ * immediately.
+ *
+ * Summaries are emitted by the next issue of any key after their
+ * interval, or by a sweeper thread, started with the first repeat, once
+ * per interval, so that the repeats of a burst are reported even if no
+ * issue follows it. flush() emits the pending ones at once, and runs on
+ * destruction.
+ */
+class IssueThrottle
+{
+public:
+  explicit IssueThrottle(std::chrono::milliseconds summary_interval = std::chrono::seconds(10));
+  ~IssueThrottle();
+
+  IssueThrottle(const IssueThrottle&) = delete;
+  IssueThrottle& operator=(const IssueThrottle&) = delete;
+
+  /**
+   * @brief      Throttle of the process, used by the nodes.
+   */
+  static IssueThrottle& get();
+
+  void report(IssueSeverity severity, const ers::Issue& issue, const std::string& context = "");
+  void warning(const ers::Issue& issue, const std::string& context = "") { report(kIssueWarning, issue, context); }
+  void error(const ers::Issue& issue, const std::string& context = "") { report(kIssueError, issue, context); }
+
+  /**
+   * @brief      Emit the summaries of all keys with unreported repeats.
+   */
+  void flush();
+
+  void set_summary_interval(std::chrono::milliseconds interval);
+
+  /**
+   * @brief      When disabled, every issue is reported immediately.
+   */
+  void set_enabled(bool enabled);
+
+  void get_info(timingfirmwareinfo::IssueThrottleMonitorData& mon_data) const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct KeyState
+  {
+    IssueSeverity severity;
+    Clock::time_point window_start;
+    uint64_t repeats;  // NOLINT(build/unsigned)
+    std::string last_message;
+  };
+
+  using Key = std::pair<std::string, std::string>;
+
+  void emit(IssueSeverity severity, const ers::Issue& issue) const;
+  void emit_summary(const Key& key, KeyState& state, Clock::time_point now);
+  void sweep(Clock::time_point now);
+  void run_sweeper();
+
+  mutable std::mutex m_mutex;
+  std::chrono::milliseconds m_summary_interval;
+  bool m_enabled;
+  std::map<Key, KeyState> m_keys;
+  Clock::time_point m_next_sweep;
+
+  std::condition_variable m_sweep_cv;
+  bool m_stop;
+  std::thread m_sweeper;
+
+  uint64_t m_issues;     // NOLINT(build/unsigned)
+  uint64_t m_reported;   // NOLINT(build/unsigned)
+  uint64_t m_suppressed; // NOLINT(build/unsigned)
+  uint64_t m_summaries;  // NOLINT(build/unsigned)
+};
+
+} // namespace timing
+} // namespace dunedaq
+
+#endif // TIMING_INCLUDE_TIMING_ISSUETHROTTLE_HPP_
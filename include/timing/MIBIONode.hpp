@@ -95,6 +95,11 @@ public:
    */
   std::string get_sfp_status(uint32_t sfp_id, bool print_out = false) const override; // NOLINT(build/unsigned)
 
+  /**
+   * @brief      Fill the monitoring data of an on-board SFP.
+   */
+  void get_sfp_info(uint32_t sfp_id, timinghardwareinfo::TimingSFPMonitorData& mon_data) const override; // NOLINT(build/unsigned)
+
   /**
    * @brief      control tx laser of on-board SFP softly (I2C command)
    */
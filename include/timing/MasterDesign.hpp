@@ -60,6 +60,13 @@ public:
    *
    */
   void sync_timestamp(TimestampSource source) const override;
+
+  /**
+   * @brief      Sync timestamp to the machine realtime clock, compensated for the IPbus write latency.
+   *
+   * Separate from sync_timestamp, which keeps the plain software load.
+   */
+  TimestampSyncResult sync_timestamp_compensated() const;
   
   /**
    * @brief      Measure the endpoint round trip time.
@@ -112,6 +119,11 @@ public:
    */
   void get_info(timingfirmwareinfo::TimingDeviceInfo& mon_data) const override;
 
+  /**
+   * @brief    Register monitoring contributions by tier.
+   */
+  void register_monitoring(MonitoringScheduler& scheduler) const override;
+
   /**
    * @brief    Give info to collector.
    */
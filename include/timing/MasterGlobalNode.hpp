@@ -38,6 +38,17 @@ public:
    */
   void enable_upstream_endpoint(uint32_t timeout = 500) const; // NOLINT(build/unsigned)
 
+  /**
+   * @brief     Poll the upstream CDR until it has been locked for stable_time.
+   *
+   * Right after an SFP switch the lock flag may still describe the previous
+   * link, so a single locked read is not trusted: the lock must hold for
+   * every read over stable_time [us].
+   *
+   * @return    true if the CDR locked before the timeout [ms]
+   */
+  bool wait_for_upstream_cdr_lock(uint32_t timeout = 100, uint32_t stable_time = 2000) const; // NOLINT(build/unsigned)
+
   /**
    * @brief     Read the upstream endpoint ready reg.
    */
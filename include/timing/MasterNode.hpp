@@ -15,6 +15,8 @@
 // PDT Headers
 #include "timing/definitions.hpp"
 #include "timing/toolbox.hpp"
+#include "timing/EchoMonitorNode.hpp"
+#include "timing/EndpointCommandBuilder.hpp"
 #include "timing/FLCmdGeneratorNode.hpp"
 #include "timing/MasterNodeInterface.hpp"
 #include "timing/MasterGlobalNode.hpp"
@@ -27,7 +29,10 @@
 
 // C++ Headers
 #include <chrono>
+#include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace dunedaq {
 namespace timing {
@@ -40,6 +45,7 @@ class MasterNode : public MasterNodeInterface
   UHAL_DERIVEDNODE(MasterNode)
 public:
   explicit MasterNode(const uhal::Node& node);
+  MasterNode(const MasterNode& other);
   virtual ~MasterNode();
 
   /**
@@ -68,6 +74,25 @@ public:
   void send_fl_cmd(uint32_t command,                                // NOLINT(build/unsigned)
                    uint32_t channel,                                // NOLINT(build/unsigned)
                    uint32_t number_of_commands = 1) const override; // NOLINT(build/unsigned)
+
+  /**
+   * @brief     Send a burst of fixed length commands, spread round-robin over the channels.
+   *
+   * Channels are cleared once, then the force pulses are queued and
+   * dispatched commands_per_dispatch at a time; force high and force low
+   * of a pulse share a packet, whereas send_fl_cmd dispatches each edge
+   * on its own. The command log is read back after every
+   * readback_interval-th command, 0 for none; as it holds the last
+   * command only, the forces queued before a readback are dispatched
+   * first, and the readback goes out with the next packet.
+   *
+   * @return    Timestamps of the read back commands
+   */
+  std::vector<uint64_t> send_fl_cmd_burst(uint32_t command,                            // NOLINT(build/unsigned)
+                                          const std::vector<uint32_t>& channels,       // NOLINT(build/unsigned)
+                                          uint32_t number_of_commands,                 // NOLINT(build/unsigned)
+                                          uint32_t readback_interval = 0,              // NOLINT(build/unsigned)
+                                          uint32_t commands_per_dispatch = 256) const; // NOLINT(build/unsigned)
   
   /**
    * @brief      Measure the endpoint round trip time.
@@ -76,6 +101,13 @@ public:
    */
   uint32_t measure_endpoint_rtt(uint32_t address, bool control_sfp = true) const override; // NOLINT(build/unsigned)
 
+  /**
+   * @brief      Measure the endpoint round trip time with a series of echoes.
+   */
+  EchoDelayStatistics measure_endpoint_rtt_statistics(uint32_t address,                   // NOLINT(build/unsigned)
+                                                      uint32_t number_of_samples = 16,    // NOLINT(build/unsigned)
+                                                      bool control_sfp = true) const;
+
   /**
    * @brief     Apply delay to endpoint
    */
@@ -88,11 +120,23 @@ public:
 
   using MasterNodeInterface::apply_endpoint_delay;
 
+  /**
+   * @brief     Queue the endpoint register writes which apply delays and resync the endpoint
+   */
+  static void add_endpoint_delay_commands(EndpointCommandBuilder& commands,
+                                          uint32_t coarse_delay, // NOLINT(build/unsigned)
+                                          uint32_t fine_delay);  // NOLINT(build/unsigned)
+
   /**
    * @brief     Set timestamp to current machine time
    */
   void sync_timestamp(TimestampSource source) const override; // NOLINT(build/unsigned)
 
+  /**
+   * @brief     Set timestamp to current machine time, compensated for the IPbus write latency
+   */
+  TimestampSyncResult sync_timestamp_compensated(uint32_t clock_frequency_hz) const override; // NOLINT(build/unsigned)
+
     /**
    * @brief      Read the current timestamp word.
    *
@@ -100,6 +144,11 @@ public:
    */
   uint64_t read_timestamp() const override; // NOLINT(build/unsigned)
 
+  /**
+   * @brief      Read the current timestamp, bracketed by host clock reads.
+   */
+  TimestampSample sample_timestamp() const;
+
   /**
    * @brief      Set the timestamp to current time.
    */
@@ -107,6 +156,9 @@ public:
 
   /**
    * @brief     Fill the PD-I master monitoring structure.
+   *
+   * Each call also polls the command log and samples the command counters, and
+   * publishes the log history and the counters which changed.
    */
   void get_info(timingfirmwareinfo::MasterMonitorData& mon_data) const;
 
@@ -120,6 +172,11 @@ public:
    */
   std::vector<uint32_t> transmit_async_packet(const std::vector<uint32_t>& packet, int timeout=500) const;
 
+  /**
+   * @brief    Next value of the rolling async packet sequence number, shared by all masters in the process
+   */
+  static uint8_t get_next_async_sequence(); // NOLINT(build/unsigned)
+
   /**
    * @brief    Write some data to endpoint registers
    */
@@ -130,6 +187,14 @@ public:
    */
   std::vector<uint32_t> read_endpoint_data(uint16_t endpoint_address, uint8_t reg_address, uint8_t data_length, bool address_mode) const;
 
+  /**
+   * @brief    Send the transactions queued in a command builder, in as few async packets as possible
+   *
+   * @return   Read data for each transaction, empty for writes
+   */
+  std::vector<std::vector<uint32_t>> transmit_endpoint_commands(const EndpointCommandBuilder& commands,
+                                                                bool wait_for_reply = true) const;
+
   /**
    * @brief    Disable timestamp sending
    */
@@ -145,11 +210,23 @@ public:
    */
   timingfirmware::EndpointCheckResult scan_endpoint(uint16_t endpoint_address, bool control_sfp) const override;
 
+  /**
+   * @brief    Scan a list of endpoints. The sfp of the next endpoint is switched on as soon as the
+   *           current one is off, and the upstream lock is polled rather than waited for.
+   */
+  timingfirmware::EndpointCheckResultoVector scan_endpoints(const std::vector<uint16_t>& endpoint_addresses,
+                                                            bool control_sfp) const override;
+
   /**
    * @brief    Configure endpoint command decoder
    */
   void configure_endpoint_command_decoder(uint16_t endpoint_address, uint8_t slot, uint8_t command) const;
 
+  /**
+   * @brief    Configure several endpoint command decoder slots with one async packet
+   */
+  void configure_endpoint_command_decoder(uint16_t endpoint_address, const std::map<uint8_t, uint8_t>& slot_commands) const;
+
   /**
    * @brief    Required major firmware version
    */
@@ -173,6 +250,20 @@ private:
   * @brief     Get the status tables.
   */
   std::string get_status_tables() const;
+
+  /**
+   * @brief     Run the checks of scan_endpoint on one endpoint, filling result and phase timings. Leaves the sfp on.
+   */
+  void check_endpoint(timingfirmware::EndpointCheckResult& endpoint_result, bool control_sfp) const;
+
+  /**
+   * @brief     Log and report the outcome of an endpoint check.
+   */
+  void report_endpoint_check(const timingfirmware::EndpointCheckResult& endpoint_result) const;
+
+  /// readers kept between get_info calls; a copy of the node starts its own
+  struct MonitoringState;
+  std::unique_ptr<MonitoringState> m_monitoring;
 };
 
 } // namespace timing
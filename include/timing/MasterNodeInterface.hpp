@@ -31,6 +31,7 @@
 
 // C++ Headers
 #include <chrono>
+#include <vector>
 
 namespace dunedaq {
 namespace timing {
@@ -61,6 +62,11 @@ public:
    */
   virtual void sync_timestamp(TimestampSource source) const = 0; // NOLINT(build/unsigned)
 
+  /**
+   * @brief     Set timestamp from the host clock, compensated for the write latency, enable transmission
+   */
+  virtual TimestampSyncResult sync_timestamp_compensated(uint32_t clock_frequency_hz) const = 0; // NOLINT(build/unsigned)
+
   /**
    * @brief     Control the tx line of endpoint sfp
    */
@@ -120,6 +126,12 @@ public:
    */
   virtual timingfirmware::EndpointCheckResult scan_endpoint(uint16_t endpoint_address, bool control_sfp) const = 0;
 
+  /**
+   * @brief    Scan a list of endpoints
+   */
+  virtual timingfirmware::EndpointCheckResultoVector scan_endpoints(const std::vector<uint16_t>& endpoint_addresses,
+                                                                    bool control_sfp) const;
+
   /**
    * @brief    Required major firmware version
    */
@@ -0,0 +1,179 @@
+/**
+ * @file MonitoringScheduler.hpp
+ *
+ * MonitoringScheduler collects the monitoring information of one device
+ * in tiers with independent periods, within a budget of IPbus dispatches
+ * and I2C transactions.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TIMING_INCLUDE_TIMING_MONITORINGSCHEDULER_HPP_
+#define TIMING_INCLUDE_TIMING_MONITORINGSCHEDULER_HPP_
+
+#include "timing/DeviceTransactionScheduler.hpp"
+#include "timing/TimingIssues.hpp"
+
+#include "timing/timingfirmwareinfo/Nljs.hpp"
+#include "timing/timingfirmwareinfo/Structs.hpp"
+
+// C++ Headers
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dunedaq {
+namespace timing {
+
+enum MonitoringTier
+{
+  kFastMonitoring = 0, ///< registers read in a single dispatch: timestamps, counters, csr.stat
+  kSlowMonitoring = 1  ///< I2C sources: PLL, SFPs
+};
+
+/**
+ * @brief      Bus budget of one device.
+ */
+struct MonitoringBudget
+{
+  uint32_t dispatches_per_second = 50;       // NOLINT(build/unsigned)
+  uint32_t i2c_transactions_per_second = 20; // NOLINT(build/unsigned)
+};
+
+/**
+ * @brief      Tiered monitoring of one device.
+ *
+ * Tasks are registered in a tier together with the dispatches and I2C
+ * transactions they cost, and run when their tier period has elapsed
+ * and the budget allows. The budget is a token bucket per resource,
+ * holding one second of tokens, or the cost of the most expensive task
+ * if that is more, so that every task eventually runs. A task which does
+ * not fit stays due and is retried first.
+ *
+ * Control activity is picked up from the control transactions of the
+ * device transaction scheduler, or reported with notify_control_activity.
+ * Slow tasks are then held off for a while, and all periods are
+ * stretched, up to eight times, until the control path has been quiet
+ * for a full period.
+ */
+class MonitoringScheduler
+{
+public:
+  using Collector = std::function<void(timingfirmwareinfo::TimingDeviceInfo&)>;
+
+  explicit MonitoringScheduler(const MonitoringBudget& budget = MonitoringBudget());
+  ~MonitoringScheduler();
+
+  MonitoringScheduler(const MonitoringScheduler&) = delete;
+  MonitoringScheduler& operator=(const MonitoringScheduler&) = delete;
+
+  void set_period(MonitoringTier tier, std::chrono::milliseconds period);
+
+  /**
+   * @brief      Run each task as a monitoring transaction of the device, and back off on its control transactions.
+   */
+  void set_transaction_scheduler(DeviceTransactionScheduler* scheduler);
+
+  /**
+   * @brief      Register a contribution to the device information.
+   */
+  void add_task(MonitoringTier tier,
+                const std::string& name,
+                uint32_t dispatches,       // NOLINT(build/unsigned)
+                uint32_t i2c_transactions, // NOLINT(build/unsigned)
+                Collector collect);
+
+  /**
+   * @brief      Run the tasks which are due and fit in the budget.
+   *
+   * @return     Number of tasks run
+   */
+  size_t poll();
+
+  /**
+   * @brief      Give way to the control path, for control operations outside the transaction scheduler.
+   */
+  void notify_control_activity();
+
+  /**
+   * @brief      Poll from a background thread.
+   */
+  void start(std::chrono::milliseconds tick = std::chrono::milliseconds(10));
+  void stop();
+
+  /**
+   * @brief      Latest device information.
+   */
+  timingfirmwareinfo::TimingDeviceInfo get_info() const;
+
+  void get_info(timingfirmwareinfo::MonitoringSchedulerMonitorData& mon_data) const;
+
+  static constexpr uint32_t max_backoff = 8; // NOLINT(build/unsigned)
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Task
+  {
+    MonitoringTier tier;
+    std::string name;
+    uint32_t dispatches;       // NOLINT(build/unsigned)
+    uint32_t i2c_transactions; // NOLINT(build/unsigned)
+    Collector collect;
+    Clock::time_point due;
+    uint64_t runs;     // NOLINT(build/unsigned)
+    uint64_t deferred; // NOLINT(build/unsigned)
+    uint64_t failures; // NOLINT(build/unsigned)
+    int64_t last_duration_us;
+  };
+
+  void refill(Clock::time_point now);
+  void check_control_transactions(Clock::time_point now);
+  void register_control_activity(Clock::time_point now);
+  void run(std::chrono::milliseconds tick);
+
+  MonitoringBudget m_budget;
+  std::array<std::chrono::milliseconds, 2> m_periods;
+
+  // guards the tasks, the budget and the backoff
+  mutable std::mutex m_task_mutex;
+  std::vector<Task> m_tasks;
+  double m_dispatch_tokens;
+  double m_i2c_tokens;
+  double m_dispatch_capacity;
+  double m_i2c_capacity;
+  Clock::time_point m_last_refill;
+  uint64_t m_dispatches;       // NOLINT(build/unsigned)
+  uint64_t m_i2c_transactions; // NOLINT(build/unsigned)
+
+  uint32_t m_backoff; // NOLINT(build/unsigned)
+  Clock::time_point m_last_control;
+  Clock::time_point m_last_backoff_change;
+  std::chrono::milliseconds m_control_holdoff;
+  uint64_t m_control_transactions; // NOLINT(build/unsigned)
+
+  std::atomic<DeviceTransactionScheduler*> m_transaction_scheduler;
+
+  // guards the device information; held while a task collects
+  mutable std::mutex m_info_mutex;
+  timingfirmwareinfo::TimingDeviceInfo m_info;
+
+  std::mutex m_run_mutex;
+  std::condition_variable m_run_cv;
+  bool m_stop;
+  std::thread m_worker;
+};
+
+} // namespace timing
+} // namespace dunedaq
+
+#endif // TIMING_INCLUDE_TIMING_MONITORINGSCHEDULER_HPP_
@@ -0,0 +1,139 @@
+/**
+ * @file OpMonDeltaEncoder.hpp
+ *
+ * OpMonDeltaEncoder and OpMonDeltaDecoder reduce monitoring publications
+ * to the fields which changed since the previous one.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TIMING_INCLUDE_TIMING_OPMONDELTAENCODER_HPP_
+#define TIMING_INCLUDE_TIMING_OPMONDELTAENCODER_HPP_
+
+#include "timing/timingfirmwareinfo/Nljs.hpp"
+#include "timing/timingfirmwareinfo/Structs.hpp"
+
+#include <nlohmann/json.hpp>
+
+// C++ Headers
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace timing {
+
+/**
+ * @brief      Change driven encoding of monitoring structures.
+ *
+ * The structure is flattened to json pointer paths. A message holds
+ * only the fields whose value changed since the previous message, and
+ * the paths which disappeared. Fields registered as counters are sent
+ * as the difference from their previous value, unless they went down.
+ * A * in a counter path matches any one path element, e.g. an array index.
+ * Every keyframe_interval messages, and on the first one, a keyframe
+ * carries every field, so that a consumer can start or recover.
+ *
+ * Message format:
+ *   { "sequence": n, "keyframe": bool,
+ *     "values": { path: value }, "deltas": { path: difference }, "removed": [ path ] }
+ */
+class OpMonDeltaEncoder
+{
+public:
+  explicit OpMonDeltaEncoder(uint32_t keyframe_interval = 60, // NOLINT(build/unsigned)
+                             const std::set<std::string>& counters = get_device_info_counters());
+
+  /**
+   * @brief      Paths of the cumulative counters of TimingDeviceInfo.
+   *
+   * Master command log and command counters, endpoint event and command
+   * counters; the latter count the triggers of HSI designs.
+   */
+  static const std::set<std::string>& get_device_info_counters();
+
+  /**
+   * @brief      Encode the current state of a structure.
+   *
+   * @return     Message, or null if nothing changed and no keyframe is due
+   */
+  nlohmann::json encode(const nlohmann::json& state);
+
+  /**
+   * @brief      Encode any structure with a generated to_json.
+   */
+  template<typename T>
+  nlohmann::json encode_info(const T& info)
+  {
+    nlohmann::json state;
+    to_json(state, info);
+    return encode(state);
+  }
+
+  /**
+   * @brief      Make the next message a keyframe.
+   */
+  void request_keyframe() { m_keyframe_requested = true; }
+
+  uint64_t get_number_of_messages() const { return m_messages; }       // NOLINT(build/unsigned)
+  uint64_t get_number_of_keyframes() const { return m_keyframes; }     // NOLINT(build/unsigned)
+  uint64_t get_number_of_fields_sent() const { return m_fields_sent; } // NOLINT(build/unsigned)
+  uint64_t get_number_of_fields_seen() const { return m_fields_seen; } // NOLINT(build/unsigned)
+
+  void get_info(timingfirmwareinfo::OpMonDeltaEncoderMonitorData& mon_data) const;
+
+private:
+  bool is_counter(const std::string& path) const;
+
+  uint32_t m_keyframe_interval; // NOLINT(build/unsigned)
+  std::set<std::string> m_counters;
+  std::vector<std::vector<std::string>> m_counter_patterns;
+
+  nlohmann::json m_last;
+  bool m_keyframe_requested;
+  uint64_t m_sequence;       // NOLINT(build/unsigned)
+  uint32_t m_since_keyframe; // NOLINT(build/unsigned)
+
+  uint64_t m_messages;    // NOLINT(build/unsigned)
+  uint64_t m_keyframes;   // NOLINT(build/unsigned)
+  uint64_t m_fields_sent; // NOLINT(build/unsigned)
+  uint64_t m_fields_seen; // NOLINT(build/unsigned)
+};
+
+/**
+ * @brief      Rebuilds the full structure from OpMonDeltaEncoder messages.
+ */
+class OpMonDeltaDecoder
+{
+public:
+  OpMonDeltaDecoder();
+
+  /**
+   * @brief      Apply one message.
+   *
+   * After a gap in the sequence, messages are ignored until the next keyframe.
+   *
+   * @return     True if the message was applied
+   */
+  bool decode(const nlohmann::json& message);
+
+  /**
+   * @brief      Current state, in the original nested form.
+   */
+  nlohmann::json get_state() const;
+
+  bool is_synchronised() const { return m_synchronised; }
+
+private:
+  nlohmann::json m_flat;
+  bool m_synchronised;
+  uint64_t m_sequence; // NOLINT(build/unsigned)
+};
+
+} // namespace timing
+} // namespace dunedaq
+
+#endif // TIMING_INCLUDE_TIMING_OPMONDELTAENCODER_HPP_
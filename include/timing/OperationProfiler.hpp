@@ -0,0 +1,143 @@
+/**
+ * @file OperationProfiler.hpp
+ *
+ * OperationProfiler counts the IPbus dispatches, words and wall time
+ * spent in high level operations.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TIMING_INCLUDE_TIMING_OPERATIONPROFILER_HPP_
+#define TIMING_INCLUDE_TIMING_OPERATIONPROFILER_HPP_
+
+#include "timing/timingfirmwareinfo/Nljs.hpp"
+#include "timing/timingfirmwareinfo/Structs.hpp"
+
+#include "uhal/uhal.hpp"
+
+// C++ Headers
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace timing {
+
+/**
+ * @brief      Aggregated statistics of one operation.
+ */
+struct OperationStatistics
+{
+  std::string name;
+  uint64_t calls = 0;         // NOLINT(build/unsigned)
+  uint64_t dispatches = 0;    // NOLINT(build/unsigned)
+  uint64_t words_read = 0;    // NOLINT(build/unsigned)
+  uint64_t words_written = 0; // NOLINT(build/unsigned)
+  uint64_t total_ns = 0;      // NOLINT(build/unsigned)
+  uint64_t min_ns = 0;        // NOLINT(build/unsigned)
+  uint64_t max_ns = 0;        // NOLINT(build/unsigned)
+  uint64_t p50_ns = 0;        // NOLINT(build/unsigned)
+  uint64_t p90_ns = 0;        // NOLINT(build/unsigned)
+  uint64_t p99_ns = 0;        // NOLINT(build/unsigned)
+};
+
+/**
+ * @brief      Process wide registry of profiled operations.
+ *
+ * Each thread records into its own counters, which only that thread
+ * writes, so recording takes no lock and no contended atomic.
+ * Statistics are summed over threads when they are requested. The
+ * counters of a thread which exits are handed, with their counts, to
+ * the next new thread, so short lived threads do not grow the registry.
+ * Latencies go into log-linear histograms with eight sub-buckets per
+ * power of two, i.e. percentiles are accurate to 12.5%.
+ *
+ * Operations nest: dispatches and words are attributed to every
+ * operation in progress on the calling thread, so the figures of an
+ * operation include those of the operations it calls.
+ */
+class OperationProfiler
+{
+public:
+  using OperationId = size_t;
+
+  /**
+   * @brief      Register an operation; registering a name twice returns the same id.
+   */
+  static OperationId add_operation(const std::string& name);
+
+  /**
+   * @brief      Dispatch a client and attribute the dispatch to the operations in progress on this thread.
+   */
+  static void dispatch(uhal::ClientInterface& client,
+                       uint32_t words_read,     // NOLINT(build/unsigned)
+                       uint32_t words_written); // NOLINT(build/unsigned)
+
+  /**
+   * @brief      Attribute one dispatch to the operations in progress on this thread.
+   */
+  static void record_dispatch(uint32_t words_read, uint32_t words_written); // NOLINT(build/unsigned)
+
+  static void set_enabled(bool enabled);
+  static bool is_enabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+  static std::vector<OperationStatistics> get_statistics();
+
+  /**
+   * @brief      Zero all counters. Counts recorded concurrently may be lost.
+   */
+  static void reset();
+
+  static void get_info(timingfirmwareinfo::OperationProfilerMonitorData& mon_data);
+
+  static constexpr size_t sub_bucket_bits = 3;
+  static constexpr size_t number_of_buckets = (64 - sub_bucket_bits + 1) << sub_bucket_bits;
+
+  static size_t get_bucket(uint64_t value_ns);     // NOLINT(build/unsigned)
+  static uint64_t get_bucket_limit(size_t bucket); // NOLINT(build/unsigned)
+
+private:
+  friend class ProfiledOperation;
+
+  struct ThreadCounters;
+  struct ThreadCountersOwner;
+  struct Registry;
+
+  static Registry& get_registry();
+
+  static ThreadCounters* get_thread_counters(OperationId id);
+
+  static std::atomic<bool> s_enabled;
+};
+
+/**
+ * @brief      Profiles the enclosing scope as one call of an operation.
+ *
+ *   static const auto operation = OperationProfiler::add_operation("Class::method");
+ *   ProfiledOperation profile(operation);
+ */
+class ProfiledOperation
+{
+public:
+  explicit ProfiledOperation(OperationProfiler::OperationId id);
+  ~ProfiledOperation();
+
+  ProfiledOperation(const ProfiledOperation&) = delete;
+  ProfiledOperation& operator=(const ProfiledOperation&) = delete;
+
+private:
+  friend class OperationProfiler;
+
+  OperationProfiler::ThreadCounters* m_counters;
+  ProfiledOperation* m_parent;
+  std::chrono::steady_clock::time_point m_start;
+};
+
+} // namespace timing
+} // namespace dunedaq
+
+#endif // TIMING_INCLUDE_TIMING_OPERATIONPROFILER_HPP_
@@ -0,0 +1,143 @@
+/**
+ * @file StatusCache.hpp
+ *
+ * StatusCacheWriter and StatusCacheReader share the latest monitoring
+ * snapshot of a device between processes through shared memory.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TIMING_INCLUDE_TIMING_STATUSCACHE_HPP_
+#define TIMING_INCLUDE_TIMING_STATUSCACHE_HPP_
+
+#include "timing/TimingIssues.hpp"
+
+#include "timing/timingfirmwareinfo/Nljs.hpp"
+#include "timing/timingfirmwareinfo/Structs.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <sys/types.h>
+
+// C++ Headers
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace timing {
+
+/**
+ * @brief      Name of the shared memory segment of a device.
+ */
+std::string
+get_status_cache_name(const std::string& device);
+
+/**
+ * @brief      One published snapshot.
+ */
+struct StatusSnapshot
+{
+  uint64_t version = 0; // NOLINT(build/unsigned)
+  int64_t published_realtime_ns = 0;
+  nlohmann::json data;
+};
+
+/**
+ * @brief      Publishes snapshots of one device into shared memory.
+ *
+ * The segment holds one snapshot, serialised as MessagePack, behind a
+ * sequence lock: the sequence is odd while a snapshot is written, and
+ * readers retry if it was odd or changed while they copied. Readers
+ * therefore never block the writer, nor each other. The segment is
+ * removed when the writer is destroyed.
+ *
+ * The header holds the pid of the writer. A segment whose writer is
+ * still running is never taken over; one left by a writer which died is
+ * replaced.
+ */
+class StatusCacheWriter
+{
+public:
+  explicit StatusCacheWriter(const std::string& device, size_t capacity = 1 << 20);
+  ~StatusCacheWriter();
+
+  StatusCacheWriter(const StatusCacheWriter&) = delete;
+  StatusCacheWriter& operator=(const StatusCacheWriter&) = delete;
+
+  /**
+   * @brief      Publish a snapshot, replacing the previous one.
+   *
+   * @return     Version of the snapshot
+   */
+  uint64_t publish(const nlohmann::json& data); // NOLINT(build/unsigned)
+
+  const std::string& get_name() const { return m_name; }
+
+private:
+  std::string m_name;
+  size_t m_capacity;
+  void* m_segment;
+  size_t m_segment_size;
+  uint64_t m_version;            // NOLINT(build/unsigned)
+  std::vector<uint8_t> m_buffer; // NOLINT(build/unsigned)
+};
+
+/**
+ * @brief      Reads the snapshots of one device from shared memory.
+ *
+ * Reading never touches the hardware. A reader attached to a segment
+ * keeps it after the writer exits, or after a new writer replaced it;
+ * is_stale tells when it should reattach, and the age of the snapshot
+ * when the writer stopped publishing.
+ */
+class StatusCacheReader
+{
+public:
+  explicit StatusCacheReader(const std::string& device);
+  ~StatusCacheReader();
+
+  StatusCacheReader(const StatusCacheReader&) = delete;
+  StatusCacheReader& operator=(const StatusCacheReader&) = delete;
+
+  /**
+   * @brief      Latest snapshot.
+   */
+  StatusSnapshot read() const;
+
+  /**
+   * @brief      Latest snapshot, if newer than a version already read.
+   */
+  bool read_if_newer(uint64_t version, StatusSnapshot& snapshot) const; // NOLINT(build/unsigned)
+
+  /**
+   * @brief      Device information of the latest snapshot, as published by timing_status_publisher.
+   */
+  timingfirmwareinfo::TimingDeviceInfo read_info() const;
+
+  uint64_t get_version() const; // NOLINT(build/unsigned)
+
+  /**
+   * @brief      Pid of the process which created the segment, 0 once it has closed it.
+   */
+  int get_writer_pid() const;
+
+  /**
+   * @brief      True if the writer has exited, or the segment is no longer the one published under the name.
+   */
+  bool is_stale() const;
+
+private:
+  std::string m_name;
+  ino_t m_inode;
+  const void* m_segment;
+  size_t m_segment_size;
+  mutable std::vector<uint8_t> m_buffer; // NOLINT(build/unsigned)
+};
+
+} // namespace timing
+} // namespace dunedaq
+
+#endif // TIMING_INCLUDE_TIMING_STATUSCACHE_HPP_
@@ -0,0 +1,147 @@
+/**
+ * @file TimestampCoherenceChecker.hpp
+ *
+ * TimestampCoherenceChecker compares the timestamps of endpoints on any
+ * number of boards with their master.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TIMING_INCLUDE_TIMING_TIMESTAMPCOHERENCECHECKER_HPP_
+#define TIMING_INCLUDE_TIMING_TIMESTAMPCOHERENCECHECKER_HPP_
+
+#include "timing/EndpointNode.hpp"
+#include "timing/MasterNode.hpp"
+#include "timing/TimingIssues.hpp"
+
+#include "timing/timingfirmwareinfo/Nljs.hpp"
+#include "timing/timingfirmwareinfo/Structs.hpp"
+
+// C++ Headers
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dunedaq {
+namespace timing {
+
+/**
+ * @brief      Offset of one endpoint from the master.
+ */
+struct TimestampCoherenceResult
+{
+  std::string name;
+  bool sampled = false;
+  uint64_t timestamp = 0; // NOLINT(build/unsigned)
+  /// endpoint minus master time, corrected for sampling skew and cable delay
+  int64_t offset_ns = 0;
+  /// half the sampling brackets of the endpoint and the master
+  int64_t uncertainty_ns = 0;
+  int64_t round_trip_ns = 0;
+  bool in_tolerance = false;
+};
+
+/**
+ * @brief      Checks that endpoint timestamps agree with the master.
+ *
+ * Endpoints are grouped by board, i.e. by IPbus client. Each board is
+ * read in one dispatch from its own persistent reader thread, bracketed
+ * by host monotonic clock reads, and the master timestamp is projected to
+ * the time each board was read. Checks can be run on demand or
+ * periodically from a background thread, which reports incoherent
+ * endpoints as warnings. Endpoints can be added at any time, checks and
+ * additions are serialised.
+ */
+class TimestampCoherenceChecker
+{
+public:
+  TimestampCoherenceChecker(const MasterNode& master,
+                            uint32_t clock_frequency_hz, // NOLINT(build/unsigned)
+                            int64_t tolerance_ns);
+  ~TimestampCoherenceChecker();
+
+  TimestampCoherenceChecker(const TimestampCoherenceChecker&) = delete;
+  TimestampCoherenceChecker& operator=(const TimestampCoherenceChecker&) = delete;
+
+  /**
+   * @brief      Add an endpoint to the check.
+   *
+   * @param      cable_delay_ns  Expected lag of the endpoint behind the master, not compensated by its delays
+   */
+  void add_endpoint(const std::string& name, const EndpointNode& endpoint, int64_t cable_delay_ns = 0);
+
+  /**
+   * @brief      Sample every board once and compare with the master.
+   */
+  std::vector<TimestampCoherenceResult> check();
+
+  /**
+   * @brief      Check periodically from a background thread.
+   */
+  void start(std::chrono::milliseconds period);
+  void stop();
+
+  std::vector<TimestampCoherenceResult> get_last_results() const;
+
+  void get_info(timingfirmwareinfo::TimestampCoherenceMonitorData& mon_data) const;
+
+private:
+  struct Endpoint
+  {
+    std::string name;
+    const EndpointNode* node;
+    int64_t cable_delay_ns;
+  };
+
+  struct Board
+  {
+    const uhal::ClientInterface* client;
+    std::vector<const uhal::Node*> timestamp_nodes;
+    std::vector<size_t> endpoints;
+    bool has_master;
+  };
+
+  void run(std::chrono::milliseconds period);
+  void read_board(size_t board);
+
+
+  const MasterNode& m_master;
+  uint32_t m_clock_frequency_hz; // NOLINT(build/unsigned)
+  int64_t m_tolerance_ns;
+
+  /// serialises checks and additions of endpoints
+  std::mutex m_check_mutex;
+  std::vector<Endpoint> m_endpoints;
+  std::vector<Board> m_boards;
+
+  // one reader per board, woken for each check
+  std::mutex m_readers_mutex;
+  std::condition_variable m_readers_cv;
+  std::condition_variable m_readers_done_cv;
+  uint64_t m_check_generation; // NOLINT(build/unsigned)
+  size_t m_boards_pending;
+  bool m_readers_stop;
+  std::vector<std::vector<TimestampSample>> m_board_samples;
+  std::vector<std::thread> m_readers;
+
+  mutable std::mutex m_results_mutex;
+  std::vector<TimestampCoherenceResult> m_last_results;
+  uint64_t m_number_of_checks;     // NOLINT(build/unsigned)
+  uint64_t m_number_of_incoherent; // NOLINT(build/unsigned)
+
+  std::mutex m_run_mutex;
+  std::condition_variable m_run_cv;
+  bool m_stop;
+  std::thread m_worker;
+};
+
+} // namespace timing
+} // namespace dunedaq
+
+#endif // TIMING_INCLUDE_TIMING_TIMESTAMPCOHERENCECHECKER_HPP_
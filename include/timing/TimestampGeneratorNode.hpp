@@ -32,6 +32,24 @@ ERS_DECLARE_ISSUE(timing,
 )
 namespace timing {
 
+/**
+ * @brief      Outcome of a latency compensated timestamp sync.
+ */
+struct TimestampSyncResult
+{
+  uint32_t clock_frequency_hz = 0; // NOLINT(build/unsigned)
+  int64_t write_rtt_min_ns = 0;
+  int64_t write_rtt_median_ns = 0;
+  int64_t write_rtt_max_ns = 0;
+  /// latency added to the host time before it is loaded, half the median write round trip
+  int64_t compensation_ns = 0;
+  uint64_t loaded_timestamp = 0; // NOLINT(build/unsigned)
+  /// master time minus host time after the sync
+  int64_t residual_ns = 0;
+  /// half width of the host clock reads bracketing the verification sample
+  int64_t residual_uncertainty_ns = 0;
+};
+
 /**
  * @brief      Class for timestamp generator node.
  */
@@ -61,6 +79,11 @@ public:
    */
   uint64_t read_timestamp() const; // NOLINT(build/unsigned)
 
+  /**
+   * @brief      Read the current timestamp, bracketed by host clock reads.
+   */
+  TimestampSample sample_timestamp() const;
+
   /**
    * @brief      Read the starting timestamp words.
    *
@@ -79,6 +102,31 @@ public:
    * @brief      Initialise timestamp.
    */
   void set_timestamp(TimestampSource source) const; // NOLINT(build/unsigned)
+
+  /**
+   * @brief      Load the host realtime clock, compensated for the measured IPbus write latency.
+   *
+   * @param      number_of_samples  Write round trips used to estimate the latency
+   */
+  TimestampSyncResult set_timestamp_compensated(uint32_t clock_frequency_hz,          // NOLINT(build/unsigned)
+                                                uint32_t number_of_samples = 32) const; // NOLINT(build/unsigned)
+
+  /**
+   * @brief      Offset of the generator time from the host realtime clock.
+   *
+   * Each sample is bracketed by two host clock reads; the tightest one is used.
+   *
+   * @return     Generator time minus host time in ns
+   */
+  int64_t measure_offset(uint32_t clock_frequency_hz,  // NOLINT(build/unsigned)
+                         uint32_t number_of_samples,   // NOLINT(build/unsigned)
+                         int64_t& uncertainty_ns) const;
+
+private:
+  /**
+   * @brief      Poll until the loaded timestamp is reported, throw TimestampNotReady after 1 s.
+   */
+  void wait_for_timestamp_load() const;
 };
 
 } // namespace timing
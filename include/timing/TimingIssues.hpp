@@ -28,6 +28,11 @@ ERS_DECLARE_ISSUE(timing,                    ///< Namespace
                   file_path << " corrupted", ///< Message
                   ((std::string)file_path)   ///< Message parameters
 )
+ERS_DECLARE_ISSUE(timing,                              ///< Namespace
+                  FileNotWritable,                      ///< Issue class name
+                  file_path << " could not be written", ///< Message
+                  ((std::string)file_path)              ///< Message parameters
+)
 ERS_DECLARE_ISSUE_BASE(timing,                         ///< Namespace
                        FileIsDirectory,                ///< Issue class name
                        CorruptedFile,                  ///< Base class of the issue
@@ -191,12 +196,48 @@ ERS_DECLARE_ISSUE(timing,
                    ((uint)timeout)                                                                                                                 ///< Message parameters
 )
 
+ERS_DECLARE_ISSUE(timing,                                                                                                  ///< Namespace
+                  UnstableEndpointRoundTripTime,                                                                           ///< Issue class name
+                  "Round trip time of endpoint at address 0x" << std::hex << ept_address << std::dec << " unstable, min: " << min << ", max: " << max, ///< Message
+                  ((uint32_t)ept_address)((uint32_t)min)((uint32_t)max)                                                     ///< Message parameters
+)
+
+ERS_DECLARE_ISSUE(timing,                                                            ///< Namespace
+                  EndpointAlignmentFailed,                                           ///< Issue class name
+                  "Endpoint delay alignment failed: " << reason,                    ///< Message
+                  ((std::string)reason)                                              ///< Message parameters
+)
+
+ERS_DECLARE_ISSUE(timing,                                                                                                                                                                               ///< Namespace
+                  InconsistentEndpointDelay,                                                                                                                                                            ///< Issue class name
+                  "Endpoint at address 0x" << std::hex << ept_address << std::dec << " has a round trip time of " << round_trip_time << ", below the " << applied << " its applied delays account for", ///< Message
+                  ((uint32_t)ept_address)((uint32_t)round_trip_time)((uint32_t)applied)                                                                                                                 ///< Message parameters
+)
+
+ERS_DECLARE_ISSUE(timing,                                                                                                                      ///< Namespace
+                  EndpointDelayOutOfRange,                                                                                                     ///< Issue class name
+                  "Endpoint at address 0x" << std::hex << ept_address << std::dec << " needs a round trip time increase of " << required << ", beyond the delay range", ///< Message
+                  ((uint32_t)ept_address)((uint32_t)required)                                                                                   ///< Message parameters
+)
+
 ERS_DECLARE_ISSUE(timing,                                                                                                                                      ///< Namespace
                   InvalidVLCommandReplyPacket,                                                                                                                 ///< Issue class name
                   " Variable length (async) command reply packet invalid. byte 0,1,2: " << std::hex << "0x" << byte_0 << ", 0x" << byte_1 << ", 0x" << byte_2, ///< Message
                   ((uint32_t)byte_0)((uint32_t)byte_1)((uint32_t)byte_2)                                                                                       ///< Message parameters
 )
 
+ERS_DECLARE_ISSUE(timing,                                                                                                                  ///< Namespace
+                  InvalidVLCommandLength,                                                                                                  ///< Issue class name
+                  " Invalid variable length (async) command transaction length: " << length << ", register: 0x" << std::hex << reg_address, ///< Message
+                  ((size_t)length)((uint32_t)reg_address)                                                                                  ///< Message parameters
+)
+
+ERS_DECLARE_ISSUE(timing,                                                                                                            ///< Namespace
+                  InvalidVLCommandReplyLength,                                                                                       ///< Issue class name
+                  " Variable length (async) command reply too short. Received words: " << received << ", expected: " << expected, ///< Message
+                  ((size_t)received)((size_t)expected)                                                                               ///< Message parameters
+)
+
 ERS_DECLARE_ISSUE(timing,                                               ///< Namespace
                   FormatCountersTableNodesTitlesMismatch,               ///< Issue class name
                   " Mismatch between number counters nodes and titles", ///< Message
@@ -324,6 +365,126 @@ ERS_DECLARE_ISSUE(timing,
                    ((uint)channel)                                                                           ///< Message parameters
 )
 
+ERS_DECLARE_ISSUE(timing,                                                                                         ///< Namespace
+                  InvalidFixedLatencyCommandRateSettings,                                                         ///< Issue class name
+                  "Rate settings d: " << divisor << ", p: " << prescale << " do not fit the generator registers", ///< Message
+                  ((uint32_t)divisor)((uint32_t)prescale)                                                         ///< Message parameters
+)
+
+ERS_DECLARE_ISSUE(timing,                                                                                    ///< Namespace
+                  NoFixedLatencyCommandChannels,                                                             ///< Issue class name
+                  "No fixed-latency command channel given for a burst of command 0x" << std::hex << command, ///< Message
+                  ((uint32_t)command)                                                                        ///< Message parameters
+)
+
+ERS_DECLARE_ISSUE(timing,                                                                                            ///< Namespace
+                  FixedLatencyCommandLogMismatch,                                                                    ///< Issue class name
+                  mismatches << " command log readbacks did not match the sent command 0x" << std::hex << command, ///< Message
+                  ((uint32_t)command)((uint32_t)mismatches)                                                         ///< Message parameters
+)
+
+ERS_DECLARE_ISSUE(timing,                                                                         ///< Namespace
+                  ClockMappingNotReady,                                                           ///< Issue class name
+                  "Clock mapping not ready, " << samples << " samples fitted, at least 2 needed", ///< Message
+                  ((uint32_t)samples)                                                             ///< Message parameters
+)
+
+ERS_DECLARE_ISSUE(timing,                                                         ///< Namespace
+                  ClockMappingSampleFailed,                                       ///< Issue class name
+                  "Failed to sample the timestamp for clock mapping: " << reason, ///< Message
+                  ((std::string)reason)                                           ///< Message parameters
+)
+
+ERS_DECLARE_ISSUE(timing,                                                                                                             ///< Namespace
+                  EndpointTimestampIncoherent,                                                                                        ///< Issue class name
+                  "Endpoint " << name << " timestamp is " << offset_ns << " ns from the master, tolerance " << tolerance_ns << " ns", ///< Message
+                  ((std::string)name)((int64_t)offset_ns)((int64_t)tolerance_ns)                                                      ///< Message parameters
+)
+
+ERS_DECLARE_ISSUE(timing,                                                                ///< Namespace
+                  EndpointTimestampNotSampled,                                           ///< Issue class name
+                  "Could not compare endpoint " << name << " timestamp with the master", ///< Message
+                  ((std::string)name)                                                    ///< Message parameters
+)
+
+ERS_DECLARE_ISSUE(timing,                                              ///< Namespace
+                  MonitoringTaskFailed,                                ///< Issue class name
+                  "Monitoring task " << name << " failed: " << reason, ///< Message
+                  ((std::string)name)((std::string)reason)             ///< Message parameters
+)
+
+ERS_DECLARE_ISSUE(timing,                                    ///< Namespace
+                  StatusCacheError,                          ///< Issue class name
+                  "Status cache " << name << ": " << reason, ///< Message
+                  ((std::string)name)((std::string)reason)   ///< Message parameters
+)
+
+ERS_DECLARE_ISSUE(timing,                                                                                                     ///< Namespace
+                  StatusCacheSnapshotTooLarge,                                                                                ///< Issue class name
+                  "Status snapshot of " << size << " bytes does not fit in cache " << name << " of " << capacity << " bytes", ///< Message
+                  ((std::string)name)((size_t)size)((size_t)capacity)                                                         ///< Message parameters
+)
+
+ERS_DECLARE_ISSUE(timing,                                       ///< Namespace
+                  HardwareBrokerError,                          ///< Issue class name
+                  "Hardware broker " << path << ": " << reason, ///< Message
+                  ((std::string)path)((std::string)reason)      ///< Message parameters
+)
+
+ERS_DECLARE_ISSUE(timing,                                                             ///< Namespace
+                  HardwareBrokerRequestFailed,                                        ///< Issue class name
+                  "Hardware broker request '" << operation << "' failed: " << reason, ///< Message
+                  ((std::string)operation)((std::string)reason)                       ///< Message parameters
+)
+
+ERS_DECLARE_ISSUE(timing,                       ///< Namespace
+                  GuardianError,                ///< Issue class name
+                  "Guardian error: " << reason, ///< Message
+                  ((std::string)reason)         ///< Message parameters
+)
+
+ERS_DECLARE_ISSUE(timing,                                                                                                                              ///< Namespace
+                  GuardedConditionRaised,                                                                                                              ///< Issue class name
+                  "Board " << board << ": " << condition << " " << detail << " (" << suppressed << " transitions not reported since the last report)", ///< Message
+                  ((std::string)board)((std::string)condition)((std::string)detail)((uint32_t)suppressed)                                              ///< Message parameters
+)
+
+ERS_DECLARE_ISSUE(timing,                                                                                                                                                           ///< Namespace
+                  GuardedConditionPersists,                                                                                                                                         ///< Issue class name
+                  "Board " << board << ": " << condition << " " << detail << " for " << active_for_s << " s (" << suppressed << " transitions not reported since the last report)", ///< Message
+                  ((std::string)board)((std::string)condition)((std::string)detail)((int64_t)active_for_s)((uint32_t)suppressed)                                                    ///< Message parameters
+)
+
+ERS_DECLARE_ISSUE(timing,                                                                                                                     ///< Namespace
+                  GuardedConditionCleared,                                                                                                    ///< Issue class name
+                  "Board " << board << ": " << condition << " cleared (" << suppressed << " transitions not reported since the last report)", ///< Message
+                  ((std::string)board)((std::string)condition)((uint32_t)suppressed)                                                          ///< Message parameters
+)
+
+ERS_DECLARE_ISSUE(timing,                                                                    ///< Namespace
+                  GuardianRecoveryAttempted,                                                 ///< Issue class name
+                  "Board " << board << ": attempting " << action << ", attempt " << attempt, ///< Message
+                  ((std::string)board)((std::string)action)((uint32_t)attempt)               ///< Message parameters
+)
+
+ERS_DECLARE_ISSUE(timing,                                                        ///< Namespace
+                  GuardianRecoveryFailed,                                        ///< Issue class name
+                  "Board " << board << ": " << action << " failed: " << reason,  ///< Message
+                  ((std::string)board)((std::string)action)((std::string)reason) ///< Message parameters
+)
+
+ERS_DECLARE_ISSUE(timing,                                                                                                                   ///< Namespace
+                  IssueRepeated,                                                                                                            ///< Issue class name
+                  issue_class << " (" << context << ") repeated " << repeats << " times in " << window_ms << " ms, last: " << last_message, ///< Message
+                  ((std::string)issue_class)((std::string)context)((uint64_t)repeats)((int64_t)window_ms)((std::string)last_message)        ///< Message parameters
+)
+
+ERS_DECLARE_ISSUE(timing,                                                                                                        ///< Namespace
+                  UpstreamCDRNotLocked,                                                                                          ///< Issue class name
+                  "Upstream CDR did not lock within " << timeout << " ms for endpoint at address 0x" << std::hex << ept_address, ///< Message
+                  ((uint16_t)ept_address)((uint32_t)timeout)                                                                     ///< Message parameters
+)
+
 ERS_DECLARE_ISSUE(timing,                                                                              ///< Namespace
                   MonitoredEndpointDead,                                                               ///< Issue class name
                   "Monitored endpoint at address 0x" << std::hex << ept_address << " did not respond", ///< Message
@@ -19,12 +19,28 @@
 
 // C++ Headers
 #include <chrono>
+#include <cstdint>
 #include <map>
 #include <string>
 #include <typeinfo>
+#include <vector>
 
 namespace dunedaq {
 namespace timing {
+
+/**
+ * @brief      Device timestamp with the host clocks read just before and after its dispatch.
+ */
+struct TimestampSample
+{
+  uint64_t timestamp = 0; // NOLINT(build/unsigned)
+  int64_t monotonic_before_ns = 0;
+  int64_t monotonic_after_ns = 0;
+  int64_t realtime_before_ns = 0;
+  int64_t realtime_after_ns = 0;
+  /// IPbus round trip of the dispatch, from the monotonic clock
+  int64_t round_trip_ns = 0;
+};
 /**
  * @brief      Base class for timing nodes.
  */
@@ -53,6 +69,19 @@ public:
                        uint32_t aValue = 0x0, // NOLINT(build/unsigned)
                        bool dispatch = true) const;
 
+  /**
+   * @brief     Read several timestamps in one dispatch, bracketed by host clock reads.
+   *
+   * Each path, relative to this node, is either a two word block, low
+   * word first, or a node with ts_l and ts_h registers.
+   */
+  std::vector<TimestampSample> sample_timestamps(const std::vector<std::string>& paths) const;
+
+  /**
+   * @brief     As above, for timestamp nodes anywhere on one board, i.e. sharing one client.
+   */
+  static std::vector<TimestampSample> sample_timestamps(const std::vector<const uhal::Node*>& timestamp_nodes);
+
 };
 
 } // namespace timing
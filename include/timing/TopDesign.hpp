@@ -14,6 +14,7 @@
 
 // PDT Headers
 #include "TimingIssues.hpp"
+#include "timing/DeviceTransactionScheduler.hpp"
 #include "timing/TopDesignInterface.hpp"
 
 #include "timing/timingfirmwareinfo/Structs.hpp"
@@ -90,8 +91,30 @@ public:
    */
   void get_info(timingfirmwareinfo::TimingDeviceInfo& mon_data) const override
   {
+    DeviceTransaction transaction(getClient(), kMonitoringTransaction);
     get_io_node_plain()->get_pll()->get_info(mon_data.pll_info);
   }
+
+  /**
+   * @brief    Register the PLL and the first SFP in the slow tier.
+   */
+  void register_monitoring(MonitoringScheduler& scheduler) const override
+  {
+    // config id and six status registers, each a page read and a register read
+    scheduler.add_task(kSlowMonitoring, "pll", 0, 28, [this](timingfirmwareinfo::TimingDeviceInfo& mon_data) {
+      get_io_node_plain()->get_pll()->get_info(mon_data.pll_info);
+    });
+    // id, vendor and DDM fields with their calibration constants, one I2C read each
+    scheduler.add_task(kSlowMonitoring, "sfp", 0, 24, [this](timingfirmwareinfo::TimingDeviceInfo& mon_data) {
+      try {
+        get_io_node_plain()->get_sfp_info(0, mon_data.sfp_info);
+      } catch (const std::exception& e) {
+        // boards may have no sfp fitted, it is reported as invalid data
+        mon_data.sfp_info.data_valid = false;
+        TLOG_DEBUG(2) << "Failed to read the SFP of " << getId() << ": " << e.what();
+      }
+    });
+  }
 };
 
 } // namespace timing
@@ -16,6 +16,8 @@
 #include "TimingIssues.hpp"
 #include "timing/TimingNode.hpp"
 #include "timing/IONode.hpp"
+#include "timing/MonitoringScheduler.hpp"
+#include "timing/OpMonDeltaEncoder.hpp"
 
 #include "timing/timingfirmwareinfo/Structs.hpp"
 #include "timing/timingfirmwareinfo/Nljs.hpp"
@@ -99,6 +101,25 @@ public:
    */
   virtual void get_info(timingfirmwareinfo::TimingDeviceInfo& mon_data) const = 0;
 
+  /**
+   * @brief    Collect the info and encode what changed since the previous call with the same encoder.
+   *
+   * @return   Message, or null if nothing changed and no keyframe is due
+   */
+  nlohmann::json get_info_delta(OpMonDeltaEncoder& encoder) const
+  {
+    timingfirmwareinfo::TimingDeviceInfo mon_data;
+    get_info(mon_data);
+    return encoder.encode_info(mon_data);
+  }
+
+  /**
+   * @brief    Register the get_info contributions with a monitoring scheduler, by tier.
+   *
+   * The design must outlive the scheduler.
+   */
+  virtual void register_monitoring(MonitoringScheduler& scheduler) const = 0;
+
 };
 
 } // namespace timing
@@ -173,6 +173,30 @@ get_milliseconds_since_epoch();
 int64_t
 get_seconds_since_epoch();
 
+/**
+ * @brief      Host realtime clock (CLOCK_REALTIME) in nanoseconds since the epoch.
+ */
+int64_t
+get_nanoseconds_since_epoch();
+
+/**
+ * @brief      Host monotonic clock (CLOCK_MONOTONIC) in nanoseconds.
+ */
+int64_t
+get_monotonic_nanoseconds();
+
+/**
+ * @brief      Convert nanoseconds since the epoch to clock ticks, without overflow.
+ */
+uint64_t // NOLINT(build/unsigned)
+nanoseconds_to_timestamp(int64_t nanoseconds, uint32_t clock_frequency_hz); // NOLINT(build/unsigned)
+
+/**
+ * @brief      Convert clock ticks to nanoseconds since the epoch, without overflow.
+ */
+int64_t
+timestamp_to_nanoseconds(uint64_t timestamp, uint32_t clock_frequency_hz); // NOLINT(build/unsigned)
+
 /**
  * ""
  * @return
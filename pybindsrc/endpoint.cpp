@@ -8,11 +8,17 @@
 
 #include "timing/CRTNode.hpp"
 #include "timing/EndpointNode.hpp"
+#include "timing/EndpointStateRecorder.hpp"
 #include "timing/HSINode.hpp"
 
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
+#include <chrono>
+#include <string>
+#include <tuple>
+#include <vector>
+
 namespace py = pybind11;
 
 namespace dunedaq {
@@ -27,7 +33,8 @@ register_endpoint(py::module& m)
     .def("disable", &timing::CRTNode::disable)
     .def("enable", py::overload_cast<uint32_t, FixedLengthCommandType>(&timing::CRTNode::enable, py::const_)) // NOLINT(build/unsigned)
     .def("get_status", &timing::CRTNode::get_status, py::arg("print_out") = false)
-    .def("read_last_pulse_timestamp", &timing::CRTNode::read_last_pulse_timestamp);
+    .def("read_last_pulse_timestamp", &timing::CRTNode::read_last_pulse_timestamp)
+    .def("sample_last_pulse_timestamp", &timing::CRTNode::sample_last_pulse_timestamp);
 
   py::class_<timing::HSINode, uhal::Node>(m, "HSINode")
     .def(py::init<const uhal::Node&>())
@@ -48,6 +55,13 @@ register_endpoint(py::module& m)
          &timing::HSINode::get_data_buffer_table,
          py::arg("read_all") = false,
          py::arg("print_out") = false)
+    .def("read_data_buffer_fused",
+         [](const timing::HSINode& hsi, uint32_t words_to_read) { // NOLINT(build/unsigned)
+           uint32_t buffer_state; // NOLINT(build/unsigned)
+           auto data = hsi.read_data_buffer_fused(words_to_read, buffer_state);
+           return std::make_pair(data.value(), buffer_state);
+         },
+         py::arg("words_to_read"))
     .def("read_buffer_warning", &timing::HSINode::reset_hsi)
     .def("read_buffer_error", &timing::HSINode::reset_hsi);
 
@@ -56,7 +70,63 @@ register_endpoint(py::module& m)
     .def("disable", &timing::EndpointNode::disable)
     .def("enable", &timing::EndpointNode::enable, py::arg("address") = 0, py::arg("partition") = 0)
     .def("reset", &timing::EndpointNode::reset, py::arg("address") = 0, py::arg("partition") = 0)
-    .def("get_status", &timing::EndpointNode::get_status, py::arg("print_out") = false);
+    .def("get_status", &timing::EndpointNode::get_status, py::arg("print_out") = false)
+    .def("sample_timestamp", &timing::EndpointNode::sample_timestamp);
+
+  py::class_<timing::EndpointStateRecorder>(m, "EndpointStateRecorder")
+    .def(py::init<size_t>(), py::arg("capacity") = 4096)
+    .def("add_endpoint",
+         &timing::EndpointStateRecorder::add_endpoint,
+         py::arg("name"),
+         py::arg("endpoint"),
+         py::keep_alive<1, 3>())
+    .def("set_period",
+         [](timing::EndpointStateRecorder& recorder, uint32_t period_us) { // NOLINT(build/unsigned)
+           recorder.set_period(std::chrono::microseconds(period_us));
+         },
+         py::arg("period_us"))
+    .def("sample", &timing::EndpointStateRecorder::sample)
+    .def("start", &timing::EndpointStateRecorder::start)
+    .def("stop", &timing::EndpointStateRecorder::stop, py::call_guard<py::gil_scoped_release>())
+    .def("get_transitions",
+         [](const timing::EndpointStateRecorder& recorder) {
+           // (endpoint, timestamp_ns, uncertainty_us, previous_state, state, previous_ready, ready, previous_duration_us)
+           // tuples, oldest first
+           std::vector<std::tuple<std::string, int64_t, uint64_t, uint32_t, uint32_t, bool, bool, uint64_t>> // NOLINT(build/unsigned)
+             transitions;
+           for (auto& t : recorder.get_transitions())
+             transitions.emplace_back(t.endpoint,
+                                      t.timestamp_ns,
+                                      t.uncertainty_us,
+                                      t.previous_state,
+                                      t.state,
+                                      t.previous_ready,
+                                      t.ready,
+                                      t.previous_duration_us);
+           return transitions;
+         })
+    .def("get_summaries",
+         [](const timing::EndpointStateRecorder& recorder) {
+           py::list summaries;
+           for (auto& s : recorder.get_summaries()) {
+             py::dict states;
+             for (auto& state : s.states)
+               states[py::int_(state.state)] = py::make_tuple(state.time_us, state.entries);
+
+             py::dict summary;
+             summary["endpoint"] = s.endpoint;
+             summary["state"] = s.state;
+             summary["ready"] = s.ready;
+             summary["transitions"] = s.transitions;
+             summary["not_ready_periods"] = s.not_ready_periods;
+             summary["not_ready_time_us"] = s.not_ready_time_us;
+             summary["longest_not_ready_us"] = s.longest_not_ready_us;
+             summary["states"] = states;
+             summaries.append(summary);
+           }
+           return summaries;
+         })
+    .def("clear", &timing::EndpointStateRecorder::clear);
 }
 
 } // namespace python
@@ -6,13 +6,22 @@
  * received with this code.
  */
 
+#include "timing/CommandCounterSampler.hpp"
+#include "timing/CommandLogReader.hpp"
+#include "timing/DTSClockMapper.hpp"
+#include "timing/EndpointNode.hpp"
+#include "timing/FLCmdRatePlanner.hpp"
 #include "timing/MasterNode.hpp"
+#include "timing/TimestampCoherenceChecker.hpp"
 #include "timing/UpstreamCDRNode.hpp"
 #include "timing/IRIGTimestampNode.hpp"
 
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
+#include <tuple>
+#include <vector>
+
 namespace py = pybind11;
 
 namespace dunedaq {
@@ -35,6 +44,13 @@ register_master(py::module& m)
          py::arg("command"),
          py::arg("channel"),
          py::arg("number_of_commands") = 1)
+    .def("send_fl_cmd_burst",
+         &timing::MasterNode::send_fl_cmd_burst,
+         py::arg("command"),
+         py::arg("channels"),
+         py::arg("number_of_commands"),
+         py::arg("readback_interval") = 0,
+         py::arg("commands_per_dispatch") = 256)
     .def<void (timing::MasterNode::*)(uint32_t, uint32_t, double, bool, uint32_t) const>("enable_periodic_fl_cmd",
          &timing::MasterNode::enable_periodic_fl_cmd,
          py::arg("command"),
@@ -46,12 +62,195 @@ register_master(py::module& m)
     .def("get_status", &timing::MasterNode::get_status, py::arg("print_out") = false)
     .def("get_status_with_date", &timing::MasterNode::get_status_with_date, py::arg("clock_frequency_hz"), py::arg("print_out") = false)
     .def("sync_timestamp", &timing::MasterNode::sync_timestamp, py::arg("source"))
+    .def("sync_timestamp_compensated", &timing::MasterNode::sync_timestamp_compensated, py::arg("clock_frequency_hz"))
+    .def("sample_timestamp", &timing::MasterNode::sample_timestamp)
     .def("disable_timestamp_broadcast", &timing::MasterNode::disable_timestamp_broadcast)
     .def("enable_timestamp_broadcast", &timing::MasterNode::enable_timestamp_broadcast)
-    .def("configure_endpoint_command_decoder", &timing::MasterNode::configure_endpoint_command_decoder,
+    .def("configure_endpoint_command_decoder",
+     py::overload_cast<uint16_t, uint8_t, uint8_t>(&timing::MasterNode::configure_endpoint_command_decoder, py::const_), // NOLINT(build/unsigned)
      py::arg("endpoint_address"),
      py::arg("slot"),
-     py::arg("command"));
+     py::arg("command"))
+    .def("configure_endpoint_command_decoder",
+     py::overload_cast<uint16_t, const std::map<uint8_t, uint8_t>&>(&timing::MasterNode::configure_endpoint_command_decoder, py::const_), // NOLINT(build/unsigned)
+     py::arg("endpoint_address"),
+     py::arg("slot_commands"))
+    .def("transmit_endpoint_commands", &timing::MasterNode::transmit_endpoint_commands, py::arg("commands"), py::arg("wait_for_reply") = true)
+    .def("measure_endpoint_rtt_statistics",
+         &timing::MasterNode::measure_endpoint_rtt_statistics,
+         py::arg("address"),
+         py::arg("number_of_samples") = 16,
+         py::arg("control_sfp") = true);
+
+  py::class_<timing::EchoDelayStatistics>(m, "EchoDelayStatistics")
+    .def_readonly("samples", &timing::EchoDelayStatistics::samples)
+    .def_readonly("min", &timing::EchoDelayStatistics::min)
+    .def_readonly("median", &timing::EchoDelayStatistics::median)
+    .def_readonly("max", &timing::EchoDelayStatistics::max)
+    .def_readonly("mean", &timing::EchoDelayStatistics::mean)
+    .def_readonly("stddev", &timing::EchoDelayStatistics::stddev)
+    .def_readonly("histogram", &timing::EchoDelayStatistics::histogram)
+    .def_readonly("unstable", &timing::EchoDelayStatistics::unstable);
+
+  py::class_<timing::TimestampSample>(m, "TimestampSample")
+    .def_readonly("timestamp", &timing::TimestampSample::timestamp)
+    .def_readonly("monotonic_before_ns", &timing::TimestampSample::monotonic_before_ns)
+    .def_readonly("monotonic_after_ns", &timing::TimestampSample::monotonic_after_ns)
+    .def_readonly("realtime_before_ns", &timing::TimestampSample::realtime_before_ns)
+    .def_readonly("realtime_after_ns", &timing::TimestampSample::realtime_after_ns)
+    .def_readonly("round_trip_ns", &timing::TimestampSample::round_trip_ns);
+
+  py::class_<timing::TimestampSyncResult>(m, "TimestampSyncResult")
+    .def_readonly("clock_frequency_hz", &timing::TimestampSyncResult::clock_frequency_hz)
+    .def_readonly("write_rtt_min_ns", &timing::TimestampSyncResult::write_rtt_min_ns)
+    .def_readonly("write_rtt_median_ns", &timing::TimestampSyncResult::write_rtt_median_ns)
+    .def_readonly("write_rtt_max_ns", &timing::TimestampSyncResult::write_rtt_max_ns)
+    .def_readonly("compensation_ns", &timing::TimestampSyncResult::compensation_ns)
+    .def_readonly("loaded_timestamp", &timing::TimestampSyncResult::loaded_timestamp)
+    .def_readonly("residual_ns", &timing::TimestampSyncResult::residual_ns)
+    .def_readonly("residual_uncertainty_ns", &timing::TimestampSyncResult::residual_uncertainty_ns);
+
+  py::class_<timing::EndpointCommandBuilder>(m, "EndpointCommandBuilder")
+    .def(py::init<uint16_t, bool>(), py::arg("endpoint_address"), py::arg("address_mode") = true) // NOLINT(build/unsigned)
+    .def("add_write", &timing::EndpointCommandBuilder::add_write, py::arg("reg_address"), py::arg("data"))
+    .def("add_read", &timing::EndpointCommandBuilder::add_read, py::arg("reg_address"), py::arg("data_length"))
+    .def("get_number_of_transactions", &timing::EndpointCommandBuilder::get_number_of_transactions)
+    .def("clear", &timing::EndpointCommandBuilder::clear);
+
+  py::class_<timing::CommandCounterSampler>(m, "CommandCounterSampler")
+    .def(py::init<const timing::MasterNode&>(), py::arg("node"), py::keep_alive<1, 2>())
+    .def(py::init<const timing::EndpointNode&>(), py::arg("node"), py::keep_alive<1, 2>())
+    .def("sample", &timing::CommandCounterSampler::sample)
+    .def("get_counts", &timing::CommandCounterSampler::get_counts)
+    .def("get_delta", &timing::CommandCounterSampler::get_delta)
+    .def("get_rate_mhz", &timing::CommandCounterSampler::get_rate_mhz)
+    .def("get_changed", &timing::CommandCounterSampler::get_changed)
+    .def("get_interval_us", &timing::CommandCounterSampler::get_interval_us)
+    .def("get_total_delta", &timing::CommandCounterSampler::get_total_delta);
+
+  py::class_<timing::CommandLogReader>(m, "CommandLogReader")
+    .def(py::init<const timing::MasterNode&, size_t, bool>(),
+         py::arg("master"),
+         py::arg("capacity") = 1024,
+         py::arg("read_counters") = true,
+         py::keep_alive<1, 2>())
+    .def("poll", py::overload_cast<>(&timing::CommandLogReader::poll))
+    .def("poll", py::overload_cast<uint64_t>(&timing::CommandLogReader::poll), py::arg("sent")) // NOLINT(build/unsigned)
+    .def("get_history",
+         [](const timing::CommandLogReader& reader) {
+           // (timestamp, command, missed_before) tuples, oldest first
+           std::vector<std::tuple<uint64_t, uint32_t, uint32_t>> history; // NOLINT(build/unsigned)
+           for (auto& entry : reader.get_history())
+             history.emplace_back(entry.timestamp, entry.command, entry.missed_before);
+           return history;
+         })
+    .def("clear", &timing::CommandLogReader::clear)
+    .def("get_number_of_missed", &timing::CommandLogReader::get_number_of_missed);
+
+  py::class_<timing::DTSClockFit>(m, "DTSClockFit")
+    .def_readonly("valid", &timing::DTSClockFit::valid)
+    .def_readonly("reference_monotonic_ns", &timing::DTSClockFit::reference_monotonic_ns)
+    .def_readonly("reference_timestamp", &timing::DTSClockFit::reference_timestamp)
+    .def_readonly("ticks_per_ns", &timing::DTSClockFit::ticks_per_ns)
+    .def_readonly("realtime_offset_ns", &timing::DTSClockFit::realtime_offset_ns)
+    .def_readonly("drift_ppm", &timing::DTSClockFit::drift_ppm)
+    .def_readonly("jitter_ns", &timing::DTSClockFit::jitter_ns)
+    .def_readonly("error_ns", &timing::DTSClockFit::error_ns)
+    .def_readonly("samples", &timing::DTSClockFit::samples);
+
+  py::class_<timing::DTSClockMapper>(m, "DTSClockMapper")
+    .def(py::init<const timing::MasterNode&, uint32_t, size_t>(), // NOLINT(build/unsigned)
+         py::arg("node"),
+         py::arg("clock_frequency_hz"),
+         py::arg("window") = 64,
+         py::keep_alive<1, 2>())
+    .def(py::init<const timing::EndpointNode&, uint32_t, size_t>(), // NOLINT(build/unsigned)
+         py::arg("node"),
+         py::arg("clock_frequency_hz"),
+         py::arg("window") = 64,
+         py::keep_alive<1, 2>())
+    .def(py::init<const timing::IRIGTimestampNode&, uint32_t, size_t>(), // NOLINT(build/unsigned)
+         py::arg("node"),
+         py::arg("clock_frequency_hz"),
+         py::arg("window") = 64,
+         py::keep_alive<1, 2>())
+    .def("sample", [](timing::DTSClockMapper& mapper) { mapper.sample(); })
+    .def("start",
+         [](timing::DTSClockMapper& mapper, uint32_t period_ms) { mapper.start(std::chrono::milliseconds(period_ms)); }, // NOLINT(build/unsigned)
+         py::arg("period_ms"))
+    .def("stop", &timing::DTSClockMapper::stop)
+    .def("get_fit", &timing::DTSClockMapper::get_fit)
+    .def("get_timestamp_at_monotonic", &timing::DTSClockMapper::get_timestamp_at_monotonic, py::arg("monotonic_ns"))
+    .def("get_timestamp_at_realtime", &timing::DTSClockMapper::get_timestamp_at_realtime, py::arg("realtime_ns"))
+    .def("get_monotonic_at_timestamp", &timing::DTSClockMapper::get_monotonic_at_timestamp, py::arg("timestamp"))
+    .def("get_realtime_at_timestamp", &timing::DTSClockMapper::get_realtime_at_timestamp, py::arg("timestamp"))
+    .def("get_timestamp_now", &timing::DTSClockMapper::get_timestamp_now);
+
+  py::class_<timing::TimestampCoherenceResult>(m, "TimestampCoherenceResult")
+    .def_readonly("name", &timing::TimestampCoherenceResult::name)
+    .def_readonly("sampled", &timing::TimestampCoherenceResult::sampled)
+    .def_readonly("timestamp", &timing::TimestampCoherenceResult::timestamp)
+    .def_readonly("offset_ns", &timing::TimestampCoherenceResult::offset_ns)
+    .def_readonly("uncertainty_ns", &timing::TimestampCoherenceResult::uncertainty_ns)
+    .def_readonly("round_trip_ns", &timing::TimestampCoherenceResult::round_trip_ns)
+    .def_readonly("in_tolerance", &timing::TimestampCoherenceResult::in_tolerance);
+
+  py::class_<timing::TimestampCoherenceChecker>(m, "TimestampCoherenceChecker")
+    .def(py::init<const timing::MasterNode&, uint32_t, int64_t>(), // NOLINT(build/unsigned)
+         py::arg("master"),
+         py::arg("clock_frequency_hz"),
+         py::arg("tolerance_ns"),
+         py::keep_alive<1, 2>())
+    .def("add_endpoint",
+         &timing::TimestampCoherenceChecker::add_endpoint,
+         py::arg("name"),
+         py::arg("endpoint"),
+         py::arg("cable_delay_ns") = 0,
+         py::keep_alive<1, 3>())
+    .def("check", &timing::TimestampCoherenceChecker::check, py::call_guard<py::gil_scoped_release>())
+    .def("start",
+         [](timing::TimestampCoherenceChecker& checker, uint32_t period_ms) { // NOLINT(build/unsigned)
+           checker.start(std::chrono::milliseconds(period_ms));
+         },
+         py::arg("period_ms"))
+    .def("stop", &timing::TimestampCoherenceChecker::stop, py::call_guard<py::gil_scoped_release>())
+    .def("get_last_results", &timing::TimestampCoherenceChecker::get_last_results);
+
+  py::class_<timing::FLCmdRatePlan>(m, "FLCmdRatePlan")
+    .def_readonly("requested_rate", &timing::FLCmdRatePlan::requested_rate)
+    .def_readonly("actual_rate", &timing::FLCmdRatePlan::actual_rate)
+    .def_readonly("relative_error", &timing::FLCmdRatePlan::relative_error)
+    .def_readonly("divisor", &timing::FLCmdRatePlan::divisor)
+    .def_readonly("prescale", &timing::FLCmdRatePlan::prescale)
+    .def_readonly("period", &timing::FLCmdRatePlan::period);
+
+  py::class_<timing::FLCmdChannelRequest>(m, "FLCmdChannelRequest")
+    .def(py::init<uint32_t, uint32_t, double, bool>(), // NOLINT(build/unsigned)
+         py::arg("channel"),
+         py::arg("command"),
+         py::arg("rate"),
+         py::arg("poisson"));
+
+  py::class_<timing::FLCmdChannelPlan>(m, "FLCmdChannelPlan")
+    .def_readonly("channel", &timing::FLCmdChannelPlan::channel)
+    .def_readonly("command", &timing::FLCmdChannelPlan::command)
+    .def_readonly("poisson", &timing::FLCmdChannelPlan::poisson)
+    .def_readonly("plan", &timing::FLCmdChannelPlan::plan);
+
+  py::class_<timing::FLCmdMultiChannelPlan>(m, "FLCmdMultiChannelPlan")
+    .def_readonly("channels", &timing::FLCmdMultiChannelPlan::channels)
+    .def_readonly("total_rate", &timing::FLCmdMultiChannelPlan::total_rate)
+    .def_readonly("load", &timing::FLCmdMultiChannelPlan::load)
+    .def_readonly("coincidence_rate", &timing::FLCmdMultiChannelPlan::coincidence_rate);
+
+  py::class_<timing::FLCmdRatePlanner>(m, "FLCmdRatePlanner")
+    .def(py::init<uint32_t>(), py::arg("clock_frequency_hz")) // NOLINT(build/unsigned)
+    .def<timing::FLCmdRatePlan (timing::FLCmdRatePlanner::*)(double) const>(
+      "plan", &timing::FLCmdRatePlanner::plan, py::arg("requested_rate"))
+    .def<timing::FLCmdMultiChannelPlan (timing::FLCmdRatePlanner::*)(const std::vector<timing::FLCmdChannelRequest>&) const>(
+      "plan", &timing::FLCmdRatePlanner::plan, py::arg("requests"))
+    .def("get_min_rate", &timing::FLCmdRatePlanner::get_min_rate)
+    .def("get_max_rate", &timing::FLCmdRatePlanner::get_max_rate);
 
   py::class_<timing::UpstreamCDRNode, uhal::Node>(m, "UpstreamCDRNode")
     .def(py::init<const uhal::Node&>())
@@ -62,6 +261,7 @@ register_master(py::module& m)
     .def(py::init<const uhal::Node&>())
     .def("get_status", &timing::IRIGTimestampNode::get_status, py::arg("print_out") = false)
     .def("set_irig_epoch", &timing::IRIGTimestampNode::set_irig_epoch, py::arg("irig_epoch"))
+    .def("sample_timestamp", &timing::IRIGTimestampNode::sample_timestamp)
     ;
 
 }
@@ -6,11 +6,21 @@
  * received with this code.
  */
 
+#include "timing/HardwareBroker.hpp"
+#include "timing/IssueThrottle.hpp"
+#include "timing/OperationProfiler.hpp"
+#include "timing/StatusCache.hpp"
 #include "timing/toolbox.hpp"
 
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
+#include <chrono>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
 namespace py = pybind11;
 
 namespace dunedaq {
@@ -21,6 +31,84 @@ void
 register_toolbox(py::module& m)
 {
   m.def("format_firmware_version", &timing::format_firmware_version);	
+
+  py::class_<timing::OperationStatistics>(m, "OperationStatistics")
+    .def_readonly("name", &timing::OperationStatistics::name)
+    .def_readonly("calls", &timing::OperationStatistics::calls)
+    .def_readonly("dispatches", &timing::OperationStatistics::dispatches)
+    .def_readonly("words_read", &timing::OperationStatistics::words_read)
+    .def_readonly("words_written", &timing::OperationStatistics::words_written)
+    .def_readonly("total_ns", &timing::OperationStatistics::total_ns)
+    .def_readonly("min_ns", &timing::OperationStatistics::min_ns)
+    .def_readonly("max_ns", &timing::OperationStatistics::max_ns)
+    .def_readonly("p50_ns", &timing::OperationStatistics::p50_ns)
+    .def_readonly("p90_ns", &timing::OperationStatistics::p90_ns)
+    .def_readonly("p99_ns", &timing::OperationStatistics::p99_ns);
+
+  py::class_<timing::OperationProfiler>(m, "OperationProfiler")
+    .def_static("get_statistics", &timing::OperationProfiler::get_statistics)
+    .def_static("reset", &timing::OperationProfiler::reset)
+    .def_static("set_enabled", &timing::OperationProfiler::set_enabled)
+    .def_static("is_enabled", &timing::OperationProfiler::is_enabled);
+
+  py::class_<timing::IssueThrottle, std::unique_ptr<timing::IssueThrottle, py::nodelete>>(m, "IssueThrottle")
+    .def_static("get", &timing::IssueThrottle::get, py::return_value_policy::reference)
+    .def("flush", &timing::IssueThrottle::flush)
+    .def("set_summary_interval",
+         [](timing::IssueThrottle& self, uint32_t interval_ms) { // NOLINT(build/unsigned)
+           self.set_summary_interval(std::chrono::milliseconds(interval_ms));
+         })
+    .def("set_enabled", &timing::IssueThrottle::set_enabled);
+
+  py::class_<timing::StatusCacheReader>(m, "StatusCacheReader")
+    .def(py::init<const std::string&>(), py::arg("device"))
+    .def("read",
+         [](const timing::StatusCacheReader& self) {
+           auto snapshot = self.read();
+           py::dict result;
+           result["version"] = snapshot.version;
+           result["published_realtime_ns"] = snapshot.published_realtime_ns;
+           result["data"] = py::module::import("json").attr("loads")(snapshot.data.dump());
+           return result;
+         })
+    .def("get_version", &timing::StatusCacheReader::get_version)
+    .def("get_writer_pid", &timing::StatusCacheReader::get_writer_pid)
+    .def("is_stale", &timing::StatusCacheReader::is_stale);
+
+  m.def("get_hardware_broker_path", &timing::get_hardware_broker_path);
+
+  py::class_<timing::HardwareBrokerClient>(m, "HardwareBrokerClient")
+    .def(py::init<const std::string&>(), py::arg("socket_path"))
+    .def("read",
+         py::overload_cast<const std::vector<std::string>&>(&timing::HardwareBrokerClient::read, py::const_),
+         py::arg("paths"))
+    .def("read", py::overload_cast<const std::string&>(&timing::HardwareBrokerClient::read, py::const_), py::arg("path"))
+    .def("read_block", &timing::HardwareBrokerClient::read_block, py::arg("path"), py::arg("size"))
+    .def("write",
+         py::overload_cast<const std::vector<std::pair<std::string, uint32_t>>&>( // NOLINT(build/unsigned)
+           &timing::HardwareBrokerClient::write,
+           py::const_),
+         py::arg("writes"))
+    .def("write",
+         py::overload_cast<const std::string&, uint32_t>(&timing::HardwareBrokerClient::write, py::const_), // NOLINT(build/unsigned)
+         py::arg("path"),
+         py::arg("value"))
+    .def("write_block", &timing::HardwareBrokerClient::write_block, py::arg("path"), py::arg("values"))
+    .def("transfer_i2c",
+         &timing::HardwareBrokerClient::transfer_i2c,
+         py::arg("bus"),
+         py::arg("i2c_device_address"),
+         py::arg("write_data"),
+         py::arg("number_of_bytes_to_read") = 0)
+    .def("transmit_async_packet",
+         &timing::HardwareBrokerClient::transmit_async_packet,
+         py::arg("packet"),
+         py::arg("timeout") = 500,
+         py::arg("master") = "master")
+    .def("get_status", &timing::HardwareBrokerClient::get_status, py::arg("path") = "")
+    .def("get_stats", [](const timing::HardwareBrokerClient& self) {
+      return py::module::import("json").attr("loads")(self.get_stats().dump());
+    });
 }
 
 } // namespace python
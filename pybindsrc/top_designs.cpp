@@ -6,9 +6,12 @@
  * received with this code.
  */
 
+#include "timing/BoardOrchestrator.hpp"
 #include "timing/BoreasDesign.hpp"
 #include "timing/ChronosDesign.hpp"
 #include "timing/CRTDesign.hpp"
+#include "timing/EndpointAlignmentDatabase.hpp"
+#include "timing/EndpointDelayAligner.hpp"
 #include "timing/FanoutDesign.hpp"
 #include "timing/OuroborosDesign.hpp"
 #include "timing/OuroborosMuxDesign.hpp"
@@ -19,12 +22,52 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
+#include <string>
+#include <tuple>
+#include <vector>
+
 namespace py = pybind11;
 
 namespace dunedaq {
 namespace timing {
 namespace python {
 
+namespace {
+
+std::vector<ActiveEndpointConfig>
+make_endpoint_configs(const std::vector<std::tuple<uint32_t, int32_t, uint32_t>>& endpoints) // NOLINT(build/unsigned)
+{
+  std::vector<ActiveEndpointConfig> configs;
+  for (auto& endpoint : endpoints)
+    configs.emplace_back(std::to_string(std::get<0>(endpoint)), std::get<0>(endpoint), std::get<1>(endpoint), std::get<2>(endpoint));
+  return configs;
+}
+
+py::list
+make_alignment_results(const timingfirmware::EndpointAlignmentResultVector& results)
+{
+  py::list list;
+  for (auto& r : results) {
+    py::dict result;
+    result["address"] = r.address;
+    result["alive"] = r.alive;
+    result["previous_coarse_delay"] = r.previous_coarse_delay;
+    result["previous_fine_delay"] = r.previous_fine_delay;
+    result["round_trip_time"] = r.round_trip_time;
+    result["round_trip_time_spread"] = r.round_trip_time_spread;
+    result["target_round_trip_time"] = r.target_round_trip_time;
+    result["coarse_delay"] = r.coarse_delay;
+    result["fine_delay"] = r.fine_delay;
+    result["round_trip_time_after_alignment"] = r.round_trip_time_after_alignment;
+    result["residual"] = r.residual;
+    result["aligned"] = r.aligned;
+    list.append(result);
+  }
+  return list;
+}
+
+} // namespace
+
 void
 register_top_designs(py::module& m)
 {
@@ -148,6 +191,12 @@ register_top_designs(py::module& m)
     .def("read_firmware_version", &timing::MasterDesign::read_firmware_version)
     .def("validate_firmware_version", &timing::MasterDesign::validate_firmware_version)
     .def("sync_timestamp", &timing::MasterDesign::sync_timestamp)
+    .def("sync_timestamp_compensated", &timing::MasterDesign::sync_timestamp_compensated)
+    .def("sample_timestamps",
+         [](const timing::MasterDesign& design, const std::vector<std::string>& paths) {
+           return design.sample_timestamps(paths);
+         },
+         py::arg("paths"))
     .def("get_status", &timing::MasterDesign::get_status)
     .def<void (timing::MasterDesign::*)(uint32_t, double, bool) const>("enable_periodic_fl_cmd",
          &timing::MasterDesign::enable_periodic_fl_cmd,
@@ -302,6 +351,114 @@ register_top_designs(py::module& m)
     .def("switch_cdr_mux", &timing::GaiaDesign::switch_cdr_mux, py::arg("mux"))
     .def("read_active_cdr_mux", &timing::GaiaDesign::read_active_cdr_mux)
     ;
+
+  // Orchestrator
+  py::enum_<timing::BoardRole>(m, "BoardRole")
+    .value("kMasterBoard", timing::kMasterBoard)
+    .value("kFanoutBoard", timing::kFanoutBoard)
+    .value("kEndpointBoard", timing::kEndpointBoard)
+    .export_values();
+
+  py::class_<timing::BoardResult>(m, "BoardResult")
+    .def_readonly("name", &timing::BoardResult::name)
+    .def_readonly("role", &timing::BoardResult::role)
+    .def_readonly("success", &timing::BoardResult::success)
+    .def_readonly("skipped", &timing::BoardResult::skipped)
+    .def_readonly("error", &timing::BoardResult::error)
+    .def_readonly("start_us", &timing::BoardResult::start_us)
+    .def_readonly("duration_us", &timing::BoardResult::duration_us)
+    .def_readonly("status", &timing::BoardResult::status);
+
+  py::class_<timing::OrchestrationResult>(m, "OrchestrationResult")
+    .def_readonly("boards", &timing::OrchestrationResult::boards)
+    .def_readonly("success", &timing::OrchestrationResult::success)
+    .def_readonly("duration_us", &timing::OrchestrationResult::duration_us);
+
+  py::class_<timing::BoardOrchestrator>(m, "BoardOrchestrator")
+    .def(py::init<size_t>(), py::arg("number_of_threads") = 0)
+    .def("add_board",
+         [](timing::BoardOrchestrator& self, const std::string& name, const uhal::Node& design, timing::BoardRole role) {
+           auto top_design = dynamic_cast<const timing::TopDesignInterface*>(&design);
+           if (!top_design)
+             throw py::type_error(name + " is not a timing top design");
+           self.add_board(name, *top_design, role);
+         },
+         py::arg("name"),
+         py::arg("design"),
+         py::arg("role"),
+         py::keep_alive<1, 3>())
+    .def("set_stop_on_failure", &timing::BoardOrchestrator::set_stop_on_failure)
+    .def("reset_io", &timing::BoardOrchestrator::reset_io, py::call_guard<py::gil_scoped_release>())
+    .def("configure", &timing::BoardOrchestrator::configure, py::call_guard<py::gil_scoped_release>())
+    .def("get_status", &timing::BoardOrchestrator::get_status, py::call_guard<py::gil_scoped_release>())
+    .def("get_number_of_boards", &timing::BoardOrchestrator::get_number_of_boards);
+
+  // endpoints are given as (address, fanout, mux) tuples, fanout -1 for endpoints on the master itself
+  py::class_<timing::EndpointDelayAligner>(m, "EndpointDelayAligner")
+    .def(py::init([](const uhal::Node& design,
+                     const std::vector<const uhal::Node*>& fanout_designs,
+                     uint32_t rtt_per_coarse_step, // NOLINT(build/unsigned)
+                     uint32_t fine_steps_per_rtt) { // NOLINT(build/unsigned)
+           auto master_design = dynamic_cast<const timing::MasterDesignInterface*>(&design);
+           if (!master_design)
+             throw py::type_error("design is not a timing master design");
+
+           std::vector<const timing::SFPMuxDesignInterface*> fanouts;
+           for (auto fanout : fanout_designs) {
+             auto fanout_design = dynamic_cast<const timing::SFPMuxDesignInterface*>(fanout);
+             if (!fanout_design)
+               throw py::type_error("fanout design has no sfp mux");
+             fanouts.push_back(fanout_design);
+           }
+
+           timing::EndpointDelayModel model;
+           model.rtt_per_coarse_step = rtt_per_coarse_step;
+           model.fine_steps_per_rtt = fine_steps_per_rtt;
+           return new timing::EndpointDelayAligner(*master_design, fanouts, model);
+         }),
+         py::arg("design"),
+         py::arg("fanout_designs"),
+         py::arg("rtt_per_coarse_step"),
+         py::arg("fine_steps_per_rtt"),
+         py::keep_alive<1, 2>(),
+         py::keep_alive<1, 3>())
+    .def("align",
+         [](const timing::EndpointDelayAligner& self,
+            const std::vector<std::tuple<uint32_t, int32_t, uint32_t>>& endpoints, // NOLINT(build/unsigned)
+            uint32_t number_of_samples,                                          // NOLINT(build/unsigned)
+            uint32_t tolerance) {                                                // NOLINT(build/unsigned)
+           auto configs = make_endpoint_configs(endpoints);
+           timingfirmware::EndpointAlignmentResultVector results;
+           {
+             py::gil_scoped_release release;
+             results = self.align(configs, number_of_samples, tolerance);
+           }
+           return make_alignment_results(results);
+         },
+         py::arg("endpoints"),
+         py::arg("number_of_samples") = 16,
+         py::arg("tolerance") = 0)
+    .def("align",
+         [](const timing::EndpointDelayAligner& self,
+            const std::vector<std::tuple<uint32_t, int32_t, uint32_t>>& endpoints, // NOLINT(build/unsigned)
+            const std::string& database_path,
+            uint32_t number_of_samples, // NOLINT(build/unsigned)
+            uint32_t tolerance,         // NOLINT(build/unsigned)
+            uint32_t drift_tolerance) { // NOLINT(build/unsigned)
+           auto configs = make_endpoint_configs(endpoints);
+           timingfirmware::EndpointAlignmentResultVector results;
+           {
+             py::gil_scoped_release release;
+             timing::EndpointAlignmentDatabase database(database_path);
+             results = self.align(configs, database, number_of_samples, tolerance, drift_tolerance);
+           }
+           return make_alignment_results(results);
+         },
+         py::arg("endpoints"),
+         py::arg("database_path"),
+         py::arg("number_of_samples") = 16,
+         py::arg("tolerance") = 0,
+         py::arg("drift_tolerance") = 1);
 } // NOLINT
 
 } // namespace python
@@ -0,0 +1,169 @@
+/**
+ * @file AsyncCommandPipeline.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "timing/AsyncCommandPipeline.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace timing {
+
+//-----------------------------------------------------------------------------
+AsyncCommandPipeline::AsyncCommandPipeline(const MasterNode& master, int reply_timeout)
+  : m_master(master)
+  , m_reply_timeout(reply_timeout)
+  , m_outstanding(0)
+  , m_stop(false)
+  , m_worker(&AsyncCommandPipeline::run, this)
+{}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+AsyncCommandPipeline::~AsyncCommandPipeline()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_request_cv.notify_all();
+  m_worker.join();
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+std::future<AsyncCommandResult>
+AsyncCommandPipeline::submit(const EndpointCommandBuilder& commands, bool wait_for_reply)
+{
+  Request request{ commands, wait_for_reply, std::chrono::steady_clock::now(), std::promise<AsyncCommandResult>() };
+  auto result = request.promise.get_future();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_requests.push_back(std::move(request));
+    ++m_outstanding;
+  }
+  m_request_cv.notify_one();
+  return result;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+AsyncCommandPipeline::flush()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_idle_cv.wait(lock, [this]() { return m_outstanding == 0; });
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+size_t
+AsyncCommandPipeline::get_number_of_outstanding() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_outstanding;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+AsyncCommandLatencyStats
+AsyncCommandPipeline::get_latency_stats() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_stats;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+AsyncCommandResult
+AsyncCommandPipeline::execute(Request& request) const
+{
+  AsyncCommandResult result;
+  result.endpoint_address = request.commands.get_endpoint_address();
+  result.data.resize(request.commands.get_number_of_transactions());
+
+  auto start = std::chrono::steady_clock::now();
+  result.queue_time = std::chrono::duration_cast<std::chrono::microseconds>(start - request.submitted);
+
+  for (auto& packet : request.commands.build_packets()) {
+    bool reply_expected = request.wait_for_reply || !packet.read_segments.empty();
+
+    packet.words.at(2) = MasterNode::get_next_async_sequence();
+    result.sequences.push_back(packet.words.at(2));
+
+    auto reply = m_master.transmit_async_packet(packet.words, reply_expected ? m_reply_timeout : -1);
+
+    // transmit_async_packet only returns the reply carrying the sequence of the packet, or throws
+    if (reply_expected)
+      request.commands.parse_reply(packet, reply, result.data);
+  }
+
+  result.service_time =
+    std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+  return result;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+AsyncCommandPipeline::run()
+{
+  while (true) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_request_cv.wait(lock, [this]() { return m_stop || !m_requests.empty(); });
+    if (m_requests.empty())
+      break;
+
+    Request request = std::move(m_requests.front());
+    m_requests.pop_front();
+    lock.unlock();
+
+    bool ok = false;
+    AsyncCommandResult result;
+    try {
+      result = execute(request);
+      ok = true;
+    } catch (...) {
+      TLOG_DEBUG(5) << "Async command for endpoint 0x" << std::hex << request.commands.get_endpoint_address()
+                    << " failed";
+      request.promise.set_exception(std::current_exception());
+    }
+
+    int64_t queue_us = 0;
+    int64_t service_us = 0;
+    if (ok) {
+      queue_us = result.queue_time.count();
+      service_us = result.service_time.count();
+      request.promise.set_value(std::move(result));
+    }
+
+    lock.lock();
+    if (ok) {
+      double n = ++m_stats.completed;
+      m_stats.mean_queue_us += (queue_us - m_stats.mean_queue_us) / n;
+      m_stats.mean_service_us += (service_us - m_stats.mean_service_us) / n;
+      m_stats.max_queue_us = std::max(m_stats.max_queue_us, queue_us);
+      m_stats.max_service_us = std::max(m_stats.max_service_us, service_us);
+      m_stats.min_service_us = m_stats.completed == 1 ? service_us : std::min(m_stats.min_service_us, service_us);
+    } else {
+      ++m_stats.failed;
+    }
+    --m_outstanding;
+    lock.unlock();
+
+    m_idle_cv.notify_all();
+  }
+}
+//-----------------------------------------------------------------------------
+
+} // namespace timing
+} // namespace dunedaq
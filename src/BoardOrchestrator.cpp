@@ -0,0 +1,143 @@
+/**
+ * @file BoardOrchestrator.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "timing/BoardOrchestrator.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dunedaq {
+namespace timing {
+
+//-----------------------------------------------------------------------------
+BoardOrchestrator::BoardOrchestrator(size_t number_of_threads)
+  : m_number_of_threads(number_of_threads)
+  , m_stop_on_failure(true)
+{}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+BoardOrchestrator::add_board(const std::string& name, const TopDesignInterface& design, BoardRole role)
+{
+  m_boards.push_back({ name, &design, role });
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+OrchestrationResult
+BoardOrchestrator::run(const Action& action, bool staged) const
+{
+  using Clock = std::chrono::steady_clock;
+  auto start = Clock::now();
+
+  OrchestrationResult result;
+  result.boards.resize(m_boards.size());
+
+  std::array<std::vector<size_t>, 3> stages;
+  for (size_t i = 0; i < m_boards.size(); ++i) {
+    result.boards.at(i).name = m_boards.at(i).name;
+    result.boards.at(i).role = m_boards.at(i).role;
+    stages.at(staged ? m_boards.at(i).role : 0).push_back(i);
+  }
+
+  bool stage_failed = false;
+  for (auto& stage : stages) {
+    if (stage.empty())
+      continue;
+
+    if (stage_failed && m_stop_on_failure) {
+      for (auto i : stage) {
+        result.boards.at(i).skipped = true;
+        result.boards.at(i).error = "Skipped after a failure in an earlier stage";
+      }
+      continue;
+    }
+
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+      for (size_t j = next++; j < stage.size(); j = next++) {
+        const Board& board = m_boards.at(stage.at(j));
+        BoardResult& board_result = result.boards.at(stage.at(j));
+
+        auto board_start = Clock::now();
+        try {
+          action(*board.design, board_result);
+          board_result.success = true;
+        } catch (const std::exception& e) {
+          board_result.error = e.what();
+        }
+        auto board_end = Clock::now();
+        board_result.start_us = std::chrono::duration_cast<std::chrono::microseconds>(board_start - start).count();
+        board_result.duration_us = std::chrono::duration_cast<std::chrono::microseconds>(board_end - board_start).count();
+      }
+    };
+
+    size_t number_of_threads = m_number_of_threads ? std::min(m_number_of_threads, stage.size()) : stage.size();
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < number_of_threads; ++t)
+      workers.emplace_back(worker);
+    for (auto& thread : workers)
+      thread.join();
+
+    for (auto i : stage) {
+      if (!result.boards.at(i).success) {
+        TLOG() << "Board " << result.boards.at(i).name << " failed: " << result.boards.at(i).error;
+        stage_failed = true;
+      }
+    }
+  }
+
+  result.success = !stage_failed;
+  result.duration_us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+  TLOG_DEBUG(2) << "Ran on " << m_boards.size() << " boards in " << result.duration_us << " us";
+  return result;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+OrchestrationResult
+BoardOrchestrator::reset_io(const ClockSource& clock_source) const
+{
+  return run([&clock_source](const TopDesignInterface& design, BoardResult&) { design.reset_io(clock_source); }, true);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+OrchestrationResult
+BoardOrchestrator::configure() const
+{
+  return run([](const TopDesignInterface& design, BoardResult&) { design.configure(); }, true);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+OrchestrationResult
+BoardOrchestrator::get_status() const
+{
+  return run([](const TopDesignInterface& design, BoardResult& result) { result.status = design.get_status(); }, false);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+OrchestrationResult
+BoardOrchestrator::get_info() const
+{
+  return run([](const TopDesignInterface& design, BoardResult& result) { design.get_info(result.info); }, false);
+}
+//-----------------------------------------------------------------------------
+
+} // namespace timing
+} // namespace dunedaq
@@ -7,6 +7,7 @@
  */
 
 #include "timing/BoreasDesign.hpp"
+#include "timing/DeviceTransactionScheduler.hpp"
 
 #include <sstream>
 #include <string>
@@ -64,8 +65,24 @@ BoreasDesign::configure() const
 void
 BoreasDesign::get_info(timingfirmwareinfo::TimingDeviceInfo& mon_data) const
 {
+  // one monitoring transaction, so that control operations wait for a consistent snapshot
+  DeviceTransaction transaction(getClient(), kMonitoringTransaction);
   MasterDesign::get_info(mon_data);
   HSIDesignInterface::get_info(mon_data);
 }
 //-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+BoreasDesign::register_monitoring(MonitoringScheduler& scheduler) const
+{
+  MasterDesign::register_monitoring(scheduler);
+  scheduler.add_task(kFastMonitoring, "endpoint", 2, 0, [this](timingfirmwareinfo::TimingDeviceInfo& mon_data) {
+    EndpointDesignInterface::get_info(0, mon_data.endpoint_info);
+  });
+  scheduler.add_task(kFastMonitoring, "hsi", 1, 0, [this](timingfirmwareinfo::TimingDeviceInfo& mon_data) {
+    HSIDesignInterface::get_info(mon_data.hsi_info);
+  });
+}
+//-----------------------------------------------------------------------------
 } // namespace dunedaq::timing
@@ -111,5 +111,13 @@ CRTNode::read_last_pulse_timestamp() const
 }
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+TimestampSample
+CRTNode::sample_last_pulse_timestamp() const
+{
+  return sample_timestamps({ "pulse" }).at(0);
+}
+//-----------------------------------------------------------------------------
+
 } // namespace timing
 } // namespace dunedaq
\ No newline at end of file
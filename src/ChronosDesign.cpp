@@ -7,6 +7,7 @@
  */
 
 #include "timing/ChronosDesign.hpp"
+#include "timing/DeviceTransactionScheduler.hpp"
 
 #include <sstream>
 #include <string>
@@ -56,8 +57,24 @@ ChronosDesign::configure() const
 void
 ChronosDesign::get_info(timingfirmwareinfo::TimingDeviceInfo& mon_data) const
 {
+  // one monitoring transaction, so that control operations wait for a consistent snapshot
+  DeviceTransaction transaction(getClient(), kMonitoringTransaction);
   TopDesign::get_info(mon_data);
   HSIDesignInterface::get_info(mon_data);
 }
 //-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+ChronosDesign::register_monitoring(MonitoringScheduler& scheduler) const
+{
+  TopDesign::register_monitoring(scheduler);
+  scheduler.add_task(kFastMonitoring, "endpoint", 2, 0, [this](timingfirmwareinfo::TimingDeviceInfo& mon_data) {
+    EndpointDesignInterface::get_info(0, mon_data.endpoint_info);
+  });
+  scheduler.add_task(kFastMonitoring, "hsi", 1, 0, [this](timingfirmwareinfo::TimingDeviceInfo& mon_data) {
+    HSIDesignInterface::get_info(mon_data.hsi_info);
+  });
+}
+//-----------------------------------------------------------------------------
 } // namespace dunedaq::timing
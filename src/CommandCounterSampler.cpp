@@ -0,0 +1,100 @@
+/**
+ * @file CommandCounterSampler.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "timing/CommandCounterSampler.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace dunedaq {
+namespace timing {
+
+//-----------------------------------------------------------------------------
+CommandCounterSampler::CommandCounterSampler(const TimingNode& node)
+  : m_node(node)
+  , m_number_of_counters(node.getNode("cmd_ctrs.data").getSize())
+  , m_counts(m_number_of_counters, 0)
+  , m_deltas(m_number_of_counters, 0)
+  , m_primed(false)
+  , m_interval_us(0)
+{
+  m_changed.reserve(m_number_of_counters);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+size_t
+CommandCounterSampler::sample()
+{
+  m_node.getNode("cmd_ctrs.addr").write(0x0);
+  auto counters = m_node.getNode("cmd_ctrs.data").readBlock(m_number_of_counters);
+  m_node.getClient().dispatch();
+
+  auto now = std::chrono::steady_clock::now();
+  m_interval_us = m_primed ? std::chrono::duration_cast<std::chrono::microseconds>(now - m_last_sample).count() : 0;
+  m_last_sample = now;
+
+  m_changed.clear();
+  for (size_t i = 0; i < m_number_of_counters; ++i) {
+    uint32_t counts = counters.at(i); // NOLINT(build/unsigned)
+    // a counter going down has been reset, everything it holds is new
+    m_deltas.at(i) = counts >= m_counts.at(i) ? counts - m_counts.at(i) : counts;
+    m_counts.at(i) = counts;
+    if (m_primed && m_deltas.at(i))
+      m_changed.push_back(i);
+  }
+
+  if (!m_primed) {
+    std::fill(m_deltas.begin(), m_deltas.end(), 0);
+    m_primed = true;
+  }
+  return m_changed.size();
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+uint64_t // NOLINT(build/unsigned)
+CommandCounterSampler::get_rate_mhz(uint32_t command) const // NOLINT(build/unsigned)
+{
+  if (!m_interval_us)
+    return 0;
+  // counts per us -> mHz, a 32 bit delta times 1e9 fits in 64 bits
+  return static_cast<uint64_t>(m_deltas.at(command)) * 1000000000ULL / m_interval_us; // NOLINT(build/unsigned)
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+uint64_t // NOLINT(build/unsigned)
+CommandCounterSampler::get_total_delta() const
+{
+  uint64_t total = 0; // NOLINT(build/unsigned)
+  for (auto command : m_changed)
+    total += m_deltas.at(command);
+  return total;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+CommandCounterSampler::get_info(timingendpointinfo::CommandCountersMonitorData& mon_data) const
+{
+  mon_data.interval_us = m_interval_us;
+  mon_data.changed.clear();
+  for (auto command : m_changed) {
+    timingendpointinfo::CommandCounterDelta delta;
+    delta.command = command;
+    delta.counts = m_counts.at(command);
+    delta.delta = m_deltas.at(command);
+    delta.rate_mhz = get_rate_mhz(command);
+    mon_data.changed.push_back(delta);
+  }
+}
+//-----------------------------------------------------------------------------
+
+} // namespace timing
+} // namespace dunedaq
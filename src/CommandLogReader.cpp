@@ -0,0 +1,205 @@
+/**
+ * @file CommandLogReader.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "timing/CommandLogReader.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace dunedaq {
+namespace timing {
+
+//-----------------------------------------------------------------------------
+CommandLogReader::CommandLogReader(const MasterNode& master, size_t capacity, bool read_counters)
+  : m_master(master)
+  , m_read_counters(read_counters)
+  , m_ring(std::max<size_t>(capacity, 1))
+  , m_next(0)
+  , m_size(0)
+  , m_primed(false)
+  , m_last_timestamp(0)
+  , m_uncaptured(0)
+  , m_logged_uncounted(false)
+  , m_polls(0)
+  , m_captured(0)
+  , m_missed(0)
+{}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+size_t
+CommandLogReader::poll()
+{
+  // counters first: every command they count was sent before the log is read
+  uhal::ValVector<uint32_t> counts; // NOLINT(build/unsigned)
+  if (m_read_counters) {
+    m_master.getNode("cmd_ctrs.addr").write(0x0);
+    counts = m_master.getNode("cmd_ctrs.data").readBlock(m_master.getNode("cmd_ctrs.data").getSize());
+  }
+  auto ts_l = m_master.getNode("cmd_log.tstamp_l").read();
+  auto ts_h = m_master.getNode("cmd_log.tstamp_h").read();
+  auto cmd = m_master.getNode("cmd_log.cmd").read();
+  m_master.getClient().dispatch();
+
+  uint64_t timestamp = static_cast<uint64_t>(ts_h.value()) << 32 | ts_l.value(); // NOLINT(build/unsigned)
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  // commands sent since the last poll, from the counters
+  uint64_t sent = 0; // NOLINT(build/unsigned)
+  if (m_read_counters) {
+    bool baseline = m_primed && m_last_counts.size() == counts.size();
+    m_last_counts.resize(counts.size());
+    for (size_t i = 0; i < counts.size(); ++i) {
+      uint32_t current = counts.at(i); // NOLINT(build/unsigned)
+      // a counter going down has been reset, everything it holds is new
+      if (baseline)
+        sent += current >= m_last_counts.at(i) ? current - m_last_counts.at(i) : current;
+      m_last_counts.at(i) = current;
+    }
+  }
+  return update(timestamp, cmd.value(), m_read_counters, sent);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+size_t
+CommandLogReader::poll(uint64_t sent) // NOLINT(build/unsigned)
+{
+  auto ts_l = m_master.getNode("cmd_log.tstamp_l").read();
+  auto ts_h = m_master.getNode("cmd_log.tstamp_h").read();
+  auto cmd = m_master.getNode("cmd_log.cmd").read();
+  m_master.getClient().dispatch();
+
+  uint64_t timestamp = static_cast<uint64_t>(ts_h.value()) << 32 | ts_l.value(); // NOLINT(build/unsigned)
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return update(timestamp, cmd.value(), true, sent);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+size_t
+CommandLogReader::update(uint64_t timestamp, // NOLINT(build/unsigned)
+                         uint32_t command,   // NOLINT(build/unsigned)
+                         bool counted,
+                         uint64_t sent)      // NOLINT(build/unsigned)
+{
+  ++m_polls;
+
+  if (!m_primed) {
+    m_primed = true;
+    m_last_timestamp = timestamp;
+    if (timestamp == 0)
+      return 0;
+    push({ timestamp, command, 0 });
+    ++m_captured;
+    return 1;
+  }
+
+  // a command logged by the previous poll, but sent after its counter read, is counted now and is not missed
+  if (m_logged_uncounted && sent) {
+    --sent;
+    m_logged_uncounted = false;
+  }
+  m_uncaptured += sent;
+
+  if (timestamp == m_last_timestamp)
+    return 0;
+
+  if (timestamp < m_last_timestamp)
+    TLOG_DEBUG(5) << "Command log timestamp went back from 0x" << std::hex << m_last_timestamp << " to 0x" << timestamp;
+
+  // the logged command is the last one counted, unless it was sent between the counter and the log reads
+  uint32_t missed = 0; // NOLINT(build/unsigned)
+  if (m_uncaptured)
+    missed = m_uncaptured - 1;
+  else if (counted)
+    m_logged_uncounted = true;
+  m_uncaptured = 0;
+  m_missed += missed;
+  ++m_captured;
+  m_last_timestamp = timestamp;
+
+  push({ timestamp, command, missed });
+  return 1;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+CommandLogReader::push(const timingfirmwareinfo::CommandLogEntry& entry)
+{
+  m_ring.at(m_next) = entry;
+  m_next = (m_next + 1) % m_ring.size();
+  m_size = std::min(m_size + 1, m_ring.size());
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+timingfirmwareinfo::CommandLogEntryVector
+CommandLogReader::get_history() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  timingfirmwareinfo::CommandLogEntryVector history;
+  history.reserve(m_size);
+  size_t first = (m_next + m_ring.size() - m_size) % m_ring.size();
+  for (size_t i = 0; i < m_size; ++i)
+    history.push_back(m_ring.at((first + i) % m_ring.size()));
+  return history;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+CommandLogReader::clear()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_next = 0;
+  m_size = 0;
+  m_primed = false;
+  m_last_timestamp = 0;
+  m_last_counts.clear();
+  m_uncaptured = 0;
+  m_logged_uncounted = false;
+  m_polls = 0;
+  m_captured = 0;
+  m_missed = 0;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+CommandLogReader::get_info(timingfirmwareinfo::CommandLogHistory& mon_data, size_t max_entries) const
+{
+  auto history = get_history();
+  if (history.size() > max_entries)
+    history.erase(history.begin(), history.end() - max_entries);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  mon_data.entries = history;
+  mon_data.polls = m_polls;
+  mon_data.captured = m_captured;
+  mon_data.missed = m_missed;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+uint64_t // NOLINT(build/unsigned)
+CommandLogReader::get_number_of_missed() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_missed;
+}
+//-----------------------------------------------------------------------------
+
+} // namespace timing
+} // namespace dunedaq
@@ -0,0 +1,341 @@
+/**
+ * @file DTSClockMapper.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "timing/DTSClockMapper.hpp"
+
+#include "timing/toolbox.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace timing {
+
+//-----------------------------------------------------------------------------
+DTSClockMapper::DTSClockMapper(std::function<TimestampSample()> reader,
+                               uint32_t clock_frequency_hz, // NOLINT(build/unsigned)
+                               size_t window)
+  : m_reader(std::move(reader))
+  , m_clock_frequency_hz(clock_frequency_hz)
+  , m_window(std::max<size_t>(window, 2))
+  , m_number_of_samples(0)
+  , m_number_of_failures(0)
+  , m_last_bracket_ns(0)
+  , m_fit_sequence(0)
+  , m_stop(false)
+{
+  publish(DTSClockFit());
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+DTSClockMapper::DTSClockMapper(const MasterNode& master, uint32_t clock_frequency_hz, size_t window) // NOLINT(build/unsigned)
+  : DTSClockMapper([&master]() { return master.sample_timestamp(); }, clock_frequency_hz, window)
+{}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+DTSClockMapper::DTSClockMapper(const EndpointNode& endpoint, uint32_t clock_frequency_hz, size_t window) // NOLINT(build/unsigned)
+  : DTSClockMapper([&endpoint]() { return endpoint.sample_timestamp(); }, clock_frequency_hz, window)
+{}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+DTSClockMapper::DTSClockMapper(const IRIGTimestampNode& irig, uint32_t clock_frequency_hz, size_t window) // NOLINT(build/unsigned)
+  : DTSClockMapper([&irig]() { return irig.sample_timestamp(); }, clock_frequency_hz, window)
+{}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+DTSClockMapper::~DTSClockMapper()
+{
+  stop();
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+TimestampSample
+DTSClockMapper::sample()
+{
+  TimestampSample sample;
+  try {
+    sample = m_reader();
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(m_sample_mutex);
+    ++m_number_of_failures;
+    throw;
+  }
+
+  std::lock_guard<std::mutex> lock(m_sample_mutex);
+  ++m_number_of_samples;
+  m_last_bracket_ns = sample.round_trip_ns;
+
+  // a timestamp going back means the board was resynchronised, the old samples no longer apply
+  if (!m_samples.empty() && sample.timestamp < m_samples.back().timestamp) {
+    TLOG_DEBUG(3) << "Timestamp went back from 0x" << std::hex << m_samples.back().timestamp << " to 0x"
+                  << sample.timestamp << ", restarting the clock fit";
+    m_samples.clear();
+  }
+
+  m_samples.push_back(sample);
+  while (m_samples.size() > m_window)
+    m_samples.pop_front();
+
+  fit();
+  return sample;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+DTSClockMapper::fit()
+{
+  DTSClockFit result;
+
+  // drop samples whose bracket is much wider than usual, their timestamp position is poorly known
+  std::vector<int64_t> brackets;
+  for (auto& sample : m_samples)
+    brackets.push_back(sample.round_trip_ns);
+  std::nth_element(brackets.begin(), brackets.begin() + brackets.size() / 2, brackets.end());
+  const int64_t median_bracket = brackets.at(brackets.size() / 2);
+
+  std::vector<const TimestampSample*> kept;
+  for (auto& sample : m_samples)
+    if (sample.round_trip_ns <= 2 * median_bracket)
+      kept.push_back(&sample);
+
+  const TimestampSample& last = m_samples.back();
+  result.realtime_offset_ns =
+    (last.realtime_before_ns + last.realtime_after_ns) / 2 - (last.monotonic_before_ns + last.monotonic_after_ns) / 2;
+  result.samples = kept.size();
+
+  if (kept.size() < 2) {
+    publish(result);
+    return;
+  }
+
+  // coordinates relative to the newest kept sample, small enough for doubles
+  const TimestampSample& reference = *kept.back();
+  const int64_t reference_monotonic = reference.monotonic_before_ns + (reference.monotonic_after_ns - reference.monotonic_before_ns) / 2;
+  std::vector<double> x, y;
+  for (auto sample : kept) {
+    x.push_back(sample->monotonic_before_ns + (sample->monotonic_after_ns - sample->monotonic_before_ns) / 2 - reference_monotonic);
+    y.push_back(static_cast<int64_t>(sample->timestamp - reference.timestamp));
+  }
+
+  // Theil-Sen: median of the pairwise slopes, then median intercept
+  std::vector<double> slopes;
+  slopes.reserve(x.size() * (x.size() - 1) / 2);
+  for (size_t i = 0; i < x.size(); ++i)
+    for (size_t j = i + 1; j < x.size(); ++j)
+      if (x.at(j) != x.at(i))
+        slopes.push_back((y.at(j) - y.at(i)) / (x.at(j) - x.at(i)));
+  if (slopes.empty()) {
+    publish(result);
+    return;
+  }
+  std::nth_element(slopes.begin(), slopes.begin() + slopes.size() / 2, slopes.end());
+  const double slope = slopes.at(slopes.size() / 2);
+  if (slope <= 0.) {
+    publish(result);
+    return;
+  }
+
+  std::vector<double> intercepts;
+  for (size_t i = 0; i < x.size(); ++i)
+    intercepts.push_back(y.at(i) - slope * x.at(i));
+  std::nth_element(intercepts.begin(), intercepts.begin() + intercepts.size() / 2, intercepts.end());
+  const double intercept = intercepts.at(intercepts.size() / 2);
+
+  // residuals in ns
+  std::vector<double> residuals;
+  double max_residual = 0.;
+  for (size_t i = 0; i < x.size(); ++i) {
+    double residual = std::fabs((y.at(i) - intercept - slope * x.at(i)) / slope);
+    residuals.push_back(residual);
+    max_residual = std::max(max_residual, residual);
+  }
+  std::nth_element(residuals.begin(), residuals.begin() + residuals.size() / 2, residuals.end());
+
+  result.valid = true;
+  result.reference_monotonic_ns = reference_monotonic;
+  result.reference_timestamp = reference.timestamp + static_cast<int64_t>(std::llround(intercept));
+  result.ticks_per_ns = slope;
+  result.drift_ppm = (slope * 1e9 / m_clock_frequency_hz - 1.) * 1e6;
+  result.jitter_ns = 1.4826 * residuals.at(residuals.size() / 2);
+  result.error_ns = max_residual + median_bracket / 2.;
+
+  publish(result);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+DTSClockMapper::publish(const DTSClockFit& fit)
+{
+  // single writer, serialised by the sample mutex
+  std::array<uint64_t, fit_words> words{}; // NOLINT(build/unsigned)
+  std::memcpy(words.data(), &fit, sizeof(DTSClockFit));
+
+  auto sequence = m_fit_sequence.load(std::memory_order_relaxed);
+  m_fit_sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (size_t i = 0; i < fit_words; ++i)
+    m_fit_words.at(i).store(words.at(i), std::memory_order_relaxed);
+  m_fit_sequence.store(sequence + 2, std::memory_order_release);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+DTSClockFit
+DTSClockMapper::get_fit() const
+{
+  std::array<uint64_t, fit_words> words; // NOLINT(build/unsigned)
+  while (true) {
+    auto before = m_fit_sequence.load(std::memory_order_acquire);
+    if (before & 0x1)
+      continue;
+    for (size_t i = 0; i < fit_words; ++i)
+      words.at(i) = m_fit_words.at(i).load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (m_fit_sequence.load(std::memory_order_relaxed) == before)
+      break;
+  }
+
+  DTSClockFit fit;
+  std::memcpy(static_cast<void*>(&fit), words.data(), sizeof(DTSClockFit));
+  return fit;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+DTSClockFit
+DTSClockMapper::get_valid_fit() const
+{
+  auto fit = get_fit();
+  if (!fit.valid)
+    throw ClockMappingNotReady(ERS_HERE, fit.samples);
+  return fit;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+uint64_t // NOLINT(build/unsigned)
+DTSClockMapper::get_timestamp_at_monotonic(int64_t monotonic_ns) const
+{
+  auto fit = get_valid_fit();
+  return fit.reference_timestamp + std::llround(fit.ticks_per_ns * (monotonic_ns - fit.reference_monotonic_ns));
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+uint64_t // NOLINT(build/unsigned)
+DTSClockMapper::get_timestamp_at_realtime(int64_t realtime_ns) const
+{
+  auto fit = get_valid_fit();
+  int64_t monotonic_ns = realtime_ns - fit.realtime_offset_ns;
+  return fit.reference_timestamp + std::llround(fit.ticks_per_ns * (monotonic_ns - fit.reference_monotonic_ns));
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+int64_t
+DTSClockMapper::get_monotonic_at_timestamp(uint64_t timestamp) const // NOLINT(build/unsigned)
+{
+  auto fit = get_valid_fit();
+  return fit.reference_monotonic_ns +
+         std::llround(static_cast<int64_t>(timestamp - fit.reference_timestamp) / fit.ticks_per_ns);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+int64_t
+DTSClockMapper::get_realtime_at_timestamp(uint64_t timestamp) const // NOLINT(build/unsigned)
+{
+  auto fit = get_valid_fit();
+  return fit.reference_monotonic_ns + fit.realtime_offset_ns +
+         std::llround(static_cast<int64_t>(timestamp - fit.reference_timestamp) / fit.ticks_per_ns);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+uint64_t // NOLINT(build/unsigned)
+DTSClockMapper::get_timestamp_now() const
+{
+  return get_timestamp_at_monotonic(get_monotonic_nanoseconds());
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+DTSClockMapper::start(std::chrono::milliseconds period)
+{
+  stop();
+  m_stop = false;
+  m_worker = std::thread(&DTSClockMapper::run, this, period);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+DTSClockMapper::stop()
+{
+  if (!m_worker.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(m_run_mutex);
+    m_stop = true;
+  }
+  m_run_cv.notify_all();
+  m_worker.join();
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+DTSClockMapper::run(std::chrono::milliseconds period)
+{
+  std::unique_lock<std::mutex> lock(m_run_mutex);
+  while (!m_stop) {
+    lock.unlock();
+    try {
+      sample();
+    } catch (const std::exception& e) {
+      ers::warning(ClockMappingSampleFailed(ERS_HERE, e.what()));
+    }
+    lock.lock();
+    m_run_cv.wait_for(lock, period, [this]() { return m_stop; });
+  }
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+DTSClockMapper::get_info(timingfirmwareinfo::DTSClockMapperMonitorData& mon_data) const
+{
+  auto fit = get_fit();
+  mon_data.valid = fit.valid;
+  mon_data.drift_ppm = fit.drift_ppm;
+  mon_data.jitter_ns = fit.jitter_ns;
+  mon_data.error_ns = fit.error_ns;
+  mon_data.fitted = fit.samples;
+
+  std::lock_guard<std::mutex> lock(m_sample_mutex);
+  mon_data.samples = m_number_of_samples;
+  mon_data.failures = m_number_of_failures;
+  mon_data.last_bracket_ns = m_last_bracket_ns;
+}
+//-----------------------------------------------------------------------------
+
+} // namespace timing
+} // namespace dunedaq
@@ -0,0 +1,262 @@
+/**
+ * @file DeviceTransactionScheduler.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "timing/DeviceTransactionScheduler.hpp"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+
+namespace dunedaq {
+namespace timing {
+
+namespace {
+
+// innermost transaction which holds a device on this thread
+thread_local DeviceTransaction* t_held_transactions = nullptr;
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+DeviceTransactionScheduler::DeviceTransactionScheduler()
+  : m_busy(false)
+  , m_waiting({ 0, 0 })
+  , m_waiting_control(0)
+  , m_mux_depth(0)
+  , m_yields(0)
+{}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+DeviceTransactionScheduler&
+DeviceTransactionScheduler::get(const uhal::ClientInterface& client)
+{
+  static std::mutex schedulers_mutex;
+  static std::map<const uhal::ClientInterface*, std::unique_ptr<DeviceTransactionScheduler>> schedulers;
+
+  std::lock_guard<std::mutex> lock(schedulers_mutex);
+  auto& scheduler = schedulers[&client];
+  if (!scheduler)
+    scheduler = std::make_unique<DeviceTransactionScheduler>();
+  return *scheduler;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+DeviceTransactionScheduler::wait_for_device(std::unique_lock<std::mutex>& lock, TransactionPriority priority)
+{
+  ++m_waiting.at(priority);
+  if (priority == kControlTransaction)
+    ++m_waiting_control;
+
+  m_cv.wait(lock, [this, priority]() {
+    return !m_busy && (priority == kControlTransaction || !m_waiting.at(kControlTransaction));
+  });
+
+  --m_waiting.at(priority);
+  if (priority == kControlTransaction)
+    --m_waiting_control;
+  m_busy = true;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+DeviceTransactionScheduler::acquire(TransactionPriority priority)
+{
+  auto start = Clock::now();
+  std::unique_lock<std::mutex> lock(m_mutex);
+  wait_for_device(lock, priority);
+
+  uint64_t wait_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count(); // NOLINT(build/unsigned)
+  auto& stats = m_stats.at(priority);
+  ++stats.transactions;
+  stats.total_wait_ns += wait_ns;
+  stats.max_wait_ns = std::max(stats.max_wait_ns, wait_ns);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+DeviceTransactionScheduler::release()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_busy = false;
+  }
+  m_cv.notify_all();
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+DeviceTransactionScheduler::yield()
+{
+  if (!has_waiting_control())
+    return;
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (!m_waiting.at(kControlTransaction))
+    return;
+
+  ++m_yields;
+  m_busy = false;
+  m_cv.notify_all();
+
+  // the time given away counts as monitoring wait, but not as a new transaction
+  auto start = Clock::now();
+  wait_for_device(lock, kMonitoringTransaction);
+  uint64_t wait_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count(); // NOLINT(build/unsigned)
+  auto& stats = m_stats.at(kMonitoringTransaction);
+  stats.total_wait_ns += wait_ns;
+  stats.max_wait_ns = std::max(stats.max_wait_ns, wait_ns);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+DeviceTransactionScheduler::acquire_mux(TransactionPriority priority)
+{
+  const auto this_thread = std::this_thread::get_id();
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  // the device is held, so another owner is a yielded transaction: let it finish with the mux
+  while (m_mux_depth && m_mux_owner != this_thread) {
+    m_busy = false;
+    m_cv.notify_all();
+    m_cv.wait(lock, [this]() { return !m_mux_depth; });
+    wait_for_device(lock, priority);
+  }
+
+  m_mux_owner = this_thread;
+  ++m_mux_depth;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+DeviceTransactionScheduler::release_mux()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (--m_mux_depth == 0)
+      m_mux_owner = std::thread::id();
+  }
+  m_cv.notify_all();
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+TransactionQueueStats
+DeviceTransactionScheduler::get_stats(TransactionPriority priority) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_stats.at(priority);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+uint64_t // NOLINT(build/unsigned)
+DeviceTransactionScheduler::get_number_of_yields() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_yields;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+DeviceTransactionScheduler::get_info(timingfirmwareinfo::DeviceTransactionSchedulerMonitorData& mon_data) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const auto& control = m_stats.at(kControlTransaction);
+  const auto& monitoring = m_stats.at(kMonitoringTransaction);
+  mon_data.control_transactions = control.transactions;
+  mon_data.control_wait_total_us = control.total_wait_ns / 1000;
+  mon_data.control_wait_max_us = control.max_wait_ns / 1000;
+  mon_data.monitoring_transactions = monitoring.transactions;
+  mon_data.monitoring_wait_total_us = monitoring.total_wait_ns / 1000;
+  mon_data.monitoring_wait_max_us = monitoring.max_wait_ns / 1000;
+  mon_data.yields = m_yields;
+  mon_data.waiting_control = m_waiting.at(kControlTransaction);
+  mon_data.waiting_monitoring = m_waiting.at(kMonitoringTransaction);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+DeviceTransaction::DeviceTransaction(const uhal::ClientInterface& client, TransactionPriority priority)
+  : DeviceTransaction(DeviceTransactionScheduler::get(client), priority)
+{}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+DeviceTransaction::DeviceTransaction(DeviceTransactionScheduler& scheduler, TransactionPriority priority)
+  : m_scheduler(nullptr)
+  , m_priority(priority)
+  , m_parent(nullptr)
+  , m_promoted(nullptr)
+{
+  for (auto held = t_held_transactions; held; held = held->m_parent) {
+    if (held->m_scheduler == &scheduler) {
+      // control nested in monitoring must not be yielded away
+      if (priority == kControlTransaction && held->m_priority == kMonitoringTransaction) {
+        held->m_priority = kControlTransaction;
+        m_promoted = held;
+      }
+      return;
+    }
+  }
+
+  scheduler.acquire(priority);
+  m_scheduler = &scheduler;
+  m_parent = t_held_transactions;
+  t_held_transactions = this;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+DeviceTransaction::~DeviceTransaction()
+{
+  if (m_promoted)
+    m_promoted->m_priority = kMonitoringTransaction;
+  if (!m_scheduler)
+    return;
+  t_held_transactions = m_parent;
+  m_scheduler->release();
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+DeviceTransaction::yield_point()
+{
+  for (auto held = t_held_transactions; held; held = held->m_parent)
+    if (held->m_priority == kMonitoringTransaction)
+      held->m_scheduler->yield();
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+DeviceMuxLock::DeviceMuxLock(const uhal::ClientInterface& client, TransactionPriority priority)
+  : m_transaction(client, priority)
+  , m_scheduler(DeviceTransactionScheduler::get(client))
+{
+  m_scheduler.acquire_mux(priority);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+DeviceMuxLock::~DeviceMuxLock()
+{
+  m_scheduler.release_mux();
+}
+//-----------------------------------------------------------------------------
+
+} // namespace timing
+} // namespace dunedaq
@@ -12,8 +12,11 @@
 #include "timing/toolbox.hpp"
 #include "logging/Logging.hpp"
 
-#include <string>
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
 
 namespace dunedaq {
 namespace timing {
@@ -91,5 +94,74 @@ EchoMonitorNode::send_echo_and_measure_delay(int64_t timeout) const
 }
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+EchoDelayStatistics
+EchoMonitorNode::measure_delay_statistics(uint32_t number_of_samples, uint32_t max_spread, int64_t timeout) const // NOLINT(build/unsigned)
+{
+  EchoDelayStatistics stats;
+  stats.samples.reserve(number_of_samples);
+
+  for (uint32_t i = 0; i < number_of_samples; ++i) { // NOLINT(build/unsigned)
+
+    getNode("csr.ctrl.go").write(0x1);
+    getClient().dispatch();
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    while (true) {
+
+      auto done = getNode("csr.stat.rx_done").read();
+      auto delta_t = getNode("csr.stat.deltat").read();
+      getClient().dispatch();
+
+      if (done.value()) {
+        if (delta_t.value() == 0xffff)
+          throw EchoReplyTimeout(ERS_HERE);
+
+        stats.samples.push_back(delta_t.value());
+        break;
+      }
+
+      auto now = std::chrono::high_resolution_clock::now();
+      auto ms_since_start = std::chrono::duration_cast<std::chrono::milliseconds>(now - start);
+
+      if (ms_since_start.count() > timeout)
+        throw EchoFlagTimeout(ERS_HERE, timeout);
+
+      std::this_thread::sleep_for(std::chrono::microseconds(10));
+    }
+  }
+
+  if (stats.samples.empty())
+    return stats;
+
+  std::vector<uint32_t> sorted(stats.samples); // NOLINT(build/unsigned)
+  std::sort(sorted.begin(), sorted.end());
+
+  stats.min = sorted.front();
+  stats.max = sorted.back();
+  stats.median = sorted.at(sorted.size() / 2);
+
+  double sum = 0.;
+  for (auto sample : sorted) {
+    sum += sample;
+    ++stats.histogram[sample];
+  }
+  stats.mean = sum / sorted.size();
+
+  double square_sum = 0.;
+  for (auto sample : sorted)
+    square_sum += (sample - stats.mean) * (sample - stats.mean);
+  stats.stddev = std::sqrt(square_sum / sorted.size());
+
+  stats.unstable = (stats.max - stats.min) > max_spread;
+
+  TLOG_DEBUG(4) << "delta t over " << sorted.size() << " echoes, min: " << stats.min << ", median: " << stats.median
+                << ", max: " << stats.max << ", stddev: " << stats.stddev;
+
+  return stats;
+}
+//-----------------------------------------------------------------------------
+
 } // namespace timing
 } // namespace dunedaq
\ No newline at end of file
@@ -0,0 +1,119 @@
+/**
+ * @file EndpointAlignmentDatabase.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "timing/EndpointAlignmentDatabase.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+namespace dunedaq {
+namespace timing {
+
+//-----------------------------------------------------------------------------
+EndpointAlignmentDatabase::EndpointAlignmentDatabase(const std::string& file_path)
+  : m_file_path(file_path)
+{
+  load();
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+EndpointAlignmentDatabase::load()
+{
+  m_records.clear();
+
+  std::ifstream file(m_file_path);
+  if (!file.is_open()) {
+    TLOG_DEBUG(3) << "No endpoint alignment database at " << m_file_path << ", starting empty";
+    return;
+  }
+
+  timingfirmware::EndpointAlignmentRecordVector records;
+  try {
+    auto content = nlohmann::json::parse(file);
+    if (content.at("version").get<uint32_t>() != format_version) // NOLINT(build/unsigned)
+      throw CorruptedFile(ERS_HERE, m_file_path);
+    records = content.at("records").get<timingfirmware::EndpointAlignmentRecordVector>();
+  } catch (const nlohmann::json::exception& e) {
+    TLOG_DEBUG(3) << "Failed to parse " << m_file_path << ": " << e.what();
+    throw CorruptedFile(ERS_HERE, m_file_path);
+  }
+
+  for (auto& record : records)
+    m_records[record.address] = record;
+
+  TLOG_DEBUG(3) << "Loaded " << m_records.size() << " endpoint alignment records from " << m_file_path;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+EndpointAlignmentDatabase::save() const
+{
+  nlohmann::json content;
+  content["version"] = format_version;
+  content["records"] = get_records();
+
+  // write a sibling file and rename it, so an interrupted save leaves the old database intact
+  std::string tmp_path = m_file_path + ".tmp";
+  {
+    std::ofstream file(tmp_path);
+    file << content.dump(2) << std::endl;
+    if (!file.good())
+      throw FileNotWritable(ERS_HERE, tmp_path);
+  }
+
+  if (std::rename(tmp_path.c_str(), m_file_path.c_str()) != 0)
+    throw FileNotWritable(ERS_HERE, m_file_path);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+const timingfirmware::EndpointAlignmentRecord*
+EndpointAlignmentDatabase::find(uint32_t address) const // NOLINT(build/unsigned)
+{
+  auto record = m_records.find(address);
+  return record == m_records.end() ? nullptr : &record->second;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+EndpointAlignmentDatabase::update(const timingfirmware::EndpointAlignmentRecord& record)
+{
+  m_records[record.address] = record;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+EndpointAlignmentDatabase::remove(uint32_t address) // NOLINT(build/unsigned)
+{
+  m_records.erase(address);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+timingfirmware::EndpointAlignmentRecordVector
+EndpointAlignmentDatabase::get_records() const
+{
+  timingfirmware::EndpointAlignmentRecordVector records;
+  for (auto& record : m_records)
+    records.push_back(record.second);
+  return records;
+}
+//-----------------------------------------------------------------------------
+
+} // namespace timing
+} // namespace dunedaq
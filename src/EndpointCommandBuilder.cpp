@@ -0,0 +1,163 @@
+/**
+ * @file EndpointCommandBuilder.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "timing/EndpointCommandBuilder.hpp"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace timing {
+
+//-----------------------------------------------------------------------------
+EndpointCommandBuilder::EndpointCommandBuilder(uint16_t endpoint_address, bool address_mode) // NOLINT(build/unsigned)
+  : m_endpoint_address(endpoint_address)
+  , m_address_mode(address_mode)
+{}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+EndpointCommandBuilder::validate_length(uint8_t reg_address, size_t length) const // NOLINT(build/unsigned)
+{
+  if (length == 0 || length > max_transaction_length)
+    throw InvalidVLCommandLength(ERS_HERE, length, reg_address);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+size_t
+EndpointCommandBuilder::add_write(uint8_t reg_address, const std::vector<uint8_t>& data) // NOLINT(build/unsigned)
+{
+  validate_length(reg_address, data.size());
+
+  if (m_address_mode && !m_transactions.empty()) {
+    auto& last = m_transactions.back();
+    if (last.write && last.reg_address + last.length == reg_address &&
+        last.length + data.size() <= max_transaction_length) {
+      last.data.insert(last.data.end(), data.begin(), data.end());
+      last.length = last.data.size();
+      return m_transactions.size() - 1;
+    }
+  }
+
+  m_transactions.push_back({ true, reg_address, static_cast<uint8_t>(data.size()), data }); // NOLINT(build/unsigned)
+  return m_transactions.size() - 1;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+size_t
+EndpointCommandBuilder::add_read(uint8_t reg_address, uint8_t data_length) // NOLINT(build/unsigned)
+{
+  validate_length(reg_address, data_length);
+  m_transactions.push_back({ false, reg_address, data_length, {} });
+  return m_transactions.size() - 1;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+bool
+EndpointCommandBuilder::has_reads() const
+{
+  return std::any_of(m_transactions.begin(), m_transactions.end(), [](const Transaction& t) { return !t.write; });
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+std::vector<EndpointCommandPacket>
+EndpointCommandBuilder::build_packets(uint8_t sequence) const // NOLINT(build/unsigned)
+{
+  std::vector<EndpointCommandPacket> packets;
+
+  uint32_t rx_words = 0; // NOLINT(build/unsigned)
+
+  auto start_packet = [&]() {
+    EndpointCommandPacket packet;
+    packet.words = { static_cast<uint32_t>(m_endpoint_address & 0xff), // NOLINT(build/unsigned)
+                     static_cast<uint32_t>(m_endpoint_address >> 8UL), // NOLINT(build/unsigned)
+                     sequence };
+    packets.push_back(packet);
+    rx_words = packet_header_words;
+  };
+
+  start_packet();
+
+  for (size_t i = 0; i < m_transactions.size(); ++i) {
+    auto& transaction = m_transactions.at(i);
+
+    uint32_t done = 0; // NOLINT(build/unsigned)
+    while (done < transaction.length) {
+      // room for the two transaction words plus at least one word of payload
+      uint32_t tx_free = max_packet_words - packets.back().words.size(); // NOLINT(build/unsigned)
+      uint32_t rx_free = max_packet_words - rx_words;                    // NOLINT(build/unsigned)
+      if (tx_free < 3 || (!transaction.write && rx_free < 1)) {
+        start_packet();
+        continue;
+      }
+
+      uint32_t chunk = transaction.length - done; // NOLINT(build/unsigned)
+      chunk = std::min(chunk, transaction.write ? tx_free - 2 : rx_free);
+
+      // without auto-increment every chunk targets the same register
+      uint32_t reg_address = m_address_mode ? transaction.reg_address + done : transaction.reg_address; // NOLINT(build/unsigned)
+
+      auto& words = packets.back().words;
+      if (transaction.write) {
+        // bit 7 = 1 -> write
+        words.push_back((0x1 << 7UL) | reg_address);
+        words.push_back((static_cast<uint32_t>(m_address_mode) << 7UL) | (0x3f & chunk)); // NOLINT(build/unsigned)
+        words.insert(words.end(), transaction.data.begin() + done, transaction.data.begin() + done + chunk);
+      } else {
+        // bit 7 = 0 -> read
+        words.push_back(reg_address);
+        words.push_back((static_cast<uint32_t>(m_address_mode) << 7UL) | (0x3f & chunk)); // NOLINT(build/unsigned)
+        packets.back().read_segments.push_back(std::make_pair(i, chunk));
+        rx_words += chunk;
+      }
+      done += chunk;
+    }
+  }
+
+  // drop a trailing empty packet and flag the last word of each packet
+  if (packets.back().words.size() == packet_header_words)
+    packets.pop_back();
+
+  for (auto& packet : packets)
+    packet.words.back() = packet.words.back() | (0x1 << 8UL);
+
+  return packets;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+EndpointCommandBuilder::parse_reply(const EndpointCommandPacket& packet,
+                                    const std::vector<uint32_t>& reply,                 // NOLINT(build/unsigned)
+                                    std::vector<std::vector<uint32_t>>& results) const // NOLINT(build/unsigned)
+{
+  results.resize(m_transactions.size());
+
+  size_t offset = packet_header_words;
+  for (auto& segment : packet.read_segments) {
+    if (offset + segment.second > reply.size())
+      throw InvalidVLCommandReplyLength(ERS_HERE, reply.size(), offset + segment.second);
+
+    auto& result = results.at(segment.first);
+    for (size_t i = 0; i < segment.second; ++i) {
+      // strip off the bit 8 which is high for the last byte
+      result.push_back(reply.at(offset + i) & 0xff);
+    }
+    offset += segment.second;
+  }
+}
+//-----------------------------------------------------------------------------
+
+} // namespace timing
+} // namespace dunedaq
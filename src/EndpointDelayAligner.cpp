@@ -0,0 +1,438 @@
+/**
+ * @file EndpointDelayAligner.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "timing/EndpointDelayAligner.hpp"
+
+#include "timing/AsyncCommandPipeline.hpp"
+#include "timing/EndpointCommandBuilder.hpp"
+#include "timing/IssueThrottle.hpp"
+#include "timing/MasterGlobalNode.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace timing {
+
+namespace {
+
+// dead endpoints are throttled per device and address
+std::string
+get_issue_context(const uhal::Node& master, uint32_t address) // NOLINT(build/unsigned)
+{
+  return master.getClient().uri() + " " + std::to_string(address);
+}
+
+// the results are indexed like the endpoints until the end, where the inactive ones are dropped
+timingfirmware::EndpointAlignmentResultVector
+get_active_results(const std::vector<ActiveEndpointConfig>& endpoints,
+                   const timingfirmware::EndpointAlignmentResultVector& results)
+{
+  timingfirmware::EndpointAlignmentResultVector active_results;
+  for (size_t i = 0; i < endpoints.size(); ++i) {
+    if (endpoints.at(i).active)
+      active_results.push_back(results.at(i));
+  }
+  return active_results;
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+EndpointDelayAligner::EndpointDelayAligner(const MasterDesignInterface& master_design,
+                                           const std::vector<const SFPMuxDesignInterface*>& fanout_designs,
+                                           const EndpointDelayModel& model)
+  : m_master_design(master_design)
+  , m_master(master_design.get_master_node<MasterNode>())
+  , m_master_mux(dynamic_cast<const SFPMuxDesignInterface*>(&master_design))
+  , m_fanout_designs(fanout_designs)
+  , m_model(model)
+{
+  if (!m_master)
+    throw EndpointAlignmentFailed(ERS_HERE, "master design has no MasterNode");
+  if (!m_model.rtt_per_coarse_step || !m_model.fine_steps_per_rtt)
+    throw EndpointAlignmentFailed(ERS_HERE, "the delay model needs both the coarse and the fine delay ratio");
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+EndpointDelayAligner::select_path(const ActiveEndpointConfig& endpoint) const
+{
+  if (endpoint.fanout >= 0) {
+    if (static_cast<size_t>(endpoint.fanout) >= m_fanout_designs.size())
+      throw EndpointAlignmentFailed(ERS_HERE, "no fanout design for fanout " + std::to_string(endpoint.fanout));
+    m_fanout_designs.at(endpoint.fanout)->switch_downstream_mux_channel(endpoint.mux, true);
+  } else if (m_master_mux) {
+    m_master_mux->switch_downstream_mux_channel(endpoint.mux, false);
+  }
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+EchoDelayStatistics
+EndpointDelayAligner::measure(const ActiveEndpointConfig& endpoint,
+                              timingfirmware::EndpointAlignmentResult& result,
+                              uint32_t number_of_samples) const // NOLINT(build/unsigned)
+{
+  result.address = endpoint.adr;
+  result.fanout = endpoint.fanout;
+  result.mux = endpoint.mux;
+
+  EchoDelayStatistics stats;
+  try {
+    select_path(endpoint);
+    m_master->switch_endpoint_sfp(endpoint.adr, true);
+    try {
+      auto global = m_master->getNode<MasterGlobalNode>("global");
+      global.wait_for_upstream_cdr_lock();
+      global.enable_upstream_endpoint();
+
+      // coarse delay and low nibble of fine delay, then the rest of the fine delay
+      auto delays = m_master->read_endpoint_data(endpoint.adr, 0x72, 0x2, true);
+      result.previous_coarse_delay = delays.at(0) & 0xf;
+      result.previous_fine_delay = ((delays.at(0) >> 4) & 0xf) | ((delays.at(1) & 0xff) << 4);
+
+      stats = m_master->measure_endpoint_rtt_statistics(endpoint.adr, number_of_samples, false);
+    } catch (const ers::Issue&) {
+      m_master->switch_endpoint_sfp(endpoint.adr, false);
+      throw;
+    }
+    m_master->switch_endpoint_sfp(endpoint.adr, false);
+    result.alive = true;
+    result.round_trip_time = stats.median;
+    result.round_trip_time_spread = stats.max - stats.min;
+  } catch (const ers::Issue& e) {
+    TLOG_DEBUG(5) << "RTT measurement of endpoint at address " << endpoint.adr << " failed: " << e.what();
+    result.alive = false;
+  }
+  return stats;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+bool
+EndpointDelayAligner::spot_check(const ActiveEndpointConfig& endpoint,
+                                 uint32_t& state,                 // NOLINT(build/unsigned)
+                                 uint32_t& round_trip_time) const // NOLINT(build/unsigned)
+{
+  try {
+    select_path(endpoint);
+    m_master->switch_endpoint_sfp(endpoint.adr, true);
+    try {
+      auto global = m_master->getNode<MasterGlobalNode>("global");
+      global.wait_for_upstream_cdr_lock();
+      global.enable_upstream_endpoint();
+      state = m_master->read_endpoint_data(endpoint.adr, 0x71, 0x1, true).at(0) & 0xf;
+      round_trip_time = m_master->measure_endpoint_rtt_statistics(endpoint.adr, 1, false).median;
+    } catch (const ers::Issue&) {
+      m_master->switch_endpoint_sfp(endpoint.adr, false);
+      throw;
+    }
+    m_master->switch_endpoint_sfp(endpoint.adr, false);
+  } catch (const ers::Issue& e) {
+    TLOG_DEBUG(5) << "Spot check of endpoint at address " << endpoint.adr << " failed: " << e.what();
+    return false;
+  }
+  return true;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+uint32_t // NOLINT(build/unsigned)
+EndpointDelayAligner::get_delay_round_trip_time(uint32_t coarse_delay, uint32_t fine_delay) const // NOLINT(build/unsigned)
+{
+  uint32_t fine_rtt = m_model.fine_steps_per_rtt ? fine_delay / m_model.fine_steps_per_rtt : 0; // NOLINT(build/unsigned)
+  return coarse_delay * m_model.rtt_per_coarse_step + fine_rtt;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+bool
+EndpointDelayAligner::subtract_applied_delays(timingfirmware::EndpointAlignmentResult& result,
+                                              EchoDelayStatistics& stats) const
+{
+  uint32_t applied_rtt = get_delay_round_trip_time(result.previous_coarse_delay, result.previous_fine_delay); // NOLINT(build/unsigned)
+
+  // a noisy sample or a delay model which does not match the firmware; the endpoint can not be solved for
+  if (stats.min < applied_rtt) {
+    ers::warning(InconsistentEndpointDelay(ERS_HERE, result.address, stats.min, applied_rtt));
+    result.alive = false;
+    return false;
+  }
+
+  result.round_trip_time -= applied_rtt;
+  stats.median -= applied_rtt;
+  stats.min -= applied_rtt;
+  stats.max -= applied_rtt;
+  return true;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+bool
+EndpointDelayAligner::compute_delays(timingfirmware::EndpointAlignmentResult& result, uint32_t target_rtt) const // NOLINT(build/unsigned)
+{
+  result.target_round_trip_time = target_rtt;
+
+  uint32_t required = target_rtt - result.round_trip_time;                 // NOLINT(build/unsigned)
+  uint32_t coarse_delay = required / m_model.rtt_per_coarse_step;           // NOLINT(build/unsigned)
+  uint32_t remainder = required % m_model.rtt_per_coarse_step;              // NOLINT(build/unsigned)
+  uint32_t fine_delay = remainder * m_model.fine_steps_per_rtt;            // NOLINT(build/unsigned)
+
+  if (coarse_delay > m_model.max_coarse_delay || fine_delay > m_model.max_fine_delay) {
+    ers::warning(EndpointDelayOutOfRange(ERS_HERE, result.address, required));
+    return false;
+  }
+
+  result.coarse_delay = coarse_delay;
+  result.fine_delay = fine_delay;
+  return true;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+EndpointDelayAligner::apply_delays(const std::vector<ActiveEndpointConfig>& endpoints,
+                                   const timingfirmware::EndpointAlignmentResultVector& results,
+                                   const std::vector<size_t>& selection) const
+{
+  // group the endpoints by path, so that each mux is switched once
+  std::map<std::pair<int32_t, uint32_t>, std::vector<size_t>> paths; // NOLINT(build/unsigned)
+  for (auto i : selection) {
+    if (results.at(i).coarse_delay >= 0)
+      paths[std::make_pair(endpoints.at(i).fanout, endpoints.at(i).mux)].push_back(i);
+  }
+
+  AsyncCommandPipeline pipeline(*m_master);
+  for (auto& path : paths) {
+    select_path(endpoints.at(path.second.front()));
+
+    for (auto i : path.second) {
+      EndpointCommandBuilder commands(endpoints.at(i).adr);
+      MasterNode::add_endpoint_delay_commands(commands, results.at(i).coarse_delay, results.at(i).fine_delay);
+      pipeline.submit(commands, false);
+    }
+    // the mux must not move under packets still in flight
+    pipeline.flush();
+  }
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+EndpointDelayAligner::verify(const std::vector<ActiveEndpointConfig>& endpoints,
+                             timingfirmware::EndpointAlignmentResultVector& results,
+                             const std::vector<size_t>& selection,
+                             uint32_t number_of_samples, // NOLINT(build/unsigned)
+                             uint32_t tolerance) const   // NOLINT(build/unsigned)
+{
+  for (auto i : selection) {
+    auto& result = results.at(i);
+    if (result.coarse_delay < 0)
+      continue;
+
+    timingfirmware::EndpointAlignmentResult after;
+    measure(endpoints.at(i), after, number_of_samples);
+    if (!after.alive) {
+      result.aligned = false;
+      continue;
+    }
+
+    result.round_trip_time_after_alignment = after.round_trip_time;
+    result.residual = after.round_trip_time - result.target_round_trip_time;
+    result.aligned = static_cast<uint32_t>(std::abs(result.residual)) <= tolerance; // NOLINT(build/unsigned)
+
+    TLOG_DEBUG(4) << "Endpoint at address " << result.address << " aligned to " << result.round_trip_time_after_alignment
+                  << ", residual: " << result.residual;
+  }
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+timingfirmware::EndpointAlignmentResultVector
+EndpointDelayAligner::align(const std::vector<ActiveEndpointConfig>& endpoints,
+                            uint32_t number_of_samples, // NOLINT(build/unsigned)
+                            uint32_t tolerance) const   // NOLINT(build/unsigned)
+{
+  timingfirmware::EndpointAlignmentResultVector results(endpoints.size());
+
+  int32_t target_rtt = -1;
+  for (size_t i = 0; i < endpoints.size(); ++i) {
+    if (!endpoints.at(i).active)
+      continue;
+    auto& result = results.at(i);
+    auto stats = measure(endpoints.at(i), result, number_of_samples);
+    if (!result.alive) {
+      IssueThrottle::get().warning(MonitoredEndpointDead(ERS_HERE, endpoints.at(i).adr), get_issue_context(*m_master, endpoints.at(i).adr));
+      continue;
+    }
+
+    // delays are written as absolute values, so they are solved for the round trip time without the current ones
+    if (!subtract_applied_delays(result, stats))
+      continue;
+    target_rtt = std::max(target_rtt, result.round_trip_time);
+  }
+
+  if (target_rtt < 0)
+    throw EndpointAlignmentFailed(ERS_HERE, "no endpoint responded");
+
+  TLOG() << "Aligning endpoints to a round trip time of " << target_rtt;
+
+  std::vector<size_t> selection;
+  for (size_t i = 0; i < results.size(); ++i) {
+    if (results.at(i).alive && compute_delays(results.at(i), target_rtt))
+      selection.push_back(i);
+  }
+
+  apply_delays(endpoints, results, selection);
+  verify(endpoints, results, selection, number_of_samples, tolerance);
+
+  return get_active_results(endpoints, results);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+timingfirmware::EndpointAlignmentResultVector
+EndpointDelayAligner::align(const std::vector<ActiveEndpointConfig>& endpoints,
+                            EndpointAlignmentDatabase& database,
+                            uint32_t number_of_samples, // NOLINT(build/unsigned)
+                            uint32_t tolerance,         // NOLINT(build/unsigned)
+                            uint32_t drift_tolerance) const // NOLINT(build/unsigned)
+{
+  timingfirmware::EndpointAlignmentResultVector results(endpoints.size());
+  std::vector<EchoDelayStatistics> stats(endpoints.size());
+  std::vector<bool> measured(endpoints.size(), false);
+
+  size_t unchanged = 0;
+  for (size_t i = 0; i < endpoints.size(); ++i) {
+    auto& endpoint = endpoints.at(i);
+    auto& result = results.at(i);
+    if (!endpoint.active)
+      continue;
+
+    result.address = endpoint.adr;
+    result.fanout = endpoint.fanout;
+    result.mux = endpoint.mux;
+
+    auto record = database.find(endpoint.adr);
+    if (record && record->fanout == endpoint.fanout && record->mux == endpoint.mux && record->coarse_delay >= 0) {
+      uint32_t state = 0; // NOLINT(build/unsigned)
+      uint32_t rtt = 0;   // NOLINT(build/unsigned)
+      if (!spot_check(endpoint, state, rtt)) {
+        IssueThrottle::get().warning(MonitoredEndpointDead(ERS_HERE, endpoint.adr), get_issue_context(*m_master, endpoint.adr));
+        continue;
+      }
+
+      bool link_ok = state == 0x7 || state == 0x8;
+      int32_t drift = static_cast<int32_t>(rtt) - record->target_round_trip_time;
+      if (link_ok && static_cast<uint32_t>(std::abs(drift)) <= drift_tolerance) { // NOLINT(build/unsigned)
+        result.alive = true;
+        result.round_trip_time = record->round_trip_time;
+        result.round_trip_time_spread = record->round_trip_time_max - record->round_trip_time_min;
+        result.target_round_trip_time = record->target_round_trip_time;
+        result.coarse_delay = record->coarse_delay;
+        result.fine_delay = record->fine_delay;
+        result.round_trip_time_after_alignment = rtt;
+        result.residual = drift;
+        result.aligned = static_cast<uint32_t>(std::abs(drift)) <= tolerance; // NOLINT(build/unsigned)
+        ++unchanged;
+        continue;
+      }
+
+      TLOG_DEBUG(4) << "Endpoint at address " << endpoint.adr << " changed, state: 0x" << std::hex << state
+                    << std::dec << ", round trip time: " << rtt << ", stored target: " << record->target_round_trip_time;
+    }
+
+    stats.at(i) = measure(endpoint, result, number_of_samples);
+    if (!result.alive) {
+      IssueThrottle::get().warning(MonitoredEndpointDead(ERS_HERE, endpoint.adr), get_issue_context(*m_master, endpoint.adr));
+      continue;
+    }
+    // the delays in the endpoint are read back rather than taken from the record, which may be stale
+    if (!subtract_applied_delays(result, stats.at(i)))
+      continue;
+    measured.at(i) = true;
+  }
+
+  int32_t target_rtt = -1;
+  for (auto& result : results) {
+    if (result.alive)
+      target_rtt = std::max(target_rtt, result.round_trip_time);
+  }
+
+  if (target_rtt < 0)
+    throw EndpointAlignmentFailed(ERS_HERE, "no endpoint responded");
+
+  TLOG() << unchanged << " endpoints unchanged since the stored alignment, aligning to a round trip time of "
+         << target_rtt;
+
+  // re-measured endpoints need new delays, unchanged ones only if the target moved
+  std::vector<size_t> selection;
+  for (size_t i = 0; i < results.size(); ++i) {
+    auto& result = results.at(i);
+    if (!result.alive || (!measured.at(i) && result.target_round_trip_time == target_rtt))
+      continue;
+
+    result.coarse_delay = -1;
+    result.fine_delay = -1;
+    result.aligned = false;
+    if (compute_delays(result, target_rtt))
+      selection.push_back(i);
+  }
+
+  if (selection.empty())
+    return get_active_results(endpoints, results);
+
+  apply_delays(endpoints, results, selection);
+  verify(endpoints, results, selection, number_of_samples, tolerance);
+
+  uint64_t now = std::chrono::duration_cast<std::chrono::seconds>( // NOLINT(build/unsigned)
+                   std::chrono::system_clock::now().time_since_epoch())
+                   .count();
+
+  for (auto i : selection) {
+    auto& result = results.at(i);
+    if (!result.aligned)
+      continue;
+
+    auto previous = database.find(result.address);
+    timingfirmware::EndpointAlignmentRecord record;
+    if (previous)
+      record = *previous;
+
+    record.address = result.address;
+    record.fanout = result.fanout;
+    record.mux = result.mux;
+    if (measured.at(i)) {
+      record.round_trip_time = stats.at(i).median;
+      record.round_trip_time_min = stats.at(i).min;
+      record.round_trip_time_max = stats.at(i).max;
+      record.round_trip_time_stddev = stats.at(i).stddev;
+    }
+    record.target_round_trip_time = result.target_round_trip_time;
+    record.coarse_delay = result.coarse_delay;
+    record.fine_delay = result.fine_delay;
+    record.timestamp = now;
+    database.update(record);
+  }
+  database.save();
+
+  return get_active_results(endpoints, results);
+}
+//-----------------------------------------------------------------------------
+
+} // namespace timing
+} // namespace dunedaq
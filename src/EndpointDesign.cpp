@@ -7,6 +7,7 @@
  */
 
 #include "timing/EndpointDesign.hpp"
+#include "timing/DeviceTransactionScheduler.hpp"
 
 #include <sstream>
 #include <string>
@@ -87,7 +88,22 @@ EndpointDesign::validate_firmware_version() const
 void
 EndpointDesign::get_info(timingfirmwareinfo::TimingDeviceInfo& mon_data) const
 {
+  // one monitoring transaction, so that control operations wait for a consistent snapshot
+  DeviceTransaction transaction(getClient(), kMonitoringTransaction);
   TopDesign::get_info(mon_data);
   EndpointDesignInterface::get_info(0, mon_data.endpoint_info);
 }
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+EndpointDesign::register_monitoring(MonitoringScheduler& scheduler) const
+{
+  TopDesign::register_monitoring(scheduler);
+  scheduler.add_task(kFastMonitoring, "endpoint", 2, 0, [this](timingfirmwareinfo::TimingDeviceInfo& mon_data) {
+    EndpointDesignInterface::get_info(0, mon_data.endpoint_info);
+  });
+}
+//-----------------------------------------------------------------------------
+
 } // namespace dunedaq::timing  
@@ -7,10 +7,14 @@
  */
 
 #include "timing/EndpointNode.hpp"
+#include "timing/CommandCounterSampler.hpp"
+#include "timing/DeviceTransactionScheduler.hpp"
 #include "timing/toolbox.hpp"
 
 #include "logging/Logging.hpp"
 
+#include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
@@ -20,9 +24,24 @@ namespace timing {
 
 UHAL_REGISTER_DERIVED_NODE(EndpointNode)
 
+//-----------------------------------------------------------------------------
+struct EndpointNode::MonitoringState
+{
+  std::mutex mutex;
+  std::unique_ptr<CommandCounterSampler> command_counters;
+};
+
 //-----------------------------------------------------------------------------
 EndpointNode::EndpointNode(const uhal::Node& node)
   : EndpointNodeInterface(node)
+  , m_monitoring(new MonitoringState())
+{}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+EndpointNode::EndpointNode(const EndpointNode& other)
+  : EndpointNodeInterface(other)
+  , m_monitoring(new MonitoringState())
 {}
 //-----------------------------------------------------------------------------
 
@@ -153,10 +172,20 @@ EndpointNode::read_timestamp() const
 }
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+TimestampSample
+EndpointNode::sample_timestamp() const
+{
+  return sample_timestamps({ "tstamp" }).at(0);
+}
+//-----------------------------------------------------------------------------
+
 //-----------------------------------------------------------------------------
 void
 EndpointNode::get_info(timingendpointinfo::TimingEndpointInfo& mon_data) const
 {
+  DeviceTransaction transaction(getClient(), kMonitoringTransaction);
+
   auto timestamp = getNode("tstamp").readBlock(2);
   auto endpoint_control = read_sub_nodes(getNode("csr.ctrl"), false);
   auto endpoint_state = read_sub_nodes(getNode("csr.stat"), false);
@@ -167,6 +196,13 @@ EndpointNode::get_info(timingendpointinfo::TimingEndpointInfo& mon_data) const
   mon_data.address = endpoint_control.at("addr").value();
   mon_data.timestamp = tstamp2int(timestamp);
   mon_data.sfp_tx_disable = !endpoint_state.at("ep_txen").value();
+
+  // only the received command counters which changed since the last call are published
+  std::lock_guard<std::mutex> lock(m_monitoring->mutex);
+  if (!m_monitoring->command_counters)
+    m_monitoring->command_counters.reset(new CommandCounterSampler(*this));
+  m_monitoring->command_counters->sample();
+  m_monitoring->command_counters->get_info(mon_data.command_counters);
 }
 //-----------------------------------------------------------------------------
 
@@ -0,0 +1,372 @@
+/**
+ * @file EndpointStateRecorder.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "timing/EndpointStateRecorder.hpp"
+
+#include "timing/DeviceTransactionScheduler.hpp"
+#include "timing/toolbox.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace timing {
+
+namespace {
+
+uint32_t // NOLINT(build/unsigned)
+get_mask_shift(uint32_t mask) // NOLINT(build/unsigned)
+{
+  uint32_t shift = 0; // NOLINT(build/unsigned)
+  while (mask && !(mask & 0x1)) {
+    mask >>= 1;
+    ++shift;
+  }
+  return shift;
+}
+
+uint64_t // NOLINT(build/unsigned)
+get_elapsed_us(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to)
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+EndpointStateRecorder::EndpointStateRecorder(size_t capacity)
+  : m_period(500)
+  , m_ring(std::max<size_t>(capacity, 1))
+  , m_next(0)
+  , m_size(0)
+  , m_samples(0)
+  , m_late_samples(0)
+  , m_failed_reads(0)
+  , m_max_sample_us(0)
+  , m_transitions(0)
+  , m_overwritten_transitions(0)
+  , m_stop(false)
+{}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+EndpointStateRecorder::~EndpointStateRecorder()
+{
+  stop();
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+EndpointStateRecorder::add_endpoint(const std::string& name, const EndpointNodeInterface& endpoint)
+{
+  Endpoint record{};
+  record.name = name;
+  record.stat = &endpoint.getNode("csr.stat");
+  record.state_mask = endpoint.getNode("csr.stat.ep_stat").getMask();
+  record.state_shift = get_mask_shift(record.state_mask);
+  record.ready_mask = endpoint.getNode("csr.stat.ep_rdy").getMask();
+  record.primed = false;
+
+  // the devices are read by sample() outside m_mutex
+  std::lock_guard<std::mutex> sample_lock(m_sample_mutex);
+
+  // endpoints of one device are read in the same dispatch
+  auto client = &endpoint.getClient();
+  auto device = std::find_if(m_devices.begin(), m_devices.end(), [client](const Device& d) { return d.client == client; });
+  if (device == m_devices.end()) {
+    m_devices.push_back({ client, {}, {}, false, Clock::time_point() });
+    device = m_devices.end() - 1;
+  }
+  device->endpoints.push_back(m_endpoints.size());
+  device->words.resize(device->endpoints.size());
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_endpoints.push_back(record);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+size_t
+EndpointStateRecorder::sample()
+{
+  std::lock_guard<std::mutex> sample_lock(m_sample_mutex);
+  auto now = Clock::now();
+  auto now_ns = get_nanoseconds_since_epoch();
+
+  std::vector<bool> device_read(m_devices.size(), false);
+  size_t failed_reads = 0;
+  for (size_t d = 0; d < m_devices.size(); ++d) {
+    auto& device = m_devices.at(d);
+    try {
+      DeviceTransaction transaction(*device.client, kMonitoringTransaction);
+      for (size_t i = 0; i < device.endpoints.size(); ++i)
+        device.words.at(i) = m_endpoints.at(device.endpoints.at(i)).stat->read();
+      device.client->dispatch();
+      device_read.at(d) = true;
+    } catch (const std::exception& e) {
+      ++failed_reads;
+      TLOG_DEBUG(5) << "Failed to read endpoint states: " << e.what();
+    }
+  }
+
+  size_t transitions = 0;
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (size_t d = 0; d < m_devices.size(); ++d) {
+    if (!device_read.at(d))
+      continue;
+    auto& device = m_devices.at(d);
+    // the transitions happened at some point since the last successful read of their device
+    uint64_t uncertainty_us = device.sampled ? get_elapsed_us(device.last_sample, now) : 0; // NOLINT(build/unsigned)
+    for (size_t i = 0; i < device.endpoints.size(); ++i)
+      transitions +=
+        update(m_endpoints.at(device.endpoints.at(i)), device.words.at(i).value(), now, now_ns, uncertainty_us);
+    device.sampled = true;
+    device.last_sample = now;
+  }
+
+  ++m_samples;
+  m_failed_reads += failed_reads;
+  m_max_sample_us = std::max(m_max_sample_us, get_elapsed_us(now, Clock::now()));
+  return transitions;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+bool
+EndpointStateRecorder::update(Endpoint& endpoint,
+                              uint32_t word, // NOLINT(build/unsigned)
+                              Clock::time_point now,
+                              int64_t now_ns,
+                              uint64_t uncertainty_us) // NOLINT(build/unsigned)
+{
+  uint32_t state = (word & endpoint.state_mask) >> endpoint.state_shift; // NOLINT(build/unsigned)
+  bool ready = word & endpoint.ready_mask;
+
+  if (!endpoint.primed) {
+    endpoint.primed = true;
+    endpoint.state = state;
+    endpoint.ready = ready;
+    endpoint.since = now;
+    endpoint.not_ready_since = now;
+    ++endpoint.entries.at(state % s_number_of_states);
+    return false;
+  }
+
+  if (state == endpoint.state && ready == endpoint.ready)
+    return false;
+
+  auto duration_us = get_elapsed_us(endpoint.since, now);
+  endpoint.time_in_state_us.at(endpoint.state % s_number_of_states) += duration_us;
+  if (state != endpoint.state)
+    ++endpoint.entries.at(state % s_number_of_states);
+
+  if (endpoint.ready && !ready) {
+    endpoint.not_ready_since = now;
+    ++endpoint.not_ready_periods;
+  } else if (!endpoint.ready && ready) {
+    auto not_ready_us = get_elapsed_us(endpoint.not_ready_since, now);
+    endpoint.not_ready_time_us += not_ready_us;
+    endpoint.longest_not_ready_us = std::max(endpoint.longest_not_ready_us, not_ready_us);
+  }
+
+  timingfirmwareinfo::EndpointStateTransition transition;
+  transition.endpoint = endpoint.name;
+  transition.timestamp_ns = now_ns;
+  transition.uncertainty_us = uncertainty_us;
+  transition.previous_state = endpoint.state;
+  transition.state = state;
+  transition.previous_ready = endpoint.ready;
+  transition.ready = ready;
+  transition.previous_duration_us = duration_us;
+
+  if (m_size == m_ring.size())
+    ++m_overwritten_transitions;
+  m_ring.at(m_next) = transition;
+  m_next = (m_next + 1) % m_ring.size();
+  m_size = std::min(m_size + 1, m_ring.size());
+
+  endpoint.state = state;
+  endpoint.ready = ready;
+  endpoint.since = now;
+  ++endpoint.transitions;
+  ++m_transitions;
+
+  TLOG_DEBUG(6) << "Endpoint " << endpoint.name << " went from state 0x" << std::hex << transition.previous_state
+                << " to 0x" << state << std::dec << " after " << duration_us << " us";
+  return true;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+EndpointStateRecorder::start()
+{
+  stop();
+  m_stop = false;
+  m_worker = std::thread(&EndpointStateRecorder::run, this);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+EndpointStateRecorder::stop()
+{
+  if (!m_worker.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(m_run_mutex);
+    m_stop = true;
+  }
+  m_run_cv.notify_all();
+  m_worker.join();
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+EndpointStateRecorder::run()
+{
+  auto deadline = Clock::now();
+  std::unique_lock<std::mutex> lock(m_run_mutex);
+  while (!m_stop) {
+    lock.unlock();
+
+    // a late sampler resumes from now, rather than catching up in a burst
+    auto start = Clock::now();
+    if (start - deadline > m_period) {
+      std::lock_guard<std::mutex> stats_lock(m_mutex);
+      ++m_late_samples;
+      deadline = start;
+    }
+    sample();
+    deadline += m_period;
+
+    lock.lock();
+    m_run_cv.wait_until(lock, deadline, [this]() { return m_stop; });
+  }
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+timingfirmwareinfo::EndpointStateTransitionVector
+EndpointStateRecorder::get_transitions() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  timingfirmwareinfo::EndpointStateTransitionVector transitions;
+  transitions.reserve(m_size);
+  size_t first = (m_next + m_ring.size() - m_size) % m_ring.size();
+  for (size_t i = 0; i < m_size; ++i)
+    transitions.push_back(m_ring.at((first + i) % m_ring.size()));
+  return transitions;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+timingfirmwareinfo::EndpointStateSummaryVector
+EndpointStateRecorder::get_summaries() const
+{
+  auto now = Clock::now();
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  timingfirmwareinfo::EndpointStateSummaryVector summaries;
+  summaries.reserve(m_endpoints.size());
+  for (auto& endpoint : m_endpoints) {
+    timingfirmwareinfo::EndpointStateSummary summary;
+    summary.endpoint = endpoint.name;
+    summary.state = endpoint.state;
+    summary.ready = endpoint.ready;
+    summary.transitions = endpoint.transitions;
+    summary.not_ready_periods = endpoint.not_ready_periods;
+    summary.not_ready_time_us = endpoint.not_ready_time_us;
+    summary.longest_not_ready_us = endpoint.longest_not_ready_us;
+
+    if (endpoint.primed && !endpoint.ready) {
+      auto not_ready_us = get_elapsed_us(endpoint.not_ready_since, now);
+      summary.not_ready_time_us += not_ready_us;
+      summary.longest_not_ready_us = std::max<uint64_t>(summary.longest_not_ready_us, not_ready_us); // NOLINT(build/unsigned)
+    }
+
+    for (size_t state = 0; state < s_number_of_states; ++state) {
+      auto time_us = endpoint.time_in_state_us.at(state);
+      if (endpoint.primed && state == endpoint.state % s_number_of_states)
+        time_us += get_elapsed_us(endpoint.since, now);
+      if (!time_us && !endpoint.entries.at(state))
+        continue;
+
+      timingfirmwareinfo::EndpointStateTime state_time;
+      state_time.state = state;
+      state_time.time_us = time_us;
+      state_time.entries = endpoint.entries.at(state);
+      summary.states.push_back(state_time);
+    }
+    summaries.push_back(summary);
+  }
+  return summaries;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+EndpointStateRecorder::clear()
+{
+  std::lock_guard<std::mutex> sample_lock(m_sample_mutex);
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (auto& endpoint : m_endpoints) {
+    auto name = endpoint.name;
+    auto stat = endpoint.stat;
+    auto state_mask = endpoint.state_mask;
+    auto state_shift = endpoint.state_shift;
+    auto ready_mask = endpoint.ready_mask;
+    endpoint = Endpoint{};
+    endpoint.name = name;
+    endpoint.stat = stat;
+    endpoint.state_mask = state_mask;
+    endpoint.state_shift = state_shift;
+    endpoint.ready_mask = ready_mask;
+  }
+  for (auto& device : m_devices)
+    device.sampled = false;
+  m_next = 0;
+  m_size = 0;
+  m_samples = 0;
+  m_late_samples = 0;
+  m_failed_reads = 0;
+  m_max_sample_us = 0;
+  m_transitions = 0;
+  m_overwritten_transitions = 0;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+EndpointStateRecorder::get_info(timingfirmwareinfo::EndpointStateRecorderMonitorData& mon_data,
+                                size_t max_transitions) const
+{
+  mon_data.endpoints = get_summaries();
+
+  auto transitions = get_transitions();
+  auto first = transitions.size() > max_transitions ? transitions.end() - max_transitions : transitions.begin();
+  mon_data.recent_transitions.assign(first, transitions.end());
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  mon_data.samples = m_samples;
+  mon_data.late_samples = m_late_samples;
+  mon_data.failed_reads = m_failed_reads;
+  mon_data.max_sample_us = m_max_sample_us;
+  mon_data.transitions = m_transitions;
+  mon_data.overwritten_transitions = m_overwritten_transitions;
+}
+//-----------------------------------------------------------------------------
+
+} // namespace timing
+} // namespace dunedaq
@@ -178,6 +178,17 @@ FIBIONode::get_sfp_status(uint32_t sfp_id, bool print_out) const { // NOLINT(bui
 //-----------------------------------------------------------------------------
 
 
+//-----------------------------------------------------------------------------
+void
+FIBIONode::get_sfp_info(uint32_t sfp_id, timinghardwareinfo::TimingSFPMonitorData& mon_data) const { // NOLINT(build/unsigned)
+	validate_sfp_id(sfp_id);
+
+	std::string sfp_i2c_bus = "i2c_sfp" + std::to_string(sfp_id);
+	auto sfp = get_i2c_device<I2CSFPSlave>(sfp_i2c_bus, "SFP_EEProm");
+	sfp->get_info(mon_data);
+}
+//-----------------------------------------------------------------------------
+
 //-----------------------------------------------------------------------------
 void
 FIBIONode::switch_sfp_soft_tx_control_bit(uint32_t sfp_id, bool turn_on) const { // NOLINT(build/unsigned)
@@ -8,6 +8,9 @@
 
 #include "timing/FLCmdGeneratorNode.hpp"
 
+#include "timing/DeviceTransactionScheduler.hpp"
+#include "timing/FLCmdRatePlanner.hpp"
+
 #include "timing/toolbox.hpp"
 #include "logging/Logging.hpp"
 
@@ -72,6 +75,8 @@ FLCmdGeneratorNode::send_fl_cmd(uint32_t command,       // NOLINT(build/unsigned
   validate_command(command);
   validate_channel(channel);
 
+  DeviceTransaction transaction(getClient(), kControlTransaction);
+
   getNode("sel").write(channel);
 
   reset_sub_nodes(getNode("chan_ctrl"));
@@ -85,6 +90,30 @@ FLCmdGeneratorNode::send_fl_cmd(uint32_t command,       // NOLINT(build/unsigned
 }
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+void
+FLCmdGeneratorNode::prepare_fl_cmd_channel(uint32_t command,       // NOLINT(build/unsigned)
+                                           uint32_t channel) const // NOLINT(build/unsigned)
+{
+  validate_command(command);
+  validate_channel(channel);
+
+  getNode("sel").write(channel);
+  reset_sub_nodes(getNode("chan_ctrl"), 0x0, false);
+  getNode("chan_ctrl.type").write(command);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+FLCmdGeneratorNode::queue_fl_cmd(uint32_t channel) const // NOLINT(build/unsigned)
+{
+  getNode("sel").write(channel);
+  getNode("ctrl.force").write(0x1);
+  getNode("ctrl.force").write(0x0);
+}
+//-----------------------------------------------------------------------------
+
 //-----------------------------------------------------------------------------
 void
 FLCmdGeneratorNode::enable_periodic_fl_cmd(uint32_t channel,  // NOLINT(build/unsigned)
@@ -165,6 +194,32 @@ FLCmdGeneratorNode::enable_periodic_fl_cmd(uint32_t command,  // NOLINT(build/un
 }
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+void
+FLCmdGeneratorNode::enable_periodic_fl_cmd(const FLCmdMultiChannelPlan& plan) const
+{
+  for (auto& channel_plan : plan.channels) {
+    validate_command(channel_plan.command);
+    validate_channel(channel_plan.channel);
+    FLCmdRatePlanner::validate_settings(channel_plan.plan, getNode("chan_ctrl.rate_div_d"), getNode("chan_ctrl.rate_div_p"));
+  }
+
+  TLOG() << "Enabling " << plan.channels.size() << " command generators, total rate " << plan.total_rate
+         << " Hz, load " << plan.load << ", coincidence rate " << plan.coincidence_rate << " Hz";
+
+  // one dispatch, so that the periodic generators start together
+  for (auto& channel_plan : plan.channels) {
+    getNode("sel").write(channel_plan.channel);
+    getNode("chan_ctrl.type").write(channel_plan.command);
+    getNode("chan_ctrl.rate_div_d").write(channel_plan.plan.divisor);
+    getNode("chan_ctrl.rate_div_p").write(channel_plan.plan.prescale);
+    getNode("chan_ctrl.patt").write(channel_plan.poisson);
+    getNode("chan_ctrl.en").write(1);
+  }
+  getClient().dispatch();
+}
+//-----------------------------------------------------------------------------
+
 //-----------------------------------------------------------------------------
 void
 FLCmdGeneratorNode::disable_fake_trigger(uint32_t channel) const // NOLINT(build/unsigned)
@@ -234,32 +289,12 @@ void FLCmdGeneratorNode::parse_periodic_fl_cmd_rate(double requested_rate,
                                                     uint32_t& divisor,
                                                     uint32_t& prescale)
 {
-  // Rate =  (clock_frequency_hz / 2^(d+8)) / p where n in [0,15] and p in [1,256]
-
-  // DIVIDER (int): Frequency divider.
-
-  // The division from clock_frequency_hz to the desired rate is done in three steps:
-  // a) A pre-division by 256
-  // b) Division by a power of two set by n = 2 ^ rate_div_d (ranging from 2^0 -> 2^15)
-  // c) 1-in-n prescaling set by n = rate_div_p
-
-  double div = ceil(log(clock_frequency_hz / (requested_rate * 256 * 256)) / log(2));
-  if (div < 0) {
-    divisor = 0;
-  } else if (div > 15) {
-    divisor = 15;
-  } else {
-    divisor = div;
-  }
+  // Rate =  (clock_frequency_hz / 2^(d+8)) / p where d in [0,15] and p in [1,255]
+  auto plan = FLCmdRatePlanner(clock_frequency_hz).plan(requested_rate);
 
-  uint32_t ps = (uint32_t)((clock_frequency_hz / (requested_rate * 256 * (1 << divisor))) + 0.5); // NOLINT(build/unsigned)
-  if (ps == 0 || ps > 256)
-  {
-    throw BadRequestedFakeTriggerRate(ERS_HERE, requested_rate, ps);
-  } else {
-    prescale = ps;
-  }
-  actual_rate = static_cast<double>(clock_frequency_hz) / (256 * prescale * (1 << divisor));
+  divisor = plan.divisor;
+  prescale = plan.prescale;
+  actual_rate = plan.actual_rate;
 }
 //-----------------------------------------------------------------------------
 
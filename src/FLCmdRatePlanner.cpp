@@ -0,0 +1,155 @@
+/**
+ * @file FLCmdRatePlanner.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "timing/FLCmdRatePlanner.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+namespace dunedaq {
+namespace timing {
+
+//-----------------------------------------------------------------------------
+FLCmdRatePlanner::FLCmdRatePlanner(uint32_t clock_frequency_hz) // NOLINT(build/unsigned)
+  : m_clock_frequency_hz(clock_frequency_hz)
+{}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+const std::vector<FLCmdRatePlanner::Setting>&
+FLCmdRatePlanner::get_settings()
+{
+  static const std::vector<Setting> settings = []() {
+    std::vector<Setting> all;
+    all.reserve((max_divisor + 1) * max_prescale);
+    for (uint32_t d = 0; d <= max_divisor; ++d) {     // NOLINT(build/unsigned)
+      for (uint32_t p = 1; p <= max_prescale; ++p) {  // NOLINT(build/unsigned)
+        all.push_back({ static_cast<uint64_t>(pre_division) * p << d, d, p }); // NOLINT(build/unsigned)
+      }
+    }
+    // several (d, p) give the same period, keep the one with the smallest divisor
+    std::sort(all.begin(), all.end(), [](const Setting& a, const Setting& b) {
+      return a.period != b.period ? a.period < b.period : a.divisor < b.divisor;
+    });
+    all.erase(std::unique(all.begin(), all.end(), [](const Setting& a, const Setting& b) { return a.period == b.period; }),
+              all.end());
+    return all;
+  }();
+  return settings;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+FLCmdRatePlan
+FLCmdRatePlanner::make_plan(double requested_rate, const Setting& setting) const
+{
+  FLCmdRatePlan plan;
+  plan.requested_rate = requested_rate;
+  plan.actual_rate = static_cast<double>(m_clock_frequency_hz) / setting.period;
+  plan.relative_error = (plan.actual_rate - requested_rate) / requested_rate;
+  plan.divisor = setting.divisor;
+  plan.prescale = setting.prescale;
+  plan.period = setting.period;
+  return plan;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+double
+FLCmdRatePlanner::get_min_rate() const
+{
+  return static_cast<double>(m_clock_frequency_hz) / get_settings().back().period;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+double
+FLCmdRatePlanner::get_max_rate() const
+{
+  return static_cast<double>(m_clock_frequency_hz) / get_settings().front().period;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+FLCmdRatePlanner::validate_settings(const FLCmdRatePlan& plan,
+                                    const uhal::Node& divisor_node,
+                                    const uhal::Node& prescale_node)
+{
+  auto fits = [](const uhal::Node& node, uint32_t value) { // NOLINT(build/unsigned)
+    uint32_t mask = node.getMask();                        // NOLINT(build/unsigned)
+    uint32_t field_max = mask >> __builtin_ctz(mask);      // NOLINT(build/unsigned)
+    return value <= field_max;
+  };
+  if (plan.prescale == 0 || !fits(divisor_node, plan.divisor) || !fits(prescale_node, plan.prescale))
+    throw InvalidFixedLatencyCommandRateSettings(ERS_HERE, plan.divisor, plan.prescale);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+FLCmdRatePlan
+FLCmdRatePlanner::plan(double requested_rate) const
+{
+  if (!(requested_rate > 0) || requested_rate > 2 * get_max_rate() || requested_rate < get_min_rate() / 2)
+    throw BadRequestedFakeTriggerRate(ERS_HERE, requested_rate, 0);
+
+  auto& settings = get_settings();
+  double target_period = m_clock_frequency_hz / requested_rate;
+
+  auto above = std::lower_bound(settings.begin(), settings.end(), target_period, [](const Setting& s, double period) {
+    return s.period < period;
+  });
+
+  // the closest rate is one of the two settings around the target period
+  if (above == settings.end())
+    return make_plan(requested_rate, settings.back());
+  if (above == settings.begin())
+    return make_plan(requested_rate, settings.front());
+
+  auto plan_above = make_plan(requested_rate, *above);
+  auto plan_below = make_plan(requested_rate, *(above - 1));
+  return std::abs(plan_below.relative_error) <= std::abs(plan_above.relative_error) ? plan_below : plan_above;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+FLCmdMultiChannelPlan
+FLCmdRatePlanner::plan(const std::vector<FLCmdChannelRequest>& requests) const
+{
+  FLCmdMultiChannelPlan multi_plan;
+
+  for (auto& request : requests) {
+    FLCmdChannelPlan channel_plan{ request.channel, request.command, request.poisson, plan(request.rate) };
+    multi_plan.total_rate += channel_plan.plan.actual_rate;
+    multi_plan.channels.push_back(channel_plan);
+  }
+
+  multi_plan.load = multi_plan.total_rate * pre_division / m_clock_frequency_hz;
+
+  double slot = static_cast<double>(pre_division) / m_clock_frequency_hz;
+  for (size_t i = 0; i < multi_plan.channels.size(); ++i) {
+    for (size_t j = i + 1; j < multi_plan.channels.size(); ++j) {
+      auto& a = multi_plan.channels.at(i);
+      auto& b = multi_plan.channels.at(j);
+      if (!a.poisson && !b.poisson) {
+        // periodic generators enabled together line up every lcm of their periods
+        multi_plan.coincidence_rate += static_cast<double>(m_clock_frequency_hz) / std::lcm(a.plan.period, b.plan.period);
+      } else {
+        multi_plan.coincidence_rate += a.plan.actual_rate * b.plan.actual_rate * slot;
+      }
+    }
+  }
+
+  return multi_plan;
+}
+//-----------------------------------------------------------------------------
+
+} // namespace timing
+} // namespace dunedaq
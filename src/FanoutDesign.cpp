@@ -1,4 +1,5 @@
 #include "timing/FanoutDesign.hpp"
+#include "timing/DeviceTransactionScheduler.hpp"
 
 #include <sstream>
 #include <string>
@@ -47,9 +48,22 @@ FanoutDesign::configure() const
 void
 FanoutDesign::get_info(timingfirmwareinfo::TimingDeviceInfo& mon_data) const
 {
+  // one monitoring transaction, so that control operations wait for a consistent snapshot
+  DeviceTransaction transaction(getClient(), kMonitoringTransaction);
   TopDesign::get_info(mon_data);
   EndpointDesignInterface::get_info(0, mon_data.endpoint_info);
 }
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+void
+FanoutDesign::register_monitoring(MonitoringScheduler& scheduler) const
+{
+  TopDesign::register_monitoring(scheduler);
+  scheduler.add_task(kFastMonitoring, "endpoint", 2, 0, [this](timingfirmwareinfo::TimingDeviceInfo& mon_data) {
+    EndpointDesignInterface::get_info(0, mon_data.endpoint_info);
+  });
+}
+//-----------------------------------------------------------------------------
+
 }
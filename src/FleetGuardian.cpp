@@ -0,0 +1,595 @@
+/**
+ * @file FleetGuardian.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "timing/FleetGuardian.hpp"
+
+#include "timing/DeviceTransactionScheduler.hpp"
+#include "timing/EndpointDesignInterface.hpp"
+#include "timing/HSIDesignInterface.hpp"
+#include "timing/MasterDesignInterface.hpp"
+#include "timing/toolbox.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace timing {
+
+namespace {
+
+const uhal::Node*
+find_node(const uhal::Node& parent, const std::string& path)
+{
+  try {
+    return &parent.getNode(path);
+  } catch (const uhal::exception&) {
+    return nullptr;
+  }
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+std::string
+get_guarded_condition_name(GuardedCondition condition)
+{
+  switch (condition) {
+    case kBoardUnreachable:
+      return "board unreachable";
+    case kCDRLossOfLock:
+      return "CDR loss of lock";
+    case kCDRLossOfSignal:
+      return "CDR loss of signal";
+    case kSFPLossOfSignal:
+      return "SFP loss of signal";
+    case kSFPFault:
+      return "SFP fault";
+    case kPLLLossOfLock:
+      return "PLL loss of lock";
+    case kPLLLossOfSignal:
+      return "PLL loss of signal";
+    case kEndpointNotReady:
+      return "endpoint not ready";
+    case kUpstreamEndpointNotReady:
+      return "upstream endpoint not ready";
+    case kHSIBufferWarning:
+      return "HSI buffer warning";
+    default:
+      return "unknown condition";
+  }
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+std::string
+get_recovery_action_name(RecoveryAction action)
+{
+  switch (action) {
+    case kNoRecovery:
+      return "none";
+    case kResetEndpoint:
+      return "endpoint reset";
+    case kEnableUpstreamEndpoint:
+      return "upstream endpoint enable";
+    default:
+      return "unknown action";
+  }
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+FleetGuardian::FleetGuardian()
+  : m_fast_period(1000)
+  , m_slow_period(10000)
+  , m_debounce(3)
+  , m_report_interval(60)
+  , m_max_unreachable_backoff(60000)
+  , m_pll_los_mask(0x0)
+  , m_recovery_holdoff(30)
+  , m_max_recovery_attempts(3)
+  , m_stop_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+  , m_polls(0)
+  , m_failed_polls(0)
+  , m_late_polls(0)
+  , m_conditions_raised(0)
+  , m_conditions_active(0)
+  , m_reports_suppressed(0)
+  , m_recoveries_attempted(0)
+  , m_recoveries_failed(0)
+  , m_max_poll_us(0)
+{
+  if (m_stop_fd < 0)
+    throw GuardianError(ERS_HERE, std::string("eventfd failed: ") + std::strerror(errno));
+
+  m_watched.fill(true);
+  m_watched.at(kUpstreamEndpointNotReady) = false;
+  m_recovery.fill(kNoRecovery);
+  m_recovery.at(kEndpointNotReady) = kResetEndpoint;
+  m_recovery.at(kUpstreamEndpointNotReady) = kEnableUpstreamEndpoint;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+FleetGuardian::~FleetGuardian()
+{
+  close(m_stop_fd);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+FleetGuardian::add_board(const std::string& name, const TopDesignInterface& design)
+{
+  auto board = std::make_unique<Board>();
+  board->name = name;
+  board->design = &design;
+  board->flags.fill(nullptr);
+  board->master = nullptr;
+  board->polls = 0;
+  board->consecutive_failures = 0;
+
+  // only the registers this design has are polled
+  auto io = design.get_io_node_plain();
+  if (io) {
+    board->flags.at(kCDRLossOfLock) = find_node(*io, "csr.stat.cdr_lol");
+    board->flags.at(kCDRLossOfSignal) = find_node(*io, "csr.stat.cdr_los");
+    board->flags.at(kSFPLossOfSignal) = find_node(*io, "csr.stat.sfp_los");
+    board->flags.at(kSFPFault) = find_node(*io, "csr.stat.sfp_flt");
+    try {
+      board->pll = io->get_pll();
+    } catch (const std::exception& e) {
+      TLOG_DEBUG(2) << "Board " << name << " has no PLL to watch: " << e.what();
+    }
+  }
+
+  if (auto endpoint_design = dynamic_cast<const EndpointDesignInterface*>(&design)) {
+    for (uint32_t i = 0; i < endpoint_design->get_number_of_endpoint_nodes(); ++i) // NOLINT(build/unsigned)
+      board->endpoints.push_back(endpoint_design->get_endpoint_node_plain(i));
+  }
+
+  if (auto hsi_design = dynamic_cast<const HSIDesignInterface*>(&design))
+    board->flags.at(kHSIBufferWarning) = find_node(hsi_design->get_hsi_node(), "csr.stat.buf_warn");
+
+  if (auto master_design = dynamic_cast<const MasterDesignInterface*>(&design)) {
+    board->master = master_design->get_master_node_plain();
+    if (board->master)
+      board->flags.at(kUpstreamEndpointNotReady) = find_node(*board->master, "global.csr.stat.rx_rdy");
+  }
+
+  std::lock_guard<std::mutex> lock(m_boards_mutex);
+  m_boards.push_back(std::move(board));
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+bool
+FleetGuardian::is_watched(const Board& board, GuardedCondition condition) const
+{
+  if (!m_watched.at(condition))
+    return false;
+
+  switch (condition) {
+    case kBoardUnreachable:
+      return true;
+    case kPLLLossOfLock:
+      return board.pll != nullptr;
+    case kPLLLossOfSignal:
+      return board.pll != nullptr && m_pll_los_mask;
+    case kEndpointNotReady:
+      return !board.endpoints.empty();
+    default:
+      return board.flags.at(condition) != nullptr;
+  }
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+std::chrono::milliseconds
+FleetGuardian::get_fast_interval(const Board& board) const
+{
+  if (board.consecutive_failures < m_debounce)
+    return m_fast_period;
+
+  // the interval doubles with every failure after the debounce, until it reaches the maximum backoff
+  auto max_interval = std::max(m_max_unreachable_backoff, m_fast_period);
+  auto interval = m_fast_period;
+  for (uint32_t i = m_debounce; i <= board.consecutive_failures && interval < max_interval; ++i) // NOLINT(build/unsigned)
+    interval *= 2;
+  return std::min(interval, max_interval);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+FleetGuardian::run()
+{
+  int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (epoll_fd < 0 || timer_fd < 0) {
+    std::string reason = std::string("epoll or timerfd creation failed: ") + std::strerror(errno);
+    close(epoll_fd);
+    close(timer_fd);
+    throw GuardianError(ERS_HERE, reason);
+  }
+
+  epoll_event event;
+  event.events = EPOLLIN;
+  event.data.fd = timer_fd;
+  epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &event);
+  event.data.fd = m_stop_fd;
+  epoll_ctl(epoll_fd, EPOLL_CTL_ADD, m_stop_fd, &event);
+
+  // spread the boards over the periods, so that the polls do not come in bursts
+  using Deadline = std::pair<Clock::time_point, size_t>;
+  std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline>> deadlines;
+  auto start = Clock::now();
+  for (size_t i = 0; i < m_boards.size(); ++i) {
+    auto& board = *m_boards.at(i);
+    board.next_fast = start + m_fast_period * i / m_boards.size();
+    board.next_slow = start + m_slow_period * i / m_boards.size();
+    deadlines.emplace(board.next_fast, i);
+  }
+
+  TLOG() << "Guarding " << m_boards.size() << " boards";
+
+  bool stopping = m_boards.empty();
+  while (!stopping) {
+    // arm the timer for the earliest deadline; an expiry in the past fires at once
+    auto delay = std::max<Clock::duration>(deadlines.top().first - Clock::now(), std::chrono::microseconds(1));
+    itimerspec timer;
+    std::memset(&timer, 0, sizeof(timer));
+    auto delay_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(delay).count();
+    timer.it_value.tv_sec = delay_ns / 1000000000;
+    timer.it_value.tv_nsec = delay_ns % 1000000000;
+    timerfd_settime(timer_fd, 0, &timer, nullptr);
+
+    epoll_event events[2];
+    int number_of_events = epoll_wait(epoll_fd, events, 2, -1);
+    if (number_of_events < 0 && errno != EINTR) {
+      TLOG() << "Guardian epoll_wait failed: " << std::strerror(errno);
+      break;
+    }
+
+    for (int e = 0; e < number_of_events; ++e) {
+      uint64_t count; // NOLINT(build/unsigned)
+      if (events[e].data.fd == m_stop_fd) {
+        if (read(m_stop_fd, &count, sizeof(count)) > 0)
+          stopping = true;
+      } else {
+        while (read(timer_fd, &count, sizeof(count)) > 0) {}
+      }
+    }
+    if (stopping)
+      break;
+
+    auto now = Clock::now();
+    while (!deadlines.empty() && deadlines.top().first <= now) {
+      auto i = deadlines.top().second;
+      deadlines.pop();
+      auto& board = *m_boards.at(i);
+
+      auto poll_start = Clock::now();
+      if (poll_start - board.next_fast > m_fast_period)
+        ++m_late_polls;
+      poll_fast(board, poll_start);
+      if (poll_start >= board.next_slow) {
+        poll_slow(board, poll_start);
+        board.next_slow += m_slow_period;
+        if (board.next_slow < poll_start)
+          board.next_slow = poll_start + m_slow_period;
+      }
+      auto poll_us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - poll_start).count();
+      if (static_cast<uint64_t>(poll_us) > m_max_poll_us.load()) // NOLINT(build/unsigned)
+        m_max_poll_us = poll_us;
+
+      // a late board skips the polls it missed, rather than catching up in a burst
+      auto interval = get_fast_interval(board);
+      board.next_fast += interval;
+      if (board.next_fast < poll_start)
+        board.next_fast = poll_start + interval;
+      deadlines.emplace(board.next_fast, i);
+    }
+  }
+
+  close(timer_fd);
+  close(epoll_fd);
+  TLOG() << "Guardian stopped";
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+FleetGuardian::stop()
+{
+  uint64_t one = 1; // NOLINT(build/unsigned)
+  auto written = write(m_stop_fd, &one, sizeof(one));
+  (void)written;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+FleetGuardian::poll_fast(Board& board, Clock::time_point now)
+{
+  ++m_polls;
+  ++board.polls;
+
+  std::array<uhal::ValWord<uint32_t>, kNumberOfGuardedConditions> flags; // NOLINT(build/unsigned)
+  std::vector<uhal::ValWord<uint32_t>> endpoint_ready;                    // NOLINT(build/unsigned)
+  std::vector<uhal::ValWord<uint32_t>> endpoint_state;                    // NOLINT(build/unsigned)
+  try {
+    DeviceTransaction transaction(board.design->getClient(), kMonitoringTransaction);
+    for (size_t c = 0; c < kNumberOfGuardedConditions; ++c) {
+      if (board.flags.at(c) && m_watched.at(c))
+        flags.at(c) = board.flags.at(c)->read();
+    }
+    if (is_watched(board, kEndpointNotReady)) {
+      for (auto endpoint : board.endpoints) {
+        endpoint_ready.push_back(endpoint->getNode("csr.stat.ep_rdy").read());
+        endpoint_state.push_back(endpoint->getNode("csr.stat.ep_stat").read());
+      }
+    }
+    board.design->getClient().dispatch();
+  } catch (const std::exception& e) {
+    ++m_failed_polls;
+    ++board.consecutive_failures;
+    std::lock_guard<std::mutex> lock(m_boards_mutex);
+    if (is_watched(board, kBoardUnreachable))
+      update(board, kBoardUnreachable, true, e.what(), now);
+    return;
+  }
+
+  board.consecutive_failures = 0;
+
+  std::vector<GuardedCondition> to_recover;
+  {
+    std::lock_guard<std::mutex> lock(m_boards_mutex);
+    if (is_watched(board, kBoardUnreachable))
+      update(board, kBoardUnreachable, false, "", now);
+
+    for (size_t c = 0; c < kNumberOfGuardedConditions; ++c) {
+      auto condition = static_cast<GuardedCondition>(c);
+      if (!board.flags.at(c) || !m_watched.at(c))
+        continue;
+      // the upstream flag is a ready flag, the others are fault flags
+      bool present = condition == kUpstreamEndpointNotReady ? !flags.at(c).value() : flags.at(c).value();
+      update(board, condition, present, present ? "flags " + format_reg_value(flags.at(c).value(), 16) : "", now);
+    }
+
+    if (is_watched(board, kEndpointNotReady)) {
+      std::stringstream detail;
+      board.endpoints_not_ready.clear();
+      for (size_t i = 0; i < board.endpoints.size(); ++i) {
+        if (endpoint_ready.at(i).value())
+          continue;
+        board.endpoints_not_ready.push_back(i);
+        detail << (detail.tellp() ? ", " : "") << "endpoint " << i << " in state 0x" << std::hex
+               << endpoint_state.at(i).value() << std::dec;
+      }
+      update(board, kEndpointNotReady, !board.endpoints_not_ready.empty(), detail.str(), now);
+    }
+
+    for (size_t c = 0; c < kNumberOfGuardedConditions; ++c) {
+      auto& state = board.conditions.at(c);
+      if (state.active && m_recovery.at(c) != kNoRecovery && state.recovery_attempts < m_max_recovery_attempts &&
+          (!state.recovery_attempts || now - state.last_recovery >= m_recovery_holdoff))
+        to_recover.push_back(static_cast<GuardedCondition>(c));
+    }
+  }
+
+  // recoveries talk to the board, so they run outside the lock
+  for (auto condition : to_recover)
+    recover(board, condition, now);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+FleetGuardian::poll_slow(Board& board, Clock::time_point now)
+{
+  if (!is_watched(board, kPLLLossOfLock) && !is_watched(board, kPLLLossOfSignal))
+    return;
+  // an unreachable board would only time out once more on every I2C access
+  if (board.conditions.at(kBoardUnreachable).active)
+    return;
+
+  timinghardwareinfo::TimingPLLMonitorData pll_data;
+  try {
+    DeviceTransaction transaction(board.design->getClient(), kMonitoringTransaction);
+    board.pll->get_info(pll_data);
+  } catch (const std::exception& e) {
+    ++m_failed_polls;
+    TLOG_DEBUG(2) << "Failed to read the PLL of board " << board.name << ": " << e.what();
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(m_boards_mutex);
+  if (is_watched(board, kPLLLossOfLock))
+    update(board, kPLLLossOfLock, pll_data.lol, "", now);
+  if (is_watched(board, kPLLLossOfSignal)) {
+    uint32_t los = pll_data.los & m_pll_los_mask; // NOLINT(build/unsigned)
+    update(board, kPLLLossOfSignal, los, los ? "inputs " + format_reg_value(los, 16) : "", now);
+  }
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+FleetGuardian::update(Board& board,
+                      GuardedCondition condition,
+                      bool present,
+                      const std::string& detail,
+                      Clock::time_point now)
+{
+  auto& state = board.conditions.at(condition);
+  if (present)
+    state.detail = detail;
+
+  if (present == state.active) {
+    state.streak = 0;
+    // an active condition is reminded, and suppressed edges summarised, once per interval
+    if ((state.active || state.suppressed) && now - state.last_report >= m_report_interval)
+      report(board, condition, now);
+    return;
+  }
+
+  if (++state.streak < m_debounce)
+    return;
+
+  state.streak = 0;
+  state.active = present;
+  state.since = now;
+  if (present) {
+    ++state.raised;
+    ++m_conditions_raised;
+    ++m_conditions_active;
+  } else {
+    --m_conditions_active;
+    state.recovery_attempts = 0;
+  }
+
+  if (!state.reported || now - state.last_report >= m_report_interval) {
+    report(board, condition, now);
+  } else {
+    ++state.suppressed;
+    ++m_reports_suppressed;
+  }
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+FleetGuardian::report(Board& board, GuardedCondition condition, Clock::time_point now)
+{
+  auto& state = board.conditions.at(condition);
+  auto name = get_guarded_condition_name(condition);
+  auto active_for_s = std::chrono::duration_cast<std::chrono::seconds>(now - state.since).count();
+
+  if (!state.active)
+    ers::info(GuardedConditionCleared(ERS_HERE, board.name, name, state.suppressed));
+  else if (state.since == now)
+    ers::warning(GuardedConditionRaised(ERS_HERE, board.name, name, state.detail, state.suppressed));
+  else
+    ers::warning(GuardedConditionPersists(ERS_HERE, board.name, name, state.detail, active_for_s, state.suppressed));
+
+  state.reported = true;
+  state.last_report = now;
+  state.suppressed = 0;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+FleetGuardian::recover(Board& board, GuardedCondition condition, Clock::time_point now)
+{
+  auto action = m_recovery.at(condition);
+  uint32_t attempt; // NOLINT(build/unsigned)
+  std::vector<size_t> endpoints;
+  {
+    std::lock_guard<std::mutex> lock(m_boards_mutex);
+    auto& state = board.conditions.at(condition);
+    attempt = ++state.recovery_attempts;
+    state.last_recovery = now;
+    endpoints = board.endpoints_not_ready;
+  }
+
+  ++m_recoveries_attempted;
+  ers::info(GuardianRecoveryAttempted(ERS_HERE, board.name, get_recovery_action_name(action), attempt));
+  try {
+    switch (action) {
+      case kResetEndpoint:
+        for (auto i : endpoints) {
+          timingendpointinfo::TimingEndpointInfo endpoint_data;
+          board.endpoints.at(i)->get_info(endpoint_data);
+          board.endpoints.at(i)->reset(endpoint_data.address, endpoint_data.partition);
+        }
+        break;
+      case kEnableUpstreamEndpoint:
+        if (!board.master)
+          throw GuardianError(ERS_HERE, "board " + board.name + " has no master");
+        board.master->enable_upstream_endpoint();
+        break;
+      default:
+        break;
+    }
+  } catch (const std::exception& e) {
+    ++m_recoveries_failed;
+    ers::warning(GuardianRecoveryFailed(ERS_HERE, board.name, get_recovery_action_name(action), e.what()));
+  }
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+std::vector<GuardedBoardStatus>
+FleetGuardian::get_board_statuses() const
+{
+  auto now = Clock::now();
+  std::vector<GuardedBoardStatus> statuses;
+
+  std::lock_guard<std::mutex> lock(m_boards_mutex);
+  for (auto& board : m_boards) {
+    GuardedBoardStatus status;
+    status.name = board->name;
+    status.polls = board->polls;
+    for (size_t c = 0; c < kNumberOfGuardedConditions; ++c) {
+      auto condition = static_cast<GuardedCondition>(c);
+      if (!is_watched(*board, condition))
+        continue;
+      auto& state = board->conditions.at(c);
+      GuardedConditionStatus condition_status;
+      condition_status.condition = condition;
+      condition_status.active = state.active;
+      condition_status.active_for_ms =
+        state.active ? std::chrono::duration_cast<std::chrono::milliseconds>(now - state.since).count() : 0;
+      condition_status.raised = state.raised;
+      condition_status.recovery_attempts = state.recovery_attempts;
+      condition_status.detail = state.active ? state.detail : "";
+      status.conditions.push_back(condition_status);
+    }
+    statuses.push_back(status);
+  }
+  return statuses;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+FleetGuardian::get_info(timingfirmwareinfo::FleetGuardianMonitorData& mon_data) const
+{
+  {
+    std::lock_guard<std::mutex> lock(m_boards_mutex);
+    mon_data.boards = m_boards.size();
+  }
+  mon_data.polls = m_polls.load();
+  mon_data.failed_polls = m_failed_polls.load();
+  mon_data.late_polls = m_late_polls.load();
+  mon_data.conditions_raised = m_conditions_raised.load();
+  mon_data.conditions_active = m_conditions_active.load();
+  mon_data.reports_suppressed = m_reports_suppressed.load();
+  mon_data.recoveries_attempted = m_recoveries_attempted.load();
+  mon_data.recoveries_failed = m_recoveries_failed.load();
+  mon_data.max_poll_us = m_max_poll_us.load();
+}
+//-----------------------------------------------------------------------------
+
+} // namespace timing
+} // namespace dunedaq
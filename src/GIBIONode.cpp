@@ -7,6 +7,7 @@
  */
 
 #include "timing/GIBIONode.hpp"
+#include "timing/DeviceTransactionScheduler.hpp"
 
 #include <string>
 #include <math.h>
@@ -64,6 +65,8 @@ GIBIONode::get_pll() const
 std::string
 GIBIONode::get_hardware_info(bool print_out) const
 {
+  DeviceMuxLock mux_lock(getClient(), kMonitoringTransaction);
+
   // enable pll/uid channel 0 only
   set_i2c_mux_channels(0x1);
   return IONode::get_hardware_info(print_out);
@@ -94,7 +97,7 @@ GIBIONode::reset(const ClockSource& clock_source) const
 void
 GIBIONode::reset(const std::string& clock_config_file) const
 {
-  
+  DeviceMuxLock mux_lock(getClient(), kControlTransaction);
   write_soft_reset_register();
 
   // Reset I2C switch and expander, active low
@@ -167,6 +170,8 @@ GIBIONode::get_sfp_status(uint32_t sfp_id, bool print_out) const { // NOLINT(bui
   
   validate_sfp_id(sfp_id);
 
+  DeviceMuxLock mux_lock(getClient(), kMonitoringTransaction);
+
   uint8_t i2c_mux_bitmask = 1UL << (sfp_id+1);
 
   set_i2c_mux_channels(i2c_mux_bitmask);
@@ -183,6 +188,22 @@ GIBIONode::get_sfp_status(uint32_t sfp_id, bool print_out) const { // NOLINT(bui
 }
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+void
+GIBIONode::get_sfp_info(uint32_t sfp_id, timinghardwareinfo::TimingSFPMonitorData& mon_data) const { // NOLINT(build/unsigned)
+  validate_sfp_id(sfp_id);
+
+  DeviceMuxLock mux_lock(getClient(), kMonitoringTransaction);
+
+  uint8_t i2c_mux_bitmask = 1UL << (sfp_id+1);
+
+  set_i2c_mux_channels(i2c_mux_bitmask);
+
+  auto sfp = get_i2c_device<I2CSFPSlave>(m_sfp_i2c_buses.at(sfp_id), "SFP_EEProm");
+  sfp->get_info(mon_data);
+}
+//-----------------------------------------------------------------------------
+
 //-----------------------------------------------------------------------------
 void
 GIBIONode::switch_sfp_soft_tx_control_bit(uint32_t sfp_id, bool turn_on) const { // NOLINT(build/unsigned)
@@ -9,6 +9,9 @@
 #include "timing/HSINode.hpp"
 
 #include "timing/FLCmdGeneratorNode.hpp"
+#include "timing/FLCmdRatePlanner.hpp"
+#include "timing/IssueThrottle.hpp"
+#include "timing/OperationProfiler.hpp"
 #include "timing/toolbox.hpp"
 #include "logging/Logging.hpp"
 
@@ -21,6 +24,17 @@ namespace timing {
 
 UHAL_REGISTER_DERIVED_NODE(HSINode)
 
+namespace {
+
+// each buffer state of each node is throttled on its own, so that an error is not hidden by warnings
+std::string
+get_issue_context(const uhal::Node& node, const std::string& buffer_state)
+{
+  return node.getClient().uri() + " " + node.getPath() + " " + buffer_state;
+}
+
+} // namespace
+
 //-----------------------------------------------------------------------------
 HSINode::HSINode(const uhal::Node& node)
   : TimingNode(node)
@@ -89,6 +103,8 @@ HSINode::read_buffer_count() const
 uhal::ValVector<uint32_t>                                                             // NOLINT(build/unsigned)
 HSINode::read_data_buffer(uint16_t& n_words, bool read_all, bool fail_on_error) const // NOLINT(build/unsigned)
 {
+  static const auto operation = OperationProfiler::add_operation("HSINode::read_data_buffer");
+  ProfiledOperation profile(operation);
 
   uint32_t buffer_state = read_buffer_state(); // NOLINT(build/unsigned)
 
@@ -101,18 +117,18 @@ HSINode::read_data_buffer(uint16_t& n_words, bool read_all, bool fail_on_error)
   uhal::ValVector<uint32_t> buffer_data; // NOLINT(build/unsigned)
 
   if (buffer_state & 0x2) {
-    ers::warning(HSIBufferIssue(ERS_HERE, "WARNING"));
+    IssueThrottle::get().warning(HSIBufferIssue(ERS_HERE, "WARNING"), get_issue_context(*this, "WARNING"));
   }
 
   if (buffer_state & 0x1) {
-    ers::error(HSIBufferIssue(ERS_HERE, "ERROR"));
+    IssueThrottle::get().error(HSIBufferIssue(ERS_HERE, "ERROR"), get_issue_context(*this, "ERROR"));
     if (fail_on_error)
       return buffer_data;
   }
 
   // this is bad
   if (n_hsi_words > 1024) {
-    ers::error(HSIBufferIssue(ERS_HERE, "OVERFLOW"));
+    IssueThrottle::get().error(HSIBufferIssue(ERS_HERE, "OVERFLOW"), get_issue_context(*this, "OVERFLOW"));
     if (fail_on_error)
       return buffer_data;
     n_hsi_words = 1024;
@@ -131,7 +147,7 @@ HSINode::read_data_buffer(uint16_t& n_words, bool read_all, bool fail_on_error)
   }
 
   buffer_data = getNode("buf.data").readBlock(words_to_read);
-  getClient().dispatch();
+  OperationProfiler::dispatch(getClient(), words_to_read, 0);
 
   return buffer_data;
 }
@@ -145,6 +161,52 @@ HSINode::read_data_buffer(bool read_all, bool fail_on_error) const
   return read_data_buffer(words, read_all, fail_on_error);
 }
 
+//-----------------------------------------------------------------------------
+uhal::ValVector<uint32_t>                                                                         // NOLINT(build/unsigned)
+HSINode::read_data_buffer_fused(uint32_t words_to_read, uint32_t& buffer_state) const // NOLINT(build/unsigned)
+{
+  static const auto operation = OperationProfiler::add_operation("HSINode::read_data_buffer_fused");
+  ProfiledOperation profile(operation);
+
+  if (words_to_read > 1024) {
+    words_to_read = 1024;
+  }
+
+  uhal::ValVector<uint32_t> buffer_data; // NOLINT(build/unsigned)
+  if (words_to_read) {
+    buffer_data = getNode("buf.data").readBlock(words_to_read);
+  }
+
+  auto buf_state = read_sub_nodes(getNode("csr.stat"), false);
+  auto hsi_buffer_count = getNode("buf.count").read();
+  OperationProfiler::dispatch(getClient(), words_to_read + buf_state.size() + 1, 0);
+
+  uint8_t buffer_error = static_cast<uint8_t>(buf_state.find("buf_err")->second.value());    // NOLINT(build/unsigned)
+  uint8_t buffer_warning = static_cast<uint8_t>(buf_state.find("buf_warn")->second.value()); // NOLINT(build/unsigned)
+
+  buffer_state = buffer_error | (buffer_warning << 1);
+  buffer_state = buffer_state | static_cast<uint32_t>(hsi_buffer_count.value()) << 0x10; // NOLINT(build/unsigned)
+
+  TLOG_DEBUG(5) << "Words read out: " << format_reg_value(words_to_read)
+                << ", words left in readout buffer: " << format_reg_value(buffer_state >> 0x10);
+
+  if (buffer_state & 0x2) {
+    IssueThrottle::get().warning(HSIBufferIssue(ERS_HERE, "WARNING"), get_issue_context(*this, "WARNING"));
+  }
+
+  if (buffer_state & 0x1) {
+    IssueThrottle::get().error(HSIBufferIssue(ERS_HERE, "ERROR"), get_issue_context(*this, "ERROR"));
+  }
+
+  // this is bad
+  if ((buffer_state >> 0x10) > 1024) {
+    IssueThrottle::get().error(HSIBufferIssue(ERS_HERE, "OVERFLOW"), get_issue_context(*this, "OVERFLOW"));
+  }
+
+  return buffer_data;
+}
+//-----------------------------------------------------------------------------
+
 //-----------------------------------------------------------------------------
 std::string
 HSINode::get_data_buffer_table(bool read_all, bool print_out) const
@@ -186,32 +248,22 @@ HSINode::configure_hsi(uint32_t src,      // NOLINT(build/unsigned)
   getNode("csr.inv_mask").write(inv_mask);
 
   // Configures the internal hsi signal generator to produce triggers at a defined frequency.
-  // Rate =  (clock_frequency_hz / 2^(d+8)) / p where n in [0,15] and p in [1,256]
-
-  // DIVIDER (int): Frequency divider.
-
-  // The division from clock_frequency_hz to the desired rate is done in three steps:
-  // a) A pre-division by 256
-  // b) Division by a power of two set by n = 2 ^ rate_div_d (ranging from 2^0 -> 2^15)
-  // c) 1-in-n prescaling set by n = rate_div_p
-  
+  // Rate =  (clock_frequency_hz / 2^(d+8)) / p where d in [0,15] and p in [1,255]
   try
   {
-    uint32_t divisor;
-    uint32_t prescale;
-    double actual_rate;
+    auto plan = FLCmdRatePlanner(clock_frequency_hz).plan(rate);
 
-    FLCmdGeneratorNode::parse_periodic_fl_cmd_rate(rate, clock_frequency_hz, actual_rate, divisor, prescale);
-
-    TLOG() << "Requested rate, actual rate: " << rate << ", " << actual_rate;
-    TLOG() << "prescale, divisor: " << prescale << ", " << divisor;
+    TLOG() << "Requested rate, actual rate: " << rate << ", " << plan.actual_rate
+           << " (relative error: " << plan.relative_error << ")";
+    TLOG() << "prescale, divisor: " << plan.prescale << ", " << plan.divisor;
 
     std::stringstream trig_stream;
-    trig_stream << "> Random trigger rate for HSI set to " << std::setprecision(3) << std::scientific << actual_rate << " Hz. d: " << divisor << " p: " << prescale;
+    trig_stream << "> Random trigger rate for HSI set to " << std::setprecision(3) << std::scientific << plan.actual_rate << " Hz. d: " << plan.divisor << " p: " << plan.prescale;
     TLOG() << trig_stream.str();
     
-    getNode("csr.ctrl.rate_div_p").write(prescale);
-    getNode("csr.ctrl.rate_div_d").write(divisor);
+    FLCmdRatePlanner::validate_settings(plan, getNode("csr.ctrl.rate_div_d"), getNode("csr.ctrl.rate_div_p"));
+    getNode("csr.ctrl.rate_div_p").write(plan.prescale);
+    getNode("csr.ctrl.rate_div_d").write(plan.divisor);
   }
   catch (const timing::BadRequestedFakeTriggerRate& e)
   {
@@ -289,7 +341,7 @@ HSINode::read_buffer_state() const
 
   auto buf_state = read_sub_nodes(getNode("csr.stat"), false);
   auto hsi_buffer_count = getNode("buf.count").read();
-  getClient().dispatch();
+  OperationProfiler::dispatch(getClient(), buf_state.size() + 1, 0);
 
   uint8_t buffer_error = static_cast<uint8_t>(buf_state.find("buf_err")->second.value());    // NOLINT(build/unsigned)
   uint8_t buffer_warning = static_cast<uint8_t>(buf_state.find("buf_warn")->second.value()); // NOLINT(build/unsigned)
@@ -0,0 +1,590 @@
+/**
+ * @file HardwareBroker.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "timing/HardwareBroker.hpp"
+
+#include "timing/DeviceTransactionScheduler.hpp"
+#include "timing/I2CMasterNode.hpp"
+#include "timing/MasterNode.hpp"
+#include "timing/TimingNode.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace timing {
+
+namespace {
+
+constexpr uint32_t kMaxFrameSize = 16 << 20; // NOLINT(build/unsigned)
+
+bool
+send_all(int fd, const void* data, size_t size)
+{
+  auto bytes = static_cast<const char*>(data);
+  while (size) {
+    auto sent = send(fd, bytes, size, MSG_NOSIGNAL);
+    if (sent < 0 && errno == EINTR)
+      continue;
+    if (sent <= 0)
+      return false;
+    bytes += sent;
+    size -= sent;
+  }
+  return true;
+}
+
+bool
+receive_all(int fd, void* data, size_t size)
+{
+  auto bytes = static_cast<char*>(data);
+  while (size) {
+    auto received = recv(fd, bytes, size, 0);
+    if (received < 0 && errno == EINTR)
+      continue;
+    if (received <= 0)
+      return false;
+    bytes += received;
+    size -= received;
+  }
+  return true;
+}
+
+bool
+write_frame(int fd, const std::string& frame)
+{
+  uint32_t size = frame.size(); // NOLINT(build/unsigned)
+  return send_all(fd, &size, sizeof(size)) && send_all(fd, frame.data(), frame.size());
+}
+
+// returns false when the peer closed the connection, or sent a frame too large to be a request
+bool
+read_frame(int fd, std::string& frame)
+{
+  uint32_t size = 0; // NOLINT(build/unsigned)
+  if (!receive_all(fd, &size, sizeof(size)) || size > kMaxFrameSize)
+    return false;
+  frame.resize(size);
+  return receive_all(fd, &frame[0], size);
+}
+
+sockaddr_un
+make_address(const std::string& socket_path)
+{
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(address.sun_path))
+    throw HardwareBrokerError(ERS_HERE, socket_path, "socket path too long");
+  std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+  return address;
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+std::string
+get_hardware_broker_path(const std::string& device)
+{
+  std::string name = device;
+  std::replace(name.begin(), name.end(), '/', '_');
+  return "/tmp/timing_broker." + name + ".sock";
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+HardwareBroker::HardwareBroker(uhal::HwInterface& hw, const std::string& socket_path)
+  : m_hw(hw)
+  , m_socket_path(socket_path)
+  , m_listen_fd(-1)
+  , m_stopping(false)
+  , m_connections_accepted(0)
+  , m_requests(0)
+  , m_failed_requests(0)
+  , m_dispatched_reads(0)
+  , m_coalesced_reads(0)
+{}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+HardwareBroker::~HardwareBroker()
+{
+  stop();
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+HardwareBroker::start()
+{
+  if (m_listen_fd >= 0)
+    return;
+
+  sockaddr_un address = make_address(m_socket_path);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    throw HardwareBrokerError(ERS_HERE, m_socket_path, std::string("socket failed: ") + std::strerror(errno));
+
+  // a socket left by a broker which did not exit cleanly would make bind fail
+  unlink(m_socket_path.c_str());
+  if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+    std::string reason = std::string("bind failed: ") + std::strerror(errno);
+    close(fd);
+    throw HardwareBrokerError(ERS_HERE, m_socket_path, reason);
+  }
+
+  // the socket is created with the umask permissions; only the owner may drive the hardware through it.
+  // nobody can connect before listen, so there is no window with the wider permissions
+  if (chmod(m_socket_path.c_str(), S_IRUSR | S_IWUSR) < 0 || listen(fd, 16) < 0) {
+    std::string reason = std::string("listen failed: ") + std::strerror(errno);
+    close(fd);
+    unlink(m_socket_path.c_str());
+    throw HardwareBrokerError(ERS_HERE, m_socket_path, reason);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_connections_mutex);
+    m_stopping = false;
+  }
+  m_listen_fd = fd;
+  m_acceptor = std::thread(&HardwareBroker::accept_connections, this);
+  TLOG_DEBUG(2) << "Serving " << m_hw.id() << " on " << m_socket_path;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+HardwareBroker::stop()
+{
+  if (m_listen_fd < 0)
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock(m_connections_mutex);
+    m_stopping = true;
+    // wakes the connection threads from their reads; a request in progress still gets its reply attempt
+    for (auto fd : m_connections)
+      shutdown(fd, SHUT_RDWR);
+  }
+  shutdown(m_listen_fd, SHUT_RDWR);
+  m_acceptor.join();
+  close(m_listen_fd);
+  unlink(m_socket_path.c_str());
+  m_listen_fd = -1;
+
+  std::unique_lock<std::mutex> lock(m_connections_mutex);
+  m_connections_cv.wait(lock, [this] { return m_connections.empty(); });
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+HardwareBroker::accept_connections()
+{
+  while (true) {
+    int fd = accept4(m_listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    std::lock_guard<std::mutex> lock(m_connections_mutex);
+    if (m_stopping) {
+      if (fd >= 0)
+        close(fd);
+      return;
+    }
+    if (fd < 0) {
+      if (errno != EINTR && errno != ECONNABORTED)
+        TLOG() << "Broker on " << m_socket_path << " failed to accept a connection: " << std::strerror(errno);
+      continue;
+    }
+    m_connections.insert(fd);
+    ++m_connections_accepted;
+    std::thread(&HardwareBroker::serve_connection, this, fd).detach();
+  }
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+HardwareBroker::serve_connection(int fd)
+{
+  std::string frame;
+  while (read_frame(fd, frame)) {
+    nlohmann::json reply;
+    try {
+      auto request = nlohmann::json::parse(frame);
+      if (request.contains("id"))
+        reply["id"] = request.at("id");
+      reply["result"] = execute(request);
+    } catch (const std::exception& e) {
+      reply["error"] = e.what();
+    }
+    if (!write_frame(fd, reply.dump()))
+      break;
+  }
+
+  std::lock_guard<std::mutex> lock(m_connections_mutex);
+  close(fd);
+  m_connections.erase(fd);
+  m_connections_cv.notify_all();
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+nlohmann::json
+HardwareBroker::execute(const nlohmann::json& request)
+{
+  ++m_requests;
+  try {
+    auto operation = request.at("op").get<std::string>();
+    if (operation == "read")
+      return execute_read(request);
+    if (operation == "write")
+      return write(request);
+    if (operation == "i2c")
+      return transfer_i2c(request);
+    if (operation == "async_packet")
+      return transmit_async_packet(request);
+    if (operation == "status")
+      return get_status(request);
+    if (operation == "stats")
+      return get_stats();
+    throw HardwareBrokerRequestFailed(ERS_HERE, operation, "unknown operation");
+  } catch (...) {
+    ++m_failed_requests;
+    throw;
+  }
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+nlohmann::json
+HardwareBroker::execute_read(const nlohmann::json& request)
+{
+  nlohmann::json plan = request;
+  plan.erase("id");
+  auto key = plan.dump();
+
+  std::unique_lock<std::mutex> lock(m_in_flight_mutex);
+  auto in_flight = m_in_flight_reads.find(key);
+  if (in_flight != m_in_flight_reads.end()) {
+    auto result = in_flight->second;
+    lock.unlock();
+    ++m_coalesced_reads;
+    return result.get();
+  }
+
+  std::promise<nlohmann::json> promise;
+  m_in_flight_reads.emplace(key, promise.get_future().share());
+  lock.unlock();
+
+  // the entry goes before the values are handed out, so that later requests read afresh
+  nlohmann::json result;
+  std::exception_ptr error;
+  try {
+    result = read(plan);
+  } catch (...) {
+    error = std::current_exception();
+  }
+
+  lock.lock();
+  m_in_flight_reads.erase(key);
+  lock.unlock();
+
+  if (error) {
+    promise.set_exception(error);
+    std::rethrow_exception(error);
+  }
+  promise.set_value(result);
+  return result;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+nlohmann::json
+HardwareBroker::read(const nlohmann::json& request)
+{
+  std::vector<std::pair<std::string, uhal::ValWord<uint32_t>>> words;    // NOLINT(build/unsigned)
+  std::vector<std::pair<std::string, uhal::ValVector<uint32_t>>> blocks; // NOLINT(build/unsigned)
+
+  {
+    DeviceTransaction transaction(m_hw.getClient(), kMonitoringTransaction);
+    for (auto& path : request.value("paths", nlohmann::json::array()))
+      words.emplace_back(path.get<std::string>(), m_hw.getNode(path.get<std::string>()).read());
+    for (auto& block : request.value("blocks", nlohmann::json::array())) {
+      auto path = block.at("path").get<std::string>();
+      blocks.emplace_back(path, m_hw.getNode(path).readBlock(block.at("size").get<uint32_t>())); // NOLINT(build/unsigned)
+    }
+    m_hw.dispatch();
+  }
+  ++m_dispatched_reads;
+
+  nlohmann::json result;
+  result["values"] = nlohmann::json::object();
+  result["blocks"] = nlohmann::json::object();
+  for (auto& word : words)
+    result["values"][word.first] = word.second.value();
+  for (auto& block : blocks)
+    result["blocks"][block.first] = block.second.value();
+  return result;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+nlohmann::json
+HardwareBroker::write(const nlohmann::json& request)
+{
+  DeviceTransaction transaction(m_hw.getClient(), kControlTransaction);
+  for (auto& write : request.value("writes", nlohmann::json::array()))
+    m_hw.getNode(write.at("path").get<std::string>()).write(write.at("value").get<uint32_t>()); // NOLINT(build/unsigned)
+  for (auto& block : request.value("blocks", nlohmann::json::array()))
+    m_hw.getNode(block.at("path").get<std::string>())
+      .writeBlock(block.at("values").get<std::vector<uint32_t>>()); // NOLINT(build/unsigned)
+  m_hw.dispatch();
+  return nlohmann::json::object();
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+nlohmann::json
+HardwareBroker::transfer_i2c(const nlohmann::json& request)
+{
+  auto& bus = m_hw.getNode<I2CMasterNode>(request.at("bus").get<std::string>());
+  auto address = request.at("address").get<uint8_t>();                                                 // NOLINT(build/unsigned)
+  auto write_data = request.value("write", nlohmann::json::array()).get<std::vector<uint8_t>>();     // NOLINT(build/unsigned)
+  auto number_of_bytes_to_read = request.value("read", 0u);
+
+  // a control transaction does not yield at the I2C yield points, so no write from another client can
+  // land between the write and the read of this transfer (e.g. reselecting a bus mux)
+  DeviceTransaction transaction(m_hw.getClient(), kControlTransaction);
+  if (!write_data.empty())
+    bus.write_i2cPrimitive(address, write_data, number_of_bytes_to_read == 0);
+
+  nlohmann::json result;
+  result["data"] = number_of_bytes_to_read ? bus.read_i2cPrimitive(address, number_of_bytes_to_read)
+                                           : std::vector<uint8_t>(); // NOLINT(build/unsigned)
+  return result;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+nlohmann::json
+HardwareBroker::transmit_async_packet(const nlohmann::json& request)
+{
+  auto& master = m_hw.getNode<MasterNode>(request.value("master", std::string("master")));
+  auto packet = request.at("packet").get<std::vector<uint32_t>>(); // NOLINT(build/unsigned)
+
+  DeviceTransaction transaction(m_hw.getClient(), kControlTransaction);
+  nlohmann::json result;
+  result["reply"] = master.transmit_async_packet(packet, request.value("timeout", 500));
+  return result;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+nlohmann::json
+HardwareBroker::get_status(const nlohmann::json& request)
+{
+  auto path = request.value("path", std::string());
+  auto node = dynamic_cast<const TimingNode*>(&m_hw.getNode(path));
+  if (!node)
+    throw HardwareBrokerRequestFailed(ERS_HERE, "status", "node '" + path + "' is not a timing node");
+
+  DeviceTransaction transaction(m_hw.getClient(), kMonitoringTransaction);
+  nlohmann::json result;
+  result["status"] = node->get_status();
+  return result;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+nlohmann::json
+HardwareBroker::get_stats() const
+{
+  timingfirmwareinfo::HardwareBrokerMonitorData mon_data;
+  get_info(mon_data);
+  nlohmann::json result;
+  to_json(result, mon_data);
+  return result;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+HardwareBroker::get_info(timingfirmwareinfo::HardwareBrokerMonitorData& mon_data) const
+{
+  {
+    std::lock_guard<std::mutex> lock(m_connections_mutex);
+    mon_data.active_connections = m_connections.size();
+  }
+  mon_data.connections_accepted = m_connections_accepted.load();
+  mon_data.requests = m_requests.load();
+  mon_data.failed_requests = m_failed_requests.load();
+  mon_data.dispatched_reads = m_dispatched_reads.load();
+  mon_data.coalesced_reads = m_coalesced_reads.load();
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+HardwareBrokerClient::HardwareBrokerClient(const std::string& socket_path)
+  : m_socket_path(socket_path)
+  , m_fd(-1)
+  , m_next_id(0)
+{
+  sockaddr_un address = make_address(m_socket_path);
+
+  m_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (m_fd < 0)
+    throw HardwareBrokerError(ERS_HERE, m_socket_path, std::string("socket failed: ") + std::strerror(errno));
+
+  if (connect(m_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+    std::string reason = std::string("connect failed: ") + std::strerror(errno);
+    close(m_fd);
+    throw HardwareBrokerError(ERS_HERE, m_socket_path, reason);
+  }
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+HardwareBrokerClient::~HardwareBrokerClient()
+{
+  close(m_fd);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+nlohmann::json
+HardwareBrokerClient::request(const nlohmann::json& request) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  nlohmann::json message = request;
+  message["id"] = ++m_next_id;
+
+  std::string frame;
+  if (!write_frame(m_fd, message.dump()) || !read_frame(m_fd, frame))
+    throw HardwareBrokerError(ERS_HERE, m_socket_path, "connection to the broker lost");
+
+  auto reply = nlohmann::json::parse(frame);
+  if (reply.contains("error"))
+    throw HardwareBrokerRequestFailed(ERS_HERE, request.value("op", std::string()), reply.at("error").get<std::string>());
+  if (reply.value("id", uint64_t(0)) != m_next_id) // NOLINT(build/unsigned)
+    throw HardwareBrokerError(ERS_HERE, m_socket_path, "reply out of sequence");
+  return reply.at("result");
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+std::map<std::string, uint32_t> // NOLINT(build/unsigned)
+HardwareBrokerClient::read(const std::vector<std::string>& paths) const
+{
+  auto result = request({ { "op", "read" }, { "paths", paths } });
+  return result.at("values").get<std::map<std::string, uint32_t>>(); // NOLINT(build/unsigned)
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+uint32_t // NOLINT(build/unsigned)
+HardwareBrokerClient::read(const std::string& path) const
+{
+  return read(std::vector<std::string>{ path }).at(path);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+std::vector<uint32_t> // NOLINT(build/unsigned)
+HardwareBrokerClient::read_block(const std::string& path, uint32_t size) const // NOLINT(build/unsigned)
+{
+  auto result = request({ { "op", "read" }, { "blocks", { { { "path", path }, { "size", size } } } } });
+  return result.at("blocks").at(path).get<std::vector<uint32_t>>(); // NOLINT(build/unsigned)
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+HardwareBrokerClient::write(const std::vector<std::pair<std::string, uint32_t>>& writes) const // NOLINT(build/unsigned)
+{
+  auto items = nlohmann::json::array();
+  for (auto& write : writes)
+    items.push_back({ { "path", write.first }, { "value", write.second } });
+  request({ { "op", "write" }, { "writes", items } });
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+HardwareBrokerClient::write(const std::string& path, uint32_t value) const // NOLINT(build/unsigned)
+{
+  write(std::vector<std::pair<std::string, uint32_t>>{ { path, value } }); // NOLINT(build/unsigned)
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+HardwareBrokerClient::write_block(const std::string& path, const std::vector<uint32_t>& values) const // NOLINT(build/unsigned)
+{
+  request({ { "op", "write" }, { "blocks", { { { "path", path }, { "values", values } } } } });
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+std::vector<uint8_t> // NOLINT(build/unsigned)
+HardwareBrokerClient::transfer_i2c(const std::string& bus,
+                                   uint8_t i2c_device_address,             // NOLINT(build/unsigned)
+                                   const std::vector<uint8_t>& write_data, // NOLINT(build/unsigned)
+                                   uint32_t number_of_bytes_to_read) const // NOLINT(build/unsigned)
+{
+  auto result = request({ { "op", "i2c" },
+                          { "bus", bus },
+                          { "address", i2c_device_address },
+                          { "write", write_data },
+                          { "read", number_of_bytes_to_read } });
+  return result.at("data").get<std::vector<uint8_t>>(); // NOLINT(build/unsigned)
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+std::vector<uint32_t> // NOLINT(build/unsigned)
+HardwareBrokerClient::transmit_async_packet(const std::vector<uint32_t>& packet, // NOLINT(build/unsigned)
+                                            int timeout,
+                                            const std::string& master) const
+{
+  auto result =
+    request({ { "op", "async_packet" }, { "master", master }, { "packet", packet }, { "timeout", timeout } });
+  return result.at("reply").get<std::vector<uint32_t>>(); // NOLINT(build/unsigned)
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+std::string
+HardwareBrokerClient::get_status(const std::string& path) const
+{
+  return request({ { "op", "status" }, { "path", path } }).at("status").get<std::string>();
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+nlohmann::json
+HardwareBrokerClient::get_stats() const
+{
+  return request({ { "op", "stats" } });
+}
+//-----------------------------------------------------------------------------
+
+} // namespace timing
+} // namespace dunedaq
@@ -14,7 +14,9 @@
 #include "timing/I2CMasterNode.hpp"
 
 #include "ers/ers.hpp"
+#include "timing/DeviceTransactionScheduler.hpp"
 #include "timing/I2CSlave.hpp"
+#include "timing/OperationProfiler.hpp"
 #include "timing/TimingIssues.hpp"
 #include "timing/toolbox.hpp"
 
@@ -227,6 +229,9 @@ I2CMasterNode::write_block_i2c(uint8_t i2c_device_address,         // NOLINT(bui
                                const std::vector<uint8_t>& data, // NOLINT(build/unsigned)
                                bool send_stop) const
 {
+  static const auto operation = OperationProfiler::add_operation("I2CMasterNode::write_block_i2c");
+  ProfiledOperation profile(operation);
+
   // transmit reg definitions
   // bits 7-1: 7-bit slave address during address transfer
   //           or first 7 bits of byte during data transfer
@@ -250,6 +255,9 @@ I2CMasterNode::write_block_i2c(uint8_t i2c_device_address,         // NOLINT(bui
 
   for (unsigned ibyte = 0; ibyte < data.size(); ibyte++) {
 
+    // let waiting control operations through between bytes
+    DeviceTransaction::yield_point();
+
     // Send stop if last element of the array (and not vetoed)
     uint8_t cmd = (((ibyte == data.size() - 1) && send_stop) ? kStopCmd : 0x0); // NOLINT(build/unsigned)
 
@@ -263,6 +271,9 @@ I2CMasterNode::write_block_i2c(uint8_t i2c_device_address,         // NOLINT(bui
 std::vector<uint8_t>                                                                // NOLINT(build/unsigned)
 I2CMasterNode::read_block_i2c(uint8_t i2c_device_address, uint32_t number_of_bytes) const // NOLINT(build/unsigned)
 {
+  static const auto operation = OperationProfiler::add_operation("I2CMasterNode::read_block_i2c");
+  ProfiledOperation profile(operation);
+
   // transmit reg definitions
   // bits 7-1: 7-bit slave address during address transfer
   //           or first 7 bits of byte during data transfer
@@ -287,6 +298,9 @@ I2CMasterNode::read_block_i2c(uint8_t i2c_device_address, uint32_t number_of_byt
   std::vector<uint8_t> lArray; // NOLINT(build/unsigned)
   for (unsigned ibyte = 0; ibyte < number_of_bytes; ibyte++) {
 
+    // let waiting control operations through between bytes
+    DeviceTransaction::yield_point();
+
     uint8_t cmd = ((ibyte == number_of_bytes - 1) ? (kStopCmd | kAckCmd) : 0x0); // NOLINT(build/unsigned)
 
     // Push the cmd on the bus, retrieve the result and put it in the arrary
@@ -355,7 +369,7 @@ I2CMasterNode::reset() const
   auto ctrl = getNode(kCtrlNode).read();
   auto pre_hi = getNode(kPreHiNode).read();
   auto pre_lo = getNode(kPreLoNode).read();
-  getClient().dispatch();
+  OperationProfiler::dispatch(getClient(), 3, 0);
 
   bool full_reset(false);
 
@@ -364,7 +378,7 @@ I2CMasterNode::reset() const
   if (full_reset) {
     // disable the I2C core
     getNode(kCtrlNode).write(0x00);
-    getClient().dispatch();
+    OperationProfiler::dispatch(getClient(), 0, 1);
     // set the clock prescale
     getNode(kPreHiNode).write((m_clock_prescale & 0xff00) >> 8);
     // getClient().dispatch();
@@ -373,16 +387,16 @@ I2CMasterNode::reset() const
     // set all writable bus-master registers to default values
     getNode(kTxNode).write(0x00);
     getNode(kCmdNode).write(0x00);
-    getClient().dispatch();
+    OperationProfiler::dispatch(getClient(), 0, 4);
 
     // enable the I2C core
     getNode(kCtrlNode).write(0x80);
-    getClient().dispatch();
+    OperationProfiler::dispatch(getClient(), 0, 1);
   } else {
     // set all writable bus-master registers to default values
     getNode(kTxNode).write(0x00);
     getNode(kCmdNode).write(0x00);
-    getClient().dispatch();
+    OperationProfiler::dispatch(getClient(), 0, 2);
   }
 }
 //-----------------------------------------------------------------------------
@@ -399,14 +413,14 @@ I2CMasterNode::send_i2c_command_and_read_data(uint8_t command) const // NOLINT(b
 
   // Force the read bit high and set them cmd bits
   getNode(kCmdNode).write(full_cmd);
-  getClient().dispatch();
+  OperationProfiler::dispatch(getClient(), 0, 1);
 
   // Wait for transaction to finish. Require idle bus at the end if stop bit is high)
   wait_until_finished(/*req ack*/ false, command & kStopCmd);
 
   // Pull the data out of the rx register.
   uhal::ValWord<uint32_t> result = getNode(kRxNode).read(); // NOLINT(build/unsigned)
-  getClient().dispatch();
+  OperationProfiler::dispatch(getClient(), 1, 0);
 
   TLOG_DEBUG(10) << "<< receive data      = " << format_reg_value((uint32_t)result); // NOLINT(build/unsigned)v
 
@@ -430,13 +444,13 @@ I2CMasterNode::send_i2c_command_and_write_data(uint8_t command, uint8_t data) co
 
   // write the payload
   getNode(kTxNode).write(data);
-  getClient().dispatch();
+  OperationProfiler::dispatch(getClient(), 0, 1);
 
   // Force the write bit high and set them cmd bits
   getNode(kCmdNode).write(full_cmd);
 
   // Run the commands and wait for transaction to finish
-  getClient().dispatch();
+  OperationProfiler::dispatch(getClient(), 0, 1);
 
   // Wait for transaction to finish. Require idle bus at the end if stop bit is high
   // wait_until_finished(req_hack, requ_idle)
@@ -464,7 +478,7 @@ I2CMasterNode::wait_until_finished(bool require_acknowledgement, bool require_bu
     usleep(10);
     // Get the status
     uhal::ValWord<uint32_t> i2c_status = status_node.read(); // NOLINT(build/unsigned)
-    getClient().dispatch();
+    OperationProfiler::dispatch(getClient(), 1, 0);
 
     received_acknowledge = !(i2c_status & kReceivedAckBit);
     busy = (i2c_status & kBusyBit);
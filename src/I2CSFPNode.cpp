@@ -394,53 +394,51 @@ I2CSFPSlave::get_status(bool print_out) const
 //-----------------------------------------------------------------------------
 
 //-----------------------------------------------------------------------------
-// void
-// I2CSFPSlave::get_info(timinghardwareinfo::TimingSFPMonitorData& mon_data) const
-// {
-//   mon_data.data_valid = false;
-
-//   sfp_reachable();
+void
+I2CSFPSlave::get_info(timinghardwareinfo::TimingSFPMonitorData& mon_data) const
+{
+  mon_data.data_valid = false;
 
-//   // Vendor name
-//   mon_data.vendor_name = this->read_vendor_name();
+  sfp_reachable();
 
-//   // Vendor part number
-//   mon_data.vendor_pn = this->read_vendor_part_number();
+  // Vendor name
+  mon_data.vendor_name = this->read_vendor_name();
 
-//   // Serial number TP DO?
-//   // sfp_info.push_back(std::make_pair("Serial number", read_serial_number()));
+  // Vendor part number
+  mon_data.vendor_pn = this->read_vendor_part_number();
 
-//   // Does the SFP support DDM
-//   if (!this->read_ddm_support_bit()) {
-//     TLOG() << "DDM not available for SFP on I2C bus: " << get_master_id();
-//     mon_data.ddm_supported = false;
-//     return;
-//   } else {
-//     mon_data.ddm_supported = true;
-//     if (this->read_i2c_reg_addressSwapBit()) {
-//       TLOG() << "SFP DDM I2C address swap not supported. SFP on I2C bus: " << get_master_id();
-//       return;
-//     }
-//   }
+  // Does the SFP support DDM
+  if (!this->read_ddm_support_bit()) {
+    TLOG_DEBUG(2) << "DDM not available for SFP on I2C bus: " << get_master_id();
+    mon_data.ddm_supported = false;
+    return;
+  } else {
+    mon_data.ddm_supported = true;
+    if (this->read_i2c_reg_addressSwapBit()) {
+      TLOG_DEBUG(2) << "SFP DDM I2C address swap not supported. SFP on I2C bus: " << get_master_id();
+      return;
+    }
+  }
 
-//   mon_data.temperature = this->read_temperature();
+  mon_data.temperature = this->read_temperature();
 
-//   mon_data.supply_voltage = this->read_voltage();
+  mon_data.supply_voltage = this->read_voltage();
 
-//   mon_data.rx_power = this->read_rx_ower();
+  mon_data.rx_power = this->read_rx_ower();
 
-//   mon_data.tx_power = this->read_tx_power();
+  mon_data.tx_power = this->read_tx_power();
 
-//   mon_data.laser_current = this->read_current();
+  mon_data.laser_current = this->read_current();
 
-//   mon_data.tx_disable_sw_supported = this->read_soft_tx_control_support_bit();
+  mon_data.tx_disable_sw_supported = this->read_soft_tx_control_support_bit();
 
-//   mon_data.tx_disable_sw = this->read_soft_tx_control_state();
+  if (mon_data.tx_disable_sw_supported)
+    mon_data.tx_disable_sw = this->read_soft_tx_control_state();
 
-//   mon_data.tx_disable_hw = this->read_tx_disable_pin_state();
+  mon_data.tx_disable_hw = this->read_tx_disable_pin_state();
 
-//   mon_data.data_valid = true;
-// }
+  mon_data.data_valid = true;
+}
 
 // void
 // I2CSFPSlave::get_info(opmonlib::InfoCollector& ci, int /*level*/) const
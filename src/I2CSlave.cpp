@@ -148,5 +148,13 @@ I2CSlave::get_master_id() const
 }
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+std::string
+I2CSlave::get_master_uri() const
+{
+  return m_i2c_master->getClient().uri();
+}
+//-----------------------------------------------------------------------------
+
 } // namespace timing
 } // namespace dunedaq
\ No newline at end of file
@@ -383,6 +383,21 @@ IONode::get_sfp_status(uint32_t sfp_id, bool print_out) const // NOLINT(build/un
 }
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+void
+IONode::get_sfp_info(uint32_t sfp_id, timinghardwareinfo::TimingSFPMonitorData& mon_data) const // NOLINT(build/unsigned)
+{
+  std::string sfp_i2c_bus;
+  try {
+    sfp_i2c_bus = m_sfp_i2c_buses.at(sfp_id);
+  } catch (const std::out_of_range& e) {
+    throw InvalidSFPId(ERS_HERE, format_reg_value(sfp_id), e);
+  }
+  auto sfp = get_i2c_device<I2CSFPSlave>(sfp_i2c_bus, "SFP_EEProm");
+  sfp->get_info(mon_data);
+}
+//-----------------------------------------------------------------------------
+
 //-----------------------------------------------------------------------------
 void
 IONode::switch_sfp_soft_tx_control_bit(uint32_t sfp_id, bool turn_on) const // NOLINT(build/unsigned)
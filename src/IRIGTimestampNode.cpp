@@ -76,6 +76,14 @@ IRIGTimestampNode::read_timestamp() const
 }
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+TimestampSample
+IRIGTimestampNode::sample_timestamp() const
+{
+  return sample_timestamps({ "tstamp" }).at(0);
+}
+//-----------------------------------------------------------------------------
+
 //-----------------------------------------------------------------------------
 void
 IRIGTimestampNode::set_irig_epoch(IRIGEpoch irig_epoch) const // NOLINT(build/unsigned)
@@ -0,0 +1,214 @@
+/**
+ * @file IssueThrottle.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "timing/IssueThrottle.hpp"
+
+#include "ers/ers.hpp"
+
+#include <string>
+#include <thread>
+
+namespace dunedaq {
+namespace timing {
+
+//-----------------------------------------------------------------------------
+IssueThrottle::IssueThrottle(std::chrono::milliseconds summary_interval)
+  : m_summary_interval(summary_interval)
+  , m_enabled(true)
+  , m_next_sweep(Clock::now() + summary_interval)
+  , m_stop(false)
+  , m_issues(0)
+  , m_reported(0)
+  , m_suppressed(0)
+  , m_summaries(0)
+{}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+IssueThrottle::~IssueThrottle()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_sweep_cv.notify_all();
+  if (m_sweeper.joinable())
+    m_sweeper.join();
+
+  flush();
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+IssueThrottle&
+IssueThrottle::get()
+{
+  static IssueThrottle throttle;
+  return throttle;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+IssueThrottle::report(IssueSeverity severity, const ers::Issue& issue, const std::string& context)
+{
+  auto now = Clock::now();
+  std::lock_guard<std::mutex> lock(m_mutex);
+  ++m_issues;
+
+  if (!m_enabled) {
+    ++m_reported;
+    emit(severity, issue);
+    return;
+  }
+
+  if (now >= m_next_sweep)
+    sweep(now);
+
+  Key key(issue.get_class_name(), context);
+  auto found = m_keys.find(key);
+  if (found == m_keys.end()) {
+    m_keys.emplace(key, KeyState{ severity, now, 0, "" });
+    ++m_reported;
+    emit(severity, issue);
+    return;
+  }
+
+  auto& state = found->second;
+  if (now - state.window_start >= m_summary_interval && !state.repeats) {
+    state.severity = severity;
+    state.window_start = now;
+    ++m_reported;
+    emit(severity, issue);
+    return;
+  }
+
+  ++state.repeats;
+  ++m_suppressed;
+  state.last_message = issue.message();
+  if (severity > state.severity)
+    state.severity = severity;
+
+  if (now - state.window_start >= m_summary_interval)
+    emit_summary(key, state, now);
+
+  // only a process which repeats issues pays for the thread
+  if (!m_sweeper.joinable())
+    m_sweeper = std::thread(&IssueThrottle::run_sweeper, this);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+IssueThrottle::emit(IssueSeverity severity, const ers::Issue& issue) const
+{
+  if (severity == kIssueError)
+    ers::error(issue);
+  else
+    ers::warning(issue);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+IssueThrottle::emit_summary(const Key& key, KeyState& state, Clock::time_point now)
+{
+  auto window_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - state.window_start).count();
+  emit(state.severity, IssueRepeated(ERS_HERE, key.first, key.second, state.repeats, window_ms, state.last_message));
+  ++m_summaries;
+
+  // the key stays in a window, so that a condition which persists is summarised once per interval
+  state.window_start = now;
+  state.repeats = 0;
+  state.last_message.clear();
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+IssueThrottle::sweep(Clock::time_point now)
+{
+  for (auto it = m_keys.begin(); it != m_keys.end();) {
+    if (now - it->second.window_start < m_summary_interval) {
+      ++it;
+    } else if (it->second.repeats) {
+      emit_summary(it->first, it->second, now);
+      ++it;
+    } else {
+      // quiet keys are forgotten, which bounds the number of keys kept
+      it = m_keys.erase(it);
+    }
+  }
+  m_next_sweep = now + m_summary_interval;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+IssueThrottle::run_sweeper()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (!m_stop) {
+    m_sweep_cv.wait_until(lock, m_next_sweep);
+    auto now = Clock::now();
+    if (!m_stop && now >= m_next_sweep)
+      sweep(now);
+  }
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+IssueThrottle::flush()
+{
+  auto now = Clock::now();
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (auto& key : m_keys) {
+    if (key.second.repeats)
+      emit_summary(key.first, key.second, now);
+  }
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+IssueThrottle::set_summary_interval(std::chrono::milliseconds interval)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_summary_interval = interval;
+  m_next_sweep = Clock::now() + interval;
+  m_sweep_cv.notify_all();
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+IssueThrottle::set_enabled(bool enabled)
+{
+  if (!enabled)
+    flush();
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_enabled = enabled;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+IssueThrottle::get_info(timingfirmwareinfo::IssueThrottleMonitorData& mon_data) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  mon_data.keys = m_keys.size();
+  mon_data.issues = m_issues;
+  mon_data.reported = m_reported;
+  mon_data.suppressed = m_suppressed;
+  mon_data.summaries = m_summaries;
+}
+//-----------------------------------------------------------------------------
+
+} // namespace timing
+} // namespace dunedaq
@@ -7,6 +7,7 @@
  */
 
 #include "timing/MIBIONode.hpp"
+#include "timing/DeviceTransactionScheduler.hpp"
 
 #include <string>
 #include <math.h>
@@ -54,6 +55,8 @@ MIBIONode::get_status(bool print_out) const
 void
 MIBIONode::configure_pll(const std::string& clock_config_file) const
 {
+  DeviceMuxLock mux_lock(getClient(), kControlTransaction);
+
   // enable pll channel (#3) only
   auto i2c_switch = get_i2c_device<I2C9546SwitchSlave>("i2c", "TCA9546_Switch");
   i2c_switch->set_channels_states(8);
@@ -65,6 +68,8 @@ MIBIONode::configure_pll(const std::string& clock_config_file) const
 std::string
 MIBIONode::get_pll_status(bool print_out) const
 {
+  DeviceMuxLock mux_lock(getClient(), kMonitoringTransaction);
+
   // enable pll channel (#3) only
   auto i2c_switch = get_i2c_device<I2C9546SwitchSlave>("i2c", "TCA9546_Switch");
   i2c_switch->set_channels_states(8);
@@ -149,6 +154,8 @@ MIBIONode::get_sfp_status(uint32_t sfp_id, bool print_out) const { // NOLINT(bui
   
   validate_sfp_id(sfp_id);
 
+  DeviceMuxLock mux_lock(getClient(), kMonitoringTransaction);
+
   // enable i2c path for sfp
   auto i2c_switch = get_i2c_device<I2C9546SwitchSlave>("i2c", "TCA9546_Switch");
   i2c_switch->set_channels_states(1UL << sfp_id);
@@ -176,11 +183,38 @@ MIBIONode::get_sfp_status(uint32_t sfp_id, bool print_out) const { // NOLINT(bui
 }
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+void
+MIBIONode::get_sfp_info(uint32_t sfp_id, timinghardwareinfo::TimingSFPMonitorData& mon_data) const { // NOLINT(build/unsigned)
+  validate_sfp_id(sfp_id);
+
+  DeviceMuxLock mux_lock(getClient(), kMonitoringTransaction);
+
+  auto i2c_switch = get_i2c_device<I2C9546SwitchSlave>("i2c", "TCA9546_Switch");
+  i2c_switch->set_channels_states(1UL << sfp_id);
+
+  auto sfp = get_i2c_device<I2CSFPSlave>(m_sfp_i2c_buses.at(0), "SFP_EEProm");
+  try
+  {
+    sfp->get_info(mon_data);
+  }
+  catch(...)
+  {
+    i2c_switch->set_channels_states(8);
+    throw;
+  }
+
+  i2c_switch->set_channels_states(8);
+}
+//-----------------------------------------------------------------------------
+
 //-----------------------------------------------------------------------------
 void
 MIBIONode::switch_sfp_soft_tx_control_bit(uint32_t sfp_id, bool turn_on) const { // NOLINT(build/unsigned)
   validate_sfp_id(sfp_id);
 
+  DeviceMuxLock mux_lock(getClient(), kControlTransaction);
+
   auto i2c_switch = get_i2c_device<I2C9546SwitchSlave>("i2c", "TCA9546_Switch");
   i2c_switch->set_channels_states(1UL << sfp_id);
   auto sfp = get_i2c_device<I2CSFPSlave>(m_sfp_i2c_buses.at(0), "SFP_EEProm");
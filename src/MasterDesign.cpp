@@ -1,4 +1,5 @@
 #include "timing/MasterDesign.hpp"
+#include "timing/DeviceTransactionScheduler.hpp"
 
 #include <sstream>
 #include <string>
@@ -62,6 +63,15 @@ MasterDesign::sync_timestamp(TimestampSource source) const
 }
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+TimestampSyncResult
+MasterDesign::sync_timestamp_compensated() const
+{
+  auto dts_clock_frequency = this->get_io_node_plain()->read_firmware_frequency();
+  return get_master_node_plain()->sync_timestamp_compensated(dts_clock_frequency);
+}
+//-----------------------------------------------------------------------------
+
 //-----------------------------------------------------------------------------
 uint32_t
 MasterDesign::measure_endpoint_rtt(uint32_t address, bool control_sfp, int /*sfp_mux*/) const
@@ -136,8 +146,21 @@ MasterDesign::validate_firmware_version() const
 void
 MasterDesign::get_info(timingfirmwareinfo::TimingDeviceInfo& mon_data) const
 {
+  // one monitoring transaction, so that control operations wait for a consistent snapshot
+  DeviceTransaction transaction(getClient(), kMonitoringTransaction);
   TopDesign::get_info(mon_data);
   get_info(mon_data.master_info);
 }
 //-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+MasterDesign::register_monitoring(MonitoringScheduler& scheduler) const
+{
+  TopDesign::register_monitoring(scheduler);
+  scheduler.add_task(kFastMonitoring, "master", 3, 0, [this](timingfirmwareinfo::TimingDeviceInfo& mon_data) {
+    get_info(mon_data.master_info);
+  });
+}
+//-----------------------------------------------------------------------------
 }
@@ -84,6 +84,39 @@ MasterGlobalNode::enable_upstream_endpoint(uint32_t timeout) const // NOLINT(bui
 }
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+bool
+MasterGlobalNode::wait_for_upstream_cdr_lock(uint32_t timeout, uint32_t stable_time) const // NOLINT(build/unsigned)
+{
+  auto start = std::chrono::high_resolution_clock::now();
+  auto locked_since = start;
+  bool locked = false;
+
+  while (true) {
+    auto cdr_ready = getNode("csr.stat.cdr_locked").read();
+    getClient().dispatch();
+
+    auto now = std::chrono::high_resolution_clock::now();
+    if (!cdr_ready.value()) {
+      locked = false;
+    } else if (!locked) {
+      locked = true;
+      locked_since = now;
+    }
+
+    if (locked && std::chrono::duration_cast<std::chrono::microseconds>(now - locked_since).count() >= stable_time)
+      return true;
+
+    auto ms_since_start = std::chrono::duration_cast<std::chrono::milliseconds>(now - start);
+
+    if (ms_since_start.count() > timeout)
+      return false;
+
+    std::this_thread::sleep_for(std::chrono::microseconds(10));
+  }
+}
+//-----------------------------------------------------------------------------
+
 //-----------------------------------------------------------------------------
 bool
 MasterGlobalNode::read_upstream_endpoint_ready() const
@@ -7,20 +7,47 @@
  */
 
 #include "timing/MasterNode.hpp"
+
+#include "timing/CommandCounterSampler.hpp"
+#include "timing/CommandLogReader.hpp"
+#include "timing/DeviceTransactionScheduler.hpp"
+#include "timing/IssueThrottle.hpp"
 #include "timing/MasterGlobalNode.hpp"
+#include "timing/OperationProfiler.hpp"
 
 #include "logging/Logging.hpp"
 
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 namespace dunedaq {
 namespace timing {
 
 UHAL_REGISTER_DERIVED_NODE(MasterNode)
 
+//-----------------------------------------------------------------------------
+struct MasterNode::MonitoringState
+{
+  std::mutex mutex;
+  std::unique_ptr<CommandLogReader> command_log;
+  std::unique_ptr<CommandCounterSampler> command_counters;
+};
+
 //-----------------------------------------------------------------------------
 MasterNode::MasterNode(const uhal::Node& node)
   : MasterNodeInterface(node)
+  , m_monitoring(new MonitoringState())
+{}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+MasterNode::MasterNode(const MasterNode& other)
+  : MasterNodeInterface(other)
+  , m_monitoring(new MonitoringState())
 {}
 //-----------------------------------------------------------------------------
 
@@ -107,21 +134,10 @@ MasterNode::get_status_with_date(uint32_t clock_frequency_hz, bool print_out) co
 void
 MasterNode::switch_endpoint_sfp(uint32_t address, bool turn_on) const // NOLINT(build/unsigned)
 {
-    uint32_t sequence = 0xab;
-    uint32_t address_mode = 1;
-    
-    std::vector<uint32_t> tx_packet = { address & 0xff, 
-                                        address >> 8UL, 
-                                        sequence,
-
-                                        // packet to reset rx
-                                        (0x1 << 7UL) | 0x70, // write transaction on 0x70
-                                        (address_mode << 7UL) | 0x1, // transaction length of 0x1
-                                        turn_on,
-                                      };
-  tx_packet.back() = tx_packet.back() | (0x1 << 8UL);
-
-  auto result = transmit_async_packet(tx_packet, -1);
+  EndpointCommandBuilder commands(address);
+  commands.add_write(0x70, { turn_on });
+
+  transmit_endpoint_commands(commands, false);
 }
 //-----------------------------------------------------------------------------
 
@@ -140,9 +156,12 @@ MasterNode::send_fl_cmd(uint32_t command,
                         uint32_t channel,                  // NOLINT(build/unsigned)
                         uint32_t number_of_commands) const // NOLINT(build/unsigned)
 {
+  // force high and force low go out in separate packets, as the generator has always been pulsed; the burst path
+  // pulses within one packet
+  DeviceTransaction transaction(getClient(), kControlTransaction);
   for (uint32_t i = 0; i < number_of_commands; i++) { // NOLINT(build/unsigned)
     getNode<FLCmdGeneratorNode>("scmd_gen").send_fl_cmd(command, channel);
-    
+
     auto ts_l = getNode("cmd_log.tstamp_l").read();
     auto ts_h = getNode("cmd_log.tstamp_h").read();
     auto sent_cmd = getNode("cmd_log.cmd").read();
@@ -153,13 +172,79 @@ MasterNode::send_fl_cmd(uint32_t command,
       TLOG() << "cmd in sent log: 0x" << std::hex << command << ", does not match requested 0x: " << sent_cmd.value();
       // TODO throw something
     }
-    uint64_t timestamp = (uint64_t)ts_h.value() << 32 | ts_l.value();
+    uint64_t timestamp = (uint64_t)ts_h.value() << 32 | ts_l.value(); // NOLINT(build/unsigned)
     TLOG() << "Command sent " << "(" << format_reg_value(command) << ") from generator "
          << format_reg_value(channel) << " @time " << std::hex << std::showbase << timestamp;
   }
 }
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+std::vector<uint64_t>                                                        // NOLINT(build/unsigned)
+MasterNode::send_fl_cmd_burst(uint32_t command,                              // NOLINT(build/unsigned)
+                              const std::vector<uint32_t>& channels,         // NOLINT(build/unsigned)
+                              uint32_t number_of_commands,                   // NOLINT(build/unsigned)
+                              uint32_t readback_interval,                    // NOLINT(build/unsigned)
+                              uint32_t commands_per_dispatch) const          // NOLINT(build/unsigned)
+{
+  if (channels.empty())
+    throw NoFixedLatencyCommandChannels(ERS_HERE, command);
+
+  DeviceTransaction transaction(getClient(), kControlTransaction);
+
+  auto cmd_gen = getNode<FLCmdGeneratorNode>("scmd_gen");
+
+  for (auto channel : channels)
+    cmd_gen.prepare_fl_cmd_channel(command, channel);
+
+  struct LogReadback
+  {
+    uhal::ValWord<uint32_t> tstamp_l; // NOLINT(build/unsigned)
+    uhal::ValWord<uint32_t> tstamp_h; // NOLINT(build/unsigned)
+    uhal::ValWord<uint32_t> cmd;      // NOLINT(build/unsigned)
+  };
+  std::vector<LogReadback> readbacks;
+  std::vector<uint64_t> timestamps; // NOLINT(build/unsigned)
+  if (readback_interval)
+    timestamps.reserve(number_of_commands / readback_interval);
+
+  uint32_t mismatches = 0; // NOLINT(build/unsigned)
+  auto collect_readbacks = [&]() {
+    for (auto& readback : readbacks) {
+      if (readback.cmd.value() != command)
+        ++mismatches;
+      timestamps.push_back(static_cast<uint64_t>(readback.tstamp_h.value()) << 32 | readback.tstamp_l.value()); // NOLINT(build/unsigned)
+    }
+    readbacks.clear();
+  };
+
+  for (uint32_t i = 0; i < number_of_commands; ++i) { // NOLINT(build/unsigned)
+    cmd_gen.queue_fl_cmd(channels.at(i % channels.size()));
+
+    if (readback_interval && (i + 1) % readback_interval == 0) {
+      // the log holds the last command only: it is read in a later packet than the forces before it,
+      // so that it cannot return the previous command
+      getClient().dispatch();
+      collect_readbacks();
+      readbacks.push_back(
+        { getNode("cmd_log.tstamp_l").read(), getNode("cmd_log.tstamp_h").read(), getNode("cmd_log.cmd").read() });
+    }
+
+    if (commands_per_dispatch && (i + 1) % commands_per_dispatch == 0) {
+      getClient().dispatch();
+      collect_readbacks();
+    }
+  }
+  getClient().dispatch();
+  collect_readbacks();
+
+  if (mismatches)
+    ers::warning(FixedLatencyCommandLogMismatch(ERS_HERE, command, mismatches));
+
+  return timestamps;
+}
+//-----------------------------------------------------------------------------
+
 //-----------------------------------------------------------------------------
 uint32_t                                                                      // NOLINT(build/unsigned)
 MasterNode::measure_endpoint_rtt(uint32_t address, bool control_sfp) const // NOLINT(build/unsigned)
@@ -200,6 +285,44 @@ MasterNode::measure_endpoint_rtt(uint32_t address, bool control_sfp) const // NO
 }
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+EchoDelayStatistics
+MasterNode::measure_endpoint_rtt_statistics(uint32_t address, uint32_t number_of_samples, bool control_sfp) const // NOLINT(build/unsigned)
+{
+  auto global = getNode<MasterGlobalNode>("global");
+  auto echo = getNode<EchoMonitorNode>("echo_mon");
+
+  if (control_sfp)
+  {
+    switch_endpoint_sfp(address, true);
+    global.wait_for_upstream_cdr_lock();
+  }
+
+  EchoDelayStatistics stats;
+  try
+  {
+    // without sfp control the link is assumed to be up already, as in measure_endpoint_rtt
+    if (control_sfp)
+      global.enable_upstream_endpoint();
+    stats = echo.measure_delay_statistics(number_of_samples);
+  }
+  catch (const ers::Issue& e)
+  {
+    if (control_sfp)
+      switch_endpoint_sfp(address, false);
+    throw;
+  }
+
+  if (control_sfp)
+    switch_endpoint_sfp(address, false);
+
+  if (stats.unstable)
+    ers::warning(UnstableEndpointRoundTripTime(ERS_HERE, address, stats.min, stats.max));
+
+  return stats;
+}
+//-----------------------------------------------------------------------------
+
 //-----------------------------------------------------------------------------
 void
 MasterNode::apply_endpoint_delay(uint32_t address,      // NOLINT(build/unsigned)
@@ -221,7 +344,7 @@ MasterNode::apply_endpoint_delay(uint32_t address,      // NOLINT(build/unsigned
       // Turn on the current target
       switch_endpoint_sfp(address, true);
 
-      millisleep(100);
+      global.wait_for_upstream_cdr_lock();
     }
 
     try
@@ -236,41 +359,17 @@ MasterNode::apply_endpoint_delay(uint32_t address,      // NOLINT(build/unsigned
       throw e;
     }
 
-    uint64_t endpoint_rtt = echo.send_echo_and_measure_delay(); // NOLINT(build/unsigned)
-    TLOG() << "Pre delay adjustment RTT:  " << format_reg_value(endpoint_rtt, 10);
+    auto rtt_stats = echo.measure_delay_statistics();
+    TLOG() << "Pre delay adjustment RTT:  " << format_reg_value(rtt_stats.median, 10) << " (min: " << rtt_stats.min
+           << ", max: " << rtt_stats.max << ", stddev: " << rtt_stats.stddev << ")";
+    if (rtt_stats.unstable)
+      ers::warning(UnstableEndpointRoundTripTime(ERS_HERE, address, rtt_stats.min, rtt_stats.max));
   }
 
-  uint32_t sequence = 0xab;
-  uint32_t address_mode = 1;
-    
-  std::vector<uint32_t> tx_packet = { address & 0xff, 
-                                        address >> 8UL, 
-                                        sequence,
-
-                                        // packet to write coarse delay
-                                        (0x1 << 7UL) | 0x72, // write transaction on 0x72
-                                        (address_mode << 7UL) | 0x1, // transaction length of 0x1
-                                        ((fine_delay & 0xf) << 4UL) | coarse_delay & 0xf,
-
-                                        // packet to write fine delay
-                                        (0x1 << 7UL) | 0x73, // write transaction on 0x73
-                                        (address_mode << 7UL) | 0x1, // transaction length of 0x1
-                                        (fine_delay >> 4UL) & 0xff,
+  EndpointCommandBuilder commands(address);
+  add_endpoint_delay_commands(commands, coarse_delay, fine_delay);
 
-                                        // packet to set skew done
-                                        (0x1 << 7UL) | 0x70, // write transaction on 0x70
-                                        (address_mode << 7UL) | 0x1, // transaction length of 0x1
-				                                0x3, // deskew done
-
-                                        // packet to resync
-                                        (0x1 << 7UL) | 0x70, // write transaction on 0x70
-                                        (address_mode << 7UL) | 0x1, // transaction length of 0x1
-				                                0x4, // resync
-                                    };
-
-  tx_packet.back() = tx_packet.back() | (0x1 << 8UL);
-
-  transmit_async_packet(tx_packet, -1);
+  transmit_endpoint_commands(commands, false);
 
   if (measure_rtt) {
     try
@@ -286,8 +385,11 @@ MasterNode::apply_endpoint_delay(uint32_t address,      // NOLINT(build/unsigned
       throw e;
     }
 
-    uint64_t endpoint_rtt = echo.send_echo_and_measure_delay(); // NOLINT(build/unsigned)
-    TLOG() << "Post delay adjustment RTT: " << format_reg_value(endpoint_rtt, 10);
+    auto rtt_stats = echo.measure_delay_statistics();
+    TLOG() << "Post delay adjustment RTT: " << format_reg_value(rtt_stats.median, 10) << " (min: " << rtt_stats.min
+           << ", max: " << rtt_stats.max << ", stddev: " << rtt_stats.stddev << ")";
+    if (rtt_stats.unstable)
+      ers::warning(UnstableEndpointRoundTripTime(ERS_HERE, address, rtt_stats.min, rtt_stats.max));
 
     if (control_sfp)
       switch_endpoint_sfp(address, false);
@@ -295,6 +397,21 @@ MasterNode::apply_endpoint_delay(uint32_t address,      // NOLINT(build/unsigned
 }
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+void
+MasterNode::add_endpoint_delay_commands(EndpointCommandBuilder& commands,
+                                        uint32_t coarse_delay, // NOLINT(build/unsigned)
+                                        uint32_t fine_delay)   // NOLINT(build/unsigned)
+{
+  // coarse delay and low nibble of fine delay, then the rest of the fine delay
+  commands.add_write(0x72, { static_cast<uint8_t>(((fine_delay & 0xf) << 4UL) | (coarse_delay & 0xf)) }); // NOLINT(build/unsigned)
+  commands.add_write(0x73, { static_cast<uint8_t>((fine_delay >> 4UL) & 0xff) });                        // NOLINT(build/unsigned)
+  // deskew done, then resync
+  commands.add_write(0x70, { 0x3 });
+  commands.add_write(0x70, { 0x4 });
+}
+//-----------------------------------------------------------------------------
+
 //-----------------------------------------------------------------------------
 void
 MasterNode::sync_timestamp(TimestampSource source) const // NOLINT(build/unsigned)
@@ -306,6 +423,18 @@ MasterNode::sync_timestamp(TimestampSource source) const // NOLINT(build/unsigne
 }
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+TimestampSyncResult
+MasterNode::sync_timestamp_compensated(uint32_t clock_frequency_hz) const // NOLINT(build/unsigned)
+{
+  auto result = getNode<TimestampGeneratorNode>("tstamp").set_timestamp_compensated(clock_frequency_hz);
+
+  enable_timestamp_broadcast();
+  TLOG() << "Timestamp broadcast enabled";
+  return result;
+}
+//-----------------------------------------------------------------------------
+
 //-----------------------------------------------------------------------------
 uint64_t // NOLINT(build/unsigned)
 MasterNode::read_timestamp() const
@@ -314,6 +443,14 @@ MasterNode::read_timestamp() const
 }
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+TimestampSample
+MasterNode::sample_timestamp() const
+{
+  return getNode<TimestampGeneratorNode>("tstamp").sample_timestamp();
+}
+//-----------------------------------------------------------------------------
+
 //-----------------------------------------------------------------------------
 void
 MasterNode::set_timestamp(TimestampSource source) const // NOLINT(build/unsigned)
@@ -326,6 +463,8 @@ MasterNode::set_timestamp(TimestampSource source) const // NOLINT(build/unsigned
 void
 MasterNode::get_info(timingfirmwareinfo::MasterMonitorData& mon_data) const
 {
+  DeviceTransaction transaction(getClient(), kMonitoringTransaction);
+
   mon_data.timestamp = read_timestamp();
 
   auto control = read_sub_nodes(getNode("global.csr.ctrl"), false);
@@ -338,27 +477,19 @@ MasterNode::get_info(timingfirmwareinfo::MasterMonitorData& mon_data) const
   mon_data.tx_err = state.at("tx_err").value();
   mon_data.ctrs_rdy = state.at("ctrs_rdy").value();
 
-//   ic.add(mon_data);
-
-//   uint number_of_commands = 0xff;
+  std::lock_guard<std::mutex> lock(m_monitoring->mutex);
 
-//   getNode("cmd_ctrs.addr").write(0x0);
-//   auto counters = getNode("cmd_ctrs.data").readBlock(number_of_commands);
-//   getClient().dispatch();
+  // only the sent command counters which changed since the last call are published
+  if (!m_monitoring->command_counters)
+    m_monitoring->command_counters.reset(new CommandCounterSampler(*this));
+  m_monitoring->command_counters->sample();
+  m_monitoring->command_counters->get_info(mon_data.command_counters);
 
-//   for (uint i = 0; i < number_of_commands; ++i) { // NOLINT(build/unsigned)
-
-//     timingfirmwareinfo::SentCommandCounter cmd_counter;
-//     opmonlib::InfoCollector cmd_counter_ic;
-
-//     cmd_counter.counts = counters.at(i);
-
-//     std::stringstream channel;
-//     channel << "cmd_0x" << std::hex << i;
-
-//     cmd_counter_ic.add(cmd_counter);
-//     ic.add(channel.str(), cmd_counter_ic);
-//   }
+  // the log is read after the counters, which give it the number of commands sent
+  if (!m_monitoring->command_log)
+    m_monitoring->command_log.reset(new CommandLogReader(*this, 1024, false));
+  m_monitoring->command_log->poll(m_monitoring->command_counters->get_total_delta());
+  m_monitoring->command_log->get_info(mon_data.command_log);
 
 //   getNode<FLCmdGeneratorNode>("scmd_gen").get_info(ic, level);
 }
@@ -376,20 +507,22 @@ void MasterNode::reset_command_counters() const
 std::vector<uint32_t>
 MasterNode::transmit_async_packet(const std::vector<uint32_t>& packet, int timeout) const
 {
-  // TODO: check for valid packet
+  static const auto operation = OperationProfiler::add_operation("MasterNode::transmit_async_packet");
+  ProfiledOperation profile(operation);
+  DeviceTransaction transaction(getClient(), kControlTransaction);
 
-  reset_sub_nodes(getNode("acmd_buf.txbuf"));
+  // TODO: check for valid packet
 
   TLOG_DEBUG(11) << "tx packet: ";
   for (auto t : packet)
     TLOG_DEBUG(11) << std::hex << "0x" << t;
 
   getNode("acmd_buf.txbuf").writeBlock(packet);
-  getClient().dispatch();
 
   // we do not expect a reply
   if (timeout < 0)
   {
+    OperationProfiler::dispatch(getClient(), 0, packet.size());
     std::vector<uint32_t> empty_vector;
     return empty_vector;
   }
@@ -399,44 +532,57 @@ MasterNode::transmit_async_packet(const std::vector<uint32_t>& packet, int timeo
 
   // start time counting
   auto start = std::chrono::high_resolution_clock::now();
+  bool first_status_read = true;
 
-  // Wait for the buffer to be happy
+  // Wait for the buffer to be happy. The first status read shares the dispatch with the packet write.
   while (true) {
 
     buffer_ready = getNode("acmd_buf.stat.ready").read();
     buffer_timeout = getNode("acmd_buf.stat.timeout").read();
-    getClient().dispatch();
+    OperationProfiler::dispatch(getClient(), 2, first_status_read ? packet.size() : 0);
+    first_status_read = false;
     
     TLOG_DEBUG(10) << "async buffer ready: 0x" << buffer_ready.value() << ", timeout: " << buffer_timeout.value();
   
     if (buffer_timeout)
       throw VLCommandReplyTimeout(ERS_HERE);
-     
-    if (buffer_ready)
-      break;
 
     auto now = std::chrono::high_resolution_clock::now();
     auto us_since_start = std::chrono::duration_cast<std::chrono::microseconds>(now - start);
 
-    if (us_since_start.count() > timeout)
-      throw VLCommandReplyBufferFlagTimeout(ERS_HERE, timeout);
+    if (buffer_ready) {
+      auto rx_packet = getNode("acmd_buf.rxbuf").readBlock(0x20);
+      OperationProfiler::dispatch(getClient(), 0x20, 0);
 
-    std::this_thread::sleep_for(std::chrono::microseconds(50));
-  }
-    
-  auto rx_packet = getNode("acmd_buf.rxbuf").readBlock(0x20);
-  getClient().dispatch();
+      bool valid_reply = rx_packet.at(0) == 0xff && rx_packet.at(1) == 0xff && rx_packet.at(2) == packet.at(2);
 
-  if (rx_packet.at(0) != 0xff || rx_packet.at(1) != 0xff || rx_packet.at(2) != packet.at(2))
-  {
-    ers::warning(InvalidVLCommandReplyPacket(ERS_HERE, rx_packet.at(0), rx_packet.at(1), rx_packet.at(2)));
+      if (valid_reply)
+      {
+        TLOG_DEBUG(11) << "async result: ";
+        for (auto r : rx_packet)
+          TLOG_DEBUG(11) << std::hex << "0x" << r;
+
+        return rx_packet.value();
+      }
+
+      // a mismatched sequence may be the ready flag of the previous packet, not yet cleared; it is never returned
+      if (us_since_start.count() > timeout)
+        throw InvalidVLCommandReplyPacket(ERS_HERE, rx_packet.at(0), rx_packet.at(1), rx_packet.at(2));
+    }
+    else if (us_since_start.count() > timeout)
+      throw VLCommandReplyBufferFlagTimeout(ERS_HERE, timeout);
+
+    std::this_thread::sleep_for(std::chrono::microseconds(10));
   }
+}
+//-----------------------------------------------------------------------------
 
-  TLOG_DEBUG(11) << "async result: ";
-  for (auto r : rx_packet)
-    TLOG_DEBUG(11) << std::hex << "0x" << r;
-  
-  return rx_packet.value();
+//-----------------------------------------------------------------------------
+uint8_t // NOLINT(build/unsigned)
+MasterNode::get_next_async_sequence()
+{
+  static std::atomic<uint8_t> sequence(0); // NOLINT(build/unsigned)
+  return ++sequence;
 }
 //-----------------------------------------------------------------------------
 
@@ -444,26 +590,10 @@ MasterNode::transmit_async_packet(const std::vector<uint32_t>& packet, int timeo
 void
 MasterNode::write_endpoint_data(uint16_t endpoint_address, uint8_t reg_address, std::vector<uint8_t> data, bool address_mode) const
 {
-  auto data_length = data.size();
-  if (data_length > 0x3f || data_length == 0)
-  {
-    TLOG() << "invalid data length";
-  }
+  EndpointCommandBuilder commands(endpoint_address, address_mode);
+  commands.add_write(reg_address, data);
 
-  // TODO make sequence a function argument?
-  uint32_t sequence = 0xab;
-  
-  std::vector<uint32_t> tx_packet = { static_cast<uint32_t>(endpoint_address & 0xff), 
-                                      static_cast<uint32_t>(endpoint_address >> 8UL), 
-                                      sequence, 
-                                      // bit 7 = 1 -> write
-                                      static_cast<uint32_t>((0x1 << 7UL) | reg_address),
-                                       static_cast<uint32_t>((address_mode << 7UL) | (0x3f & data_length))
-                                    };
-  tx_packet.insert(tx_packet.end(), data.begin(), data.end());
-  tx_packet.back() = tx_packet.back() | (0x1 << 8UL);
-
-  auto result = transmit_async_packet(tx_packet);
+  transmit_endpoint_commands(commands);
 }
 //-----------------------------------------------------------------------------
 
@@ -471,31 +601,31 @@ MasterNode::write_endpoint_data(uint16_t endpoint_address, uint8_t reg_address,
 std::vector<uint32_t>
 MasterNode::read_endpoint_data(uint16_t endpoint_address, uint8_t reg_address, uint8_t data_length, bool address_mode) const
 {
-  if (data_length > 0x3f || data_length == 0)
-  {
-    TLOG() << "invalid data length";
-    // TODO throw something
-  }
+  EndpointCommandBuilder commands(endpoint_address, address_mode);
+  auto transaction = commands.add_read(reg_address, data_length);
 
-  // TODO make sequence a function argument?
-  uint32_t sequence = 0xab;
-  std::vector<uint32_t> tx_packet = { static_cast<uint32_t>(endpoint_address & 0xff), 
-                                      static_cast<uint32_t>(endpoint_address >> 8UL), 
-                                      sequence,
-                                      // bit 7 = 0 -> read
-                                      reg_address,
-                                      static_cast<uint32_t>((0x1 << 8UL) | (address_mode << 7UL) | (0x3f & data_length))
-                                      };
+  return transmit_endpoint_commands(commands).at(transaction);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+std::vector<std::vector<uint32_t>>
+MasterNode::transmit_endpoint_commands(const EndpointCommandBuilder& commands, bool wait_for_reply) const
+{
+  std::vector<std::vector<uint32_t>> results(commands.get_number_of_transactions());
 
-  auto result = transmit_async_packet(tx_packet);
+  for (auto& packet : commands.build_packets()) {
+    // packets carrying reads always need their reply
+    bool reply_expected = wait_for_reply || !packet.read_segments.empty();
 
-  // get parts we actually want
-  std::vector<uint32_t> result_data (result.begin()+3, result.begin()+3+data_length);
-  
-  // strip off the bit 8 which is high for last byte
-  result_data.back() = result_data.back() & 0xff;
+    // rolling sequence, so that a reply can not be mistaken for the one of a previous packet
+    packet.words.at(2) = get_next_async_sequence();
+    auto reply = transmit_async_packet(packet.words, reply_expected ? 500 : -1);
 
-  return result_data;
+    if (reply_expected)
+      commands.parse_reply(packet, reply, results);
+  }
+  return results;
 }
 //-----------------------------------------------------------------------------
 
@@ -516,84 +646,201 @@ void MasterNode::enable_timestamp_broadcast() const
 //-----------------------------------------------------------------------------
 
 //-----------------------------------------------------------------------------
-timingfirmware::EndpointCheckResult
-MasterNode::scan_endpoint(uint16_t endpoint_address, bool control_sfp) const
+void
+MasterNode::check_endpoint(timingfirmware::EndpointCheckResult& endpoint_result, bool control_sfp) const
 {
-  timingfirmware::EndpointCheckResult result;
   auto global = getNode<MasterGlobalNode>("global");
   auto echo = getNode<EchoMonitorNode>("echo_mon");
 
-  timingfirmware::EndpointCheckResult endpoint_result;
-  endpoint_result.address = endpoint_address;
+  uint16_t endpoint_address = endpoint_result.address; // NOLINT(build/unsigned)
+
+  auto start = std::chrono::steady_clock::now();
+  auto phase_start = start;
+  auto phase_time_us = [&phase_start]() {
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - phase_start);
+    phase_start = now;
+    return static_cast<int32_t>(elapsed.count());
+  };
 
   // is endpoint sfp switched on?
   // are any relevant muxes set to correct channel?
   if (control_sfp)
   {
     switch_endpoint_sfp(endpoint_address, true);
-
-    millisleep(100);
+    endpoint_result.sfp_on_time_us = phase_time_us();
   }
 
+  // poll for lock rather than waiting a fixed time for the sfp to settle
   try
   {
+    const uint32_t lock_timeout = 100; // NOLINT(build/unsigned)
+    if (!global.wait_for_upstream_cdr_lock(lock_timeout))
+    {
+      // without lock the resync and echo can only time out; the endpoint is reported dead
+      IssueThrottle::get().warning(UpstreamCDRNotLocked(ERS_HERE, endpoint_address, lock_timeout),
+                                   getClient().uri() + " " + std::to_string(endpoint_address));
+      endpoint_result.lock_time_us = phase_time_us();
+      endpoint_result.total_time_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+      return;
+    }
     global.enable_upstream_endpoint();
+    endpoint_result.lock_time_us = phase_time_us();
+
+    endpoint_result.round_trip_time = echo.send_echo_and_measure_delay();
+    endpoint_result.round_trip_time_measurement_time_us = phase_time_us();
   }
   catch (const timing::ReceiverNotReady& e)
   {
-      switch_endpoint_sfp(endpoint_address, false);
-
-      ers::error(MonitoredEndpointDead(ERS_HERE, endpoint_address));
-
-      return endpoint_result;
+    endpoint_result.total_time_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    return;
+  }
+  catch (const timing::EchoReplyTimeout& e)
+  {
+    endpoint_result.total_time_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    return;
   }
 
   endpoint_result.alive = true;
-  endpoint_result.round_trip_time = echo.send_echo_and_measure_delay();
-  TLOG_DEBUG(5) << "Endpoint at address " << endpoint_address << " alive. RTT: " << endpoint_result.round_trip_time;
 
   auto ept_state = read_endpoint_data(endpoint_address, 0x71, 0x1, 0x1).at(0) & 0xf;
-  TLOG_DEBUG(5) << "Endpoint at address " << endpoint_address << " state: 0x" << std::hex << ept_state;
   endpoint_result.state = ept_state;
+  endpoint_result.state_read_time_us = phase_time_us();
 
   if (ept_state == 0x6)
   {
-    TLOG_DEBUG(5) << "Endpoint at address " << endpoint_address << ", applying delays of: " << 0x0;
-      
     apply_endpoint_delay(endpoint_address, 0x0, 0x0, 0x0, false, false);
       
     endpoint_result.applied_delay = 0x0;
 
-    auto ept_state_after_delays = read_endpoint_data(endpoint_address, 0x71, 0x1, 0x1).at(0) & 0xf;
-    TLOG_DEBUG(5) << "Endpoint at address " << endpoint_address << ", state after delays apply: " << ept_state_after_delays;
-    endpoint_result.state_after_delay_apply = ept_state_after_delays;
-
+    endpoint_result.state_after_delay_apply = read_endpoint_data(endpoint_address, 0x71, 0x1, 0x1).at(0) & 0xf;
     endpoint_result.round_trip_time_after_delay_apply = echo.send_echo_and_measure_delay();
+    endpoint_result.delay_apply_time_us = phase_time_us();
+  }
+
+  endpoint_result.total_time_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+MasterNode::report_endpoint_check(const timingfirmware::EndpointCheckResult& endpoint_result) const
+{
+  auto endpoint_address = endpoint_result.address;
+
+  if (!endpoint_result.alive)
+  {
+    IssueThrottle::get().error(MonitoredEndpointDead(ERS_HERE, endpoint_address),
+                               getClient().uri() + " " + std::to_string(endpoint_address));
+    return;
+  }
+
+  TLOG_DEBUG(5) << "Endpoint at address " << endpoint_address << " alive. RTT: " << endpoint_result.round_trip_time;
+  TLOG_DEBUG(5) << "Endpoint at address " << endpoint_address << " state: 0x" << std::hex << endpoint_result.state;
+
+  if (endpoint_result.state == 0x6)
+  {
+    TLOG_DEBUG(5) << "Endpoint at address " << endpoint_address << ", applied delays of: " << endpoint_result.applied_delay;
+    TLOG_DEBUG(5) << "Endpoint at address " << endpoint_address << ", state after delays apply: " << endpoint_result.state_after_delay_apply;
     TLOG_DEBUG(5) << "Endpoint at address " << endpoint_address << ", RTT after delays apply: " << endpoint_result.round_trip_time_after_delay_apply;
   }
-  else if (ept_state == 0x7 || ept_state == 0x8)
+  else if (endpoint_result.state == 0x7 || endpoint_result.state == 0x8)
   {
     TLOG_DEBUG(5) << "Endpoint at address " << endpoint_address << ", delays not needed";
   }
   else
   {
-    ers::error(MonitoredEndpointUnexpectedState(ERS_HERE, endpoint_address, ept_state));
+    IssueThrottle::get().error(MonitoredEndpointUnexpectedState(ERS_HERE, endpoint_address, endpoint_result.state),
+                               getClient().uri() + " " + std::to_string(endpoint_address));
   }
 
-  if (control_sfp)
+  TLOG_DEBUG(5) << "Endpoint at address " << endpoint_address << " checked in " << endpoint_result.total_time_us
+                << " us (sfp on: " << endpoint_result.sfp_on_time_us << ", lock: " << endpoint_result.lock_time_us
+                << ", rtt: " << endpoint_result.round_trip_time_measurement_time_us
+                << ", state: " << endpoint_result.state_read_time_us
+                << ", delays: " << endpoint_result.delay_apply_time_us << ")";
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+timingfirmware::EndpointCheckResult
+MasterNode::scan_endpoint(uint16_t endpoint_address, bool control_sfp) const
+{
+  timingfirmware::EndpointCheckResult endpoint_result;
+  endpoint_result.address = endpoint_address;
+
+  check_endpoint(endpoint_result, control_sfp);
+
+  if (control_sfp || !endpoint_result.alive)
   {
     switch_endpoint_sfp(endpoint_address, false);
   }
 
+  report_endpoint_check(endpoint_result);
+
   return endpoint_result;
 }
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+timingfirmware::EndpointCheckResultoVector
+MasterNode::scan_endpoints(const std::vector<uint16_t>& endpoint_addresses, bool control_sfp) const
+{
+  timingfirmware::EndpointCheckResultoVector results;
+  results.reserve(endpoint_addresses.size());
+
+  // time spent switching on the sfp of the next endpoint, done at the end of the previous one
+  int32_t next_sfp_on_time_us = -1;
+
+  for (size_t i = 0; i < endpoint_addresses.size(); ++i)
+  {
+    timingfirmware::EndpointCheckResult endpoint_result;
+    endpoint_result.address = endpoint_addresses.at(i);
+
+    bool sfp_already_on = control_sfp && i > 0;
+    check_endpoint(endpoint_result, control_sfp && !sfp_already_on);
+    if (sfp_already_on)
+      endpoint_result.sfp_on_time_us = next_sfp_on_time_us;
+
+    // the upstream link is shared, so the next sfp can only come up once this one is off
+    if (control_sfp || !endpoint_result.alive)
+    {
+      switch_endpoint_sfp(endpoint_result.address, false);
+    }
+
+    if (control_sfp && i + 1 < endpoint_addresses.size())
+    {
+      auto sfp_on_start = std::chrono::steady_clock::now();
+      switch_endpoint_sfp(endpoint_addresses.at(i + 1), true);
+      next_sfp_on_time_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - sfp_on_start).count();
+    }
+
+    // reporting this endpoint overlaps with the settling of the next sfp
+    report_endpoint_check(endpoint_result);
+    results.push_back(endpoint_result);
+  }
+
+  return results;
+}
+//-----------------------------------------------------------------------------
+
 //-----------------------------------------------------------------------------
 void MasterNode::configure_endpoint_command_decoder(uint16_t endpoint_address, uint8_t slot, uint8_t command) const
 {
   write_endpoint_data(endpoint_address, 0x60+slot, {command}, true);
 }
 //-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void MasterNode::configure_endpoint_command_decoder(uint16_t endpoint_address, const std::map<uint8_t, uint8_t>& slot_commands) const
+{
+  // contiguous slots are merged into a single write transaction by the builder
+  EndpointCommandBuilder commands(endpoint_address);
+  for (auto& slot_command : slot_commands)
+    commands.add_write(0x60 + slot_command.first, { slot_command.second });
+
+  transmit_endpoint_commands(commands);
+}
+//-----------------------------------------------------------------------------
 } // namespace timing
 } // namespace dunedaq
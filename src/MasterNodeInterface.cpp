@@ -9,6 +9,7 @@
 #include "timing/MasterNodeInterface.hpp"
 
 #include <string>
+#include <vector>
 
 namespace dunedaq {
 namespace timing {
@@ -61,5 +62,16 @@ MasterNodeInterface::disable_periodic_fl_cmd(uint32_t channel) const // NOLINT(b
 }
 //------------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+timingfirmware::EndpointCheckResultoVector
+MasterNodeInterface::scan_endpoints(const std::vector<uint16_t>& endpoint_addresses, bool control_sfp) const
+{
+  timingfirmware::EndpointCheckResultoVector results;
+  for (auto address : endpoint_addresses)
+    results.push_back(scan_endpoint(address, control_sfp));
+  return results;
+}
+//-----------------------------------------------------------------------------
+
 } // namespace timing
 } // namespace dunedaq
\ No newline at end of file
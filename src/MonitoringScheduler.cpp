@@ -0,0 +1,283 @@
+/**
+ * @file MonitoringScheduler.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "timing/MonitoringScheduler.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace timing {
+
+//-----------------------------------------------------------------------------
+MonitoringScheduler::MonitoringScheduler(const MonitoringBudget& budget)
+  : m_budget(budget)
+  , m_periods({ std::chrono::milliseconds(1000), std::chrono::milliseconds(10000) })
+  , m_dispatch_tokens(budget.dispatches_per_second)
+  , m_i2c_tokens(budget.i2c_transactions_per_second)
+  , m_dispatch_capacity(budget.dispatches_per_second)
+  , m_i2c_capacity(budget.i2c_transactions_per_second)
+  , m_last_refill(Clock::now())
+  , m_dispatches(0)
+  , m_i2c_transactions(0)
+  , m_backoff(1)
+  , m_control_holdoff(200)
+  , m_control_transactions(0)
+  , m_transaction_scheduler(nullptr)
+  , m_stop(false)
+{}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+MonitoringScheduler::~MonitoringScheduler()
+{
+  stop();
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+MonitoringScheduler::set_period(MonitoringTier tier, std::chrono::milliseconds period)
+{
+  std::lock_guard<std::mutex> lock(m_task_mutex);
+  m_periods.at(tier) = period;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+MonitoringScheduler::set_transaction_scheduler(DeviceTransactionScheduler* scheduler)
+{
+  std::lock_guard<std::mutex> lock(m_task_mutex);
+  m_control_transactions = scheduler ? scheduler->get_stats(kControlTransaction).transactions : 0;
+  m_transaction_scheduler = scheduler;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+MonitoringScheduler::add_task(MonitoringTier tier,
+                              const std::string& name,
+                              uint32_t dispatches,       // NOLINT(build/unsigned)
+                              uint32_t i2c_transactions, // NOLINT(build/unsigned)
+                              Collector collect)
+{
+  std::lock_guard<std::mutex> lock(m_task_mutex);
+  m_tasks.push_back({ tier, name, dispatches, i2c_transactions, std::move(collect), Clock::now(), 0, 0, 0, 0 });
+  // a task costing more than a second of budget runs whenever the bucket is full
+  m_dispatch_capacity = std::max<double>(m_dispatch_capacity, dispatches);
+  m_i2c_capacity = std::max<double>(m_i2c_capacity, i2c_transactions);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+MonitoringScheduler::refill(Clock::time_point now)
+{
+  double elapsed = std::chrono::duration<double>(now - m_last_refill).count();
+  m_last_refill = now;
+  m_dispatch_tokens = std::min<double>(m_dispatch_tokens + elapsed * m_budget.dispatches_per_second,
+                                       m_dispatch_capacity);
+  m_i2c_tokens = std::min<double>(m_i2c_tokens + elapsed * m_budget.i2c_transactions_per_second, m_i2c_capacity);
+
+  // relax the backoff one step for each quiet fast period
+  if (m_backoff > 1 && now - std::max(m_last_control, m_last_backoff_change) > m_periods.at(kFastMonitoring) * m_backoff) {
+    m_backoff /= 2;
+    m_last_backoff_change = now;
+  }
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+MonitoringScheduler::check_control_transactions(Clock::time_point now)
+{
+  DeviceTransactionScheduler* scheduler = m_transaction_scheduler;
+  if (!scheduler)
+    return;
+
+  auto control_transactions = scheduler->get_stats(kControlTransaction).transactions;
+  if (control_transactions != m_control_transactions) {
+    m_control_transactions = control_transactions;
+    register_control_activity(now);
+  }
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+MonitoringScheduler::register_control_activity(Clock::time_point now)
+{
+  // a burst of control operations counts once per holdoff
+  if (now - m_last_control > m_control_holdoff && m_backoff < max_backoff) {
+    m_backoff *= 2;
+    m_last_backoff_change = now;
+  }
+  m_last_control = now;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+size_t
+MonitoringScheduler::poll()
+{
+  size_t number_run = 0;
+  std::vector<size_t> skipped;
+
+  while (true) {
+    size_t index;
+    std::string name;
+    Collector collect;
+    {
+      std::lock_guard<std::mutex> lock(m_task_mutex);
+      auto now = Clock::now();
+      check_control_transactions(now);
+      refill(now);
+      bool holdoff = now - m_last_control < m_control_holdoff;
+
+      // most overdue eligible task first
+      index = m_tasks.size();
+      for (size_t i = 0; i < m_tasks.size(); ++i) {
+        auto& task = m_tasks.at(i);
+        if (task.due > now || (holdoff && task.i2c_transactions) ||
+            std::find(skipped.begin(), skipped.end(), i) != skipped.end())
+          continue;
+        if (index == m_tasks.size() || task.due < m_tasks.at(index).due)
+          index = i;
+      }
+      if (index == m_tasks.size())
+        break;
+
+      auto& task = m_tasks.at(index);
+      if (task.dispatches > m_dispatch_tokens || task.i2c_transactions > m_i2c_tokens) {
+        ++task.deferred;
+        skipped.push_back(index);
+        continue;
+      }
+      m_dispatch_tokens -= task.dispatches;
+      m_i2c_tokens -= task.i2c_transactions;
+      m_dispatches += task.dispatches;
+      m_i2c_transactions += task.i2c_transactions;
+      name = task.name;
+      collect = task.collect;
+    }
+
+    auto start = Clock::now();
+    bool failed = false;
+    try {
+      std::lock_guard<std::mutex> lock(m_info_mutex);
+      DeviceTransactionScheduler* scheduler = m_transaction_scheduler;
+      if (scheduler) {
+        DeviceTransaction transaction(*scheduler, kMonitoringTransaction);
+        collect(m_info);
+      } else {
+        collect(m_info);
+      }
+    } catch (const std::exception& e) {
+      failed = true;
+      ers::warning(MonitoringTaskFailed(ERS_HERE, name, e.what()));
+    }
+    auto end = Clock::now();
+
+    std::lock_guard<std::mutex> lock(m_task_mutex);
+    auto& task = m_tasks.at(index);
+    ++task.runs;
+    task.failures += failed;
+    task.last_duration_us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    task.due = end + m_periods.at(task.tier) * m_backoff;
+    ++number_run;
+  }
+  return number_run;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+MonitoringScheduler::notify_control_activity()
+{
+  std::lock_guard<std::mutex> lock(m_task_mutex);
+  register_control_activity(Clock::now());
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+MonitoringScheduler::start(std::chrono::milliseconds tick)
+{
+  stop();
+  m_stop = false;
+  m_worker = std::thread(&MonitoringScheduler::run, this, tick);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+MonitoringScheduler::stop()
+{
+  if (!m_worker.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(m_run_mutex);
+    m_stop = true;
+  }
+  m_run_cv.notify_all();
+  m_worker.join();
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+MonitoringScheduler::run(std::chrono::milliseconds tick)
+{
+  std::unique_lock<std::mutex> lock(m_run_mutex);
+  while (!m_stop) {
+    lock.unlock();
+    poll();
+    lock.lock();
+    m_run_cv.wait_for(lock, tick, [this]() { return m_stop; });
+  }
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+timingfirmwareinfo::TimingDeviceInfo
+MonitoringScheduler::get_info() const
+{
+  std::lock_guard<std::mutex> lock(m_info_mutex);
+  return m_info;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+MonitoringScheduler::get_info(timingfirmwareinfo::MonitoringSchedulerMonitorData& mon_data) const
+{
+  std::lock_guard<std::mutex> lock(m_task_mutex);
+  mon_data.dispatches = m_dispatches;
+  mon_data.i2c_transactions = m_i2c_transactions;
+  mon_data.backoff = m_backoff;
+  mon_data.tasks.clear();
+  for (auto& task : m_tasks) {
+    timingfirmwareinfo::MonitoringTaskStats stats;
+    stats.name = task.name;
+    stats.tier = task.tier;
+    stats.runs = task.runs;
+    stats.deferred = task.deferred;
+    stats.failures = task.failures;
+    stats.last_duration_us = task.last_duration_us;
+    mon_data.tasks.push_back(stats);
+  }
+}
+//-----------------------------------------------------------------------------
+
+} // namespace timing
+} // namespace dunedaq
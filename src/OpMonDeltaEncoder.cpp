@@ -0,0 +1,239 @@
+/**
+ * @file OpMonDeltaEncoder.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "timing/OpMonDeltaEncoder.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <set>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace timing {
+
+namespace {
+
+std::vector<std::string>
+split_path(const std::string& path)
+{
+  std::vector<std::string> elements;
+  size_t start = 1;
+  while (start <= path.size()) {
+    size_t end = path.find('/', start);
+    if (end == std::string::npos)
+      end = path.size();
+    elements.push_back(path.substr(start, end - start));
+    start = end + 1;
+  }
+  return elements;
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+OpMonDeltaEncoder::OpMonDeltaEncoder(uint32_t keyframe_interval, // NOLINT(build/unsigned)
+                                     const std::set<std::string>& counters)
+  : m_keyframe_interval(keyframe_interval)
+  , m_counters(counters)
+  , m_keyframe_requested(true)
+  , m_sequence(0)
+  , m_since_keyframe(0)
+  , m_messages(0)
+  , m_keyframes(0)
+  , m_fields_sent(0)
+  , m_fields_seen(0)
+{
+  for (auto& counter : m_counters)
+    if (counter.find('*') != std::string::npos)
+      m_counter_patterns.push_back(split_path(counter));
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+const std::set<std::string>&
+OpMonDeltaEncoder::get_device_info_counters()
+{
+  static const std::set<std::string> counters = {
+    "/master_info/command_log/polls",
+    "/master_info/command_log/captured",
+    "/master_info/command_log/missed",
+    "/master_info/command_counters/changed/*/counts",
+    "/endpoint_info/event_counter",
+    "/endpoint_info/command_counters/changed/*/counts",
+  };
+  return counters;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+bool
+OpMonDeltaEncoder::is_counter(const std::string& path) const
+{
+  if (m_counters.count(path))
+    return true;
+  if (m_counter_patterns.empty())
+    return false;
+
+  // the decoder adds a delta to the value it holds for the same path, so a pattern may span different entries
+  auto elements = split_path(path);
+  for (auto& pattern : m_counter_patterns) {
+    if (pattern.size() != elements.size())
+      continue;
+    bool match = true;
+    for (size_t i = 0; match && i < pattern.size(); ++i)
+      match = pattern[i] == "*" || pattern[i] == elements[i];
+    if (match)
+      return true;
+  }
+  return false;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+nlohmann::json
+OpMonDeltaEncoder::encode(const nlohmann::json& state)
+{
+  nlohmann::json flat = state.flatten();
+  m_fields_seen += flat.size();
+
+  // idle structures still get a keyframe every interval, which doubles as a heartbeat
+  ++m_since_keyframe;
+  bool keyframe = m_keyframe_requested || (m_keyframe_interval && m_since_keyframe >= m_keyframe_interval);
+
+  nlohmann::json values = nlohmann::json::object();
+  nlohmann::json deltas = nlohmann::json::object();
+  nlohmann::json removed = nlohmann::json::array();
+
+  for (auto it = flat.begin(); it != flat.end(); ++it) {
+    if (keyframe) {
+      values[it.key()] = it.value();
+      continue;
+    }
+
+    auto last = m_last.find(it.key());
+    if (last != m_last.end() && *last == it.value())
+      continue;
+
+    // a counter which went down was reset, and is sent whole
+    if (last != m_last.end() && is_counter(it.key()) && it.value().is_number_integer() &&
+        last->is_number_integer()) {
+      if (it.value().is_number_unsigned() && last->is_number_unsigned()) {
+        auto now = it.value().get<uint64_t>(); // NOLINT(build/unsigned)
+        auto before = last->get<uint64_t>();   // NOLINT(build/unsigned)
+        if (now >= before) {
+          deltas[it.key()] = static_cast<int64_t>(now - before);
+          continue;
+        }
+      } else {
+        auto now = it.value().get<int64_t>();
+        auto before = last->get<int64_t>();
+        if (now >= before) {
+          deltas[it.key()] = now - before;
+          continue;
+        }
+      }
+    }
+    values[it.key()] = it.value();
+  }
+
+  if (!keyframe) {
+    for (auto it = m_last.begin(); it != m_last.end(); ++it)
+      if (!flat.contains(it.key()))
+        removed.push_back(it.key());
+
+    if (values.empty() && deltas.empty() && removed.empty())
+      return nullptr;
+  }
+
+  m_last = std::move(flat);
+
+  nlohmann::json message;
+  message["sequence"] = ++m_sequence;
+  message["keyframe"] = keyframe;
+  message["values"] = std::move(values);
+  message["deltas"] = std::move(deltas);
+  message["removed"] = std::move(removed);
+
+  ++m_messages;
+  m_fields_sent += message["values"].size() + message["deltas"].size();
+  if (keyframe) {
+    ++m_keyframes;
+    m_keyframe_requested = false;
+    m_since_keyframe = 0;
+  }
+  return message;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+OpMonDeltaEncoder::get_info(timingfirmwareinfo::OpMonDeltaEncoderMonitorData& mon_data) const
+{
+  mon_data.messages = m_messages;
+  mon_data.keyframes = m_keyframes;
+  mon_data.fields_sent = m_fields_sent;
+  mon_data.fields_seen = m_fields_seen;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+OpMonDeltaDecoder::OpMonDeltaDecoder()
+  : m_flat(nlohmann::json::object())
+  , m_synchronised(false)
+  , m_sequence(0)
+{}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+bool
+OpMonDeltaDecoder::decode(const nlohmann::json& message)
+{
+  auto sequence = message.at("sequence").get<uint64_t>(); // NOLINT(build/unsigned)
+  bool keyframe = message.at("keyframe").get<bool>();
+
+  if (m_synchronised && !keyframe && sequence != m_sequence + 1) {
+    TLOG_DEBUG(3) << "Missed delta messages " << m_sequence + 1 << " to " << sequence - 1 << ", waiting for a keyframe";
+    m_synchronised = false;
+  }
+  if (!m_synchronised && !keyframe)
+    return false;
+
+  if (keyframe)
+    m_flat = nlohmann::json::object();
+
+  for (auto it = message.at("values").begin(); it != message.at("values").end(); ++it)
+    m_flat[it.key()] = it.value();
+
+  for (auto it = message.at("deltas").begin(); it != message.at("deltas").end(); ++it) {
+    auto& value = m_flat[it.key()];
+    if (value.is_number_unsigned())
+      value = value.get<uint64_t>() + it.value().get<int64_t>(); // NOLINT(build/unsigned)
+    else
+      value = value.get<int64_t>() + it.value().get<int64_t>();
+  }
+
+  for (auto& path : message.at("removed"))
+    m_flat.erase(path.get<std::string>());
+
+  m_sequence = sequence;
+  m_synchronised = true;
+  return true;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+nlohmann::json
+OpMonDeltaDecoder::get_state() const
+{
+  return m_flat.unflatten();
+}
+//-----------------------------------------------------------------------------
+
+} // namespace timing
+} // namespace dunedaq
@@ -0,0 +1,316 @@
+/**
+ * @file OperationProfiler.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "timing/OperationProfiler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace timing {
+
+namespace {
+
+thread_local ProfiledOperation* t_current_operation = nullptr;
+
+// counters have a single writer, so a plain load and store is enough
+inline void
+add(std::atomic<uint64_t>& counter, uint64_t value) // NOLINT(build/unsigned)
+{
+  counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+} // namespace
+
+struct OperationProfiler::ThreadCounters
+{
+  std::atomic<uint64_t> calls{ 0 };         // NOLINT(build/unsigned)
+  std::atomic<uint64_t> dispatches{ 0 };    // NOLINT(build/unsigned)
+  std::atomic<uint64_t> words_read{ 0 };    // NOLINT(build/unsigned)
+  std::atomic<uint64_t> words_written{ 0 }; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> total_ns{ 0 };      // NOLINT(build/unsigned)
+  std::atomic<uint64_t> max_ns{ 0 };        // NOLINT(build/unsigned)
+
+  std::atomic<uint64_t> min_ns{ std::numeric_limits<uint64_t>::max() }; // NOLINT(build/unsigned)
+  std::array<std::atomic<uint64_t>, OperationProfiler::number_of_buckets> histogram{}; // NOLINT(build/unsigned)
+};
+
+struct OperationProfiler::Registry
+{
+  std::mutex mutex;
+  std::vector<std::string> names;
+  // per operation, one set of counters for each thread which ran it
+  std::vector<std::vector<std::unique_ptr<ThreadCounters>>> counters;
+  // per operation, counters left by threads which exited
+  std::vector<std::vector<ThreadCounters*>> released;
+};
+
+/**
+ * @brief      Counters used by one thread, released when it exits.
+ */
+struct OperationProfiler::ThreadCountersOwner
+{
+  std::vector<ThreadCounters*> counters;
+
+  ~ThreadCountersOwner()
+  {
+    Registry& registry = get_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (size_t id = 0; id < counters.size(); ++id)
+      if (counters[id])
+        registry.released.at(id).push_back(counters[id]);
+  }
+};
+
+std::atomic<bool> OperationProfiler::s_enabled(true);
+
+//-----------------------------------------------------------------------------
+OperationProfiler::Registry&
+OperationProfiler::get_registry()
+{
+  static Registry registry;
+  return registry;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+OperationProfiler::OperationId
+OperationProfiler::add_operation(const std::string& name)
+{
+  Registry& registry = get_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  auto it = std::find(registry.names.begin(), registry.names.end(), name);
+  if (it != registry.names.end())
+    return it - registry.names.begin();
+
+  registry.names.push_back(name);
+  registry.counters.emplace_back();
+  registry.released.emplace_back();
+  return registry.names.size() - 1;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+OperationProfiler::ThreadCounters*
+OperationProfiler::get_thread_counters(OperationId id)
+{
+  // the registry must be constructed first, so that it outlives the counters of the thread
+  Registry& registry = get_registry();
+  thread_local ThreadCountersOwner owner;
+  auto& thread_counters = owner.counters;
+
+  if (id < thread_counters.size() && thread_counters[id])
+    return thread_counters[id];
+
+  // first call of this operation on this thread: reuse the counters of an exited thread if any
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  ThreadCounters* counters;
+  auto& released = registry.released.at(id);
+  if (!released.empty()) {
+    counters = released.back();
+    released.pop_back();
+  } else {
+    registry.counters.at(id).push_back(std::make_unique<ThreadCounters>());
+    counters = registry.counters.at(id).back().get();
+  }
+  if (thread_counters.size() <= id)
+    thread_counters.resize(id + 1, nullptr);
+  thread_counters[id] = counters;
+  return counters;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+OperationProfiler::dispatch(uhal::ClientInterface& client,
+                            uint32_t words_read,    // NOLINT(build/unsigned)
+                            uint32_t words_written) // NOLINT(build/unsigned)
+{
+  client.dispatch();
+  record_dispatch(words_read, words_written);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+OperationProfiler::record_dispatch(uint32_t words_read, uint32_t words_written) // NOLINT(build/unsigned)
+{
+  for (auto operation = t_current_operation; operation; operation = operation->m_parent) {
+    add(operation->m_counters->dispatches, 1);
+    add(operation->m_counters->words_read, words_read);
+    add(operation->m_counters->words_written, words_written);
+  }
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+OperationProfiler::set_enabled(bool enabled)
+{
+  s_enabled.store(enabled, std::memory_order_relaxed);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+size_t
+OperationProfiler::get_bucket(uint64_t value_ns) // NOLINT(build/unsigned)
+{
+  // exact below 2^(bits+1), then 2^bits sub-buckets per power of two
+  if (value_ns < (1ul << (sub_bucket_bits + 1)))
+    return value_ns;
+  size_t msb = 63 - __builtin_clzll(value_ns);
+  size_t shift = msb - sub_bucket_bits;
+  return (shift << sub_bucket_bits) + (value_ns >> shift);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+uint64_t // NOLINT(build/unsigned)
+OperationProfiler::get_bucket_limit(size_t bucket)
+{
+  if (bucket < (1ul << (sub_bucket_bits + 1)))
+    return bucket;
+  size_t shift = (bucket >> sub_bucket_bits) - 1;
+  uint64_t mantissa = bucket - (shift << sub_bucket_bits); // NOLINT(build/unsigned)
+  return ((mantissa + 1) << shift) - 1;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+std::vector<OperationStatistics>
+OperationProfiler::get_statistics()
+{
+  Registry& registry = get_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+
+  std::vector<OperationStatistics> statistics;
+  for (size_t i = 0; i < registry.names.size(); ++i) {
+    OperationStatistics operation;
+    operation.name = registry.names.at(i);
+
+    uint64_t min_ns = std::numeric_limits<uint64_t>::max(); // NOLINT(build/unsigned)
+    std::array<uint64_t, number_of_buckets> histogram{};    // NOLINT(build/unsigned)
+    for (auto& counters : registry.counters.at(i)) {
+      operation.calls += counters->calls.load(std::memory_order_relaxed);
+      operation.dispatches += counters->dispatches.load(std::memory_order_relaxed);
+      operation.words_read += counters->words_read.load(std::memory_order_relaxed);
+      operation.words_written += counters->words_written.load(std::memory_order_relaxed);
+      operation.total_ns += counters->total_ns.load(std::memory_order_relaxed);
+      min_ns = std::min(min_ns, counters->min_ns.load(std::memory_order_relaxed));
+      operation.max_ns = std::max(operation.max_ns, counters->max_ns.load(std::memory_order_relaxed));
+      for (size_t b = 0; b < number_of_buckets; ++b)
+        histogram[b] += counters->histogram[b].load(std::memory_order_relaxed);
+    }
+
+    if (operation.calls) {
+      operation.min_ns = min_ns;
+
+      // percentiles are the upper limit of the bucket, but never above the maximum
+      std::array<std::pair<double, uint64_t*>, 3> quantiles{ { // NOLINT(build/unsigned)
+        { 0.5, &operation.p50_ns },
+        { 0.9, &operation.p90_ns },
+        { 0.99, &operation.p99_ns } } };
+      uint64_t total = 0; // NOLINT(build/unsigned)
+      size_t q = 0;
+      for (size_t b = 0; b < histogram.size() && q < quantiles.size(); ++b) {
+        total += histogram[b];
+        for (; q < quantiles.size() && total >= quantiles[q].first * operation.calls; ++q)
+          *quantiles[q].second = std::min(get_bucket_limit(b), operation.max_ns);
+      }
+    }
+    statistics.push_back(operation);
+  }
+  return statistics;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+OperationProfiler::reset()
+{
+  Registry& registry = get_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (auto& operation : registry.counters) {
+    for (auto& counters : operation) {
+      counters->calls.store(0, std::memory_order_relaxed);
+      counters->dispatches.store(0, std::memory_order_relaxed);
+      counters->words_read.store(0, std::memory_order_relaxed);
+      counters->words_written.store(0, std::memory_order_relaxed);
+      counters->total_ns.store(0, std::memory_order_relaxed);
+      counters->min_ns.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+      counters->max_ns.store(0, std::memory_order_relaxed);
+      for (auto& bucket : counters->histogram)
+        bucket.store(0, std::memory_order_relaxed);
+    }
+  }
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+OperationProfiler::get_info(timingfirmwareinfo::OperationProfilerMonitorData& mon_data)
+{
+  mon_data.operations.clear();
+  for (auto& operation : get_statistics()) {
+    timingfirmwareinfo::OperationStatisticsData data;
+    data.name = operation.name;
+    data.calls = operation.calls;
+    data.dispatches = operation.dispatches;
+    data.words_read = operation.words_read;
+    data.words_written = operation.words_written;
+    data.total_ns = operation.total_ns;
+    data.min_ns = operation.min_ns;
+    data.max_ns = operation.max_ns;
+    data.p50_ns = operation.p50_ns;
+    data.p90_ns = operation.p90_ns;
+    data.p99_ns = operation.p99_ns;
+    mon_data.operations.push_back(data);
+  }
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+ProfiledOperation::ProfiledOperation(OperationProfiler::OperationId id)
+  : m_counters(OperationProfiler::is_enabled() ? OperationProfiler::get_thread_counters(id) : nullptr)
+  , m_parent(t_current_operation)
+{
+  if (!m_counters)
+    return;
+  t_current_operation = this;
+  m_start = std::chrono::steady_clock::now();
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+ProfiledOperation::~ProfiledOperation()
+{
+  if (!m_counters)
+    return;
+  uint64_t elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>( // NOLINT(build/unsigned)
+                          std::chrono::steady_clock::now() - m_start)
+                          .count();
+  t_current_operation = m_parent;
+
+  add(m_counters->calls, 1);
+  add(m_counters->total_ns, elapsed_ns);
+  if (elapsed_ns < m_counters->min_ns.load(std::memory_order_relaxed))
+    m_counters->min_ns.store(elapsed_ns, std::memory_order_relaxed);
+  if (elapsed_ns > m_counters->max_ns.load(std::memory_order_relaxed))
+    m_counters->max_ns.store(elapsed_ns, std::memory_order_relaxed);
+  add(m_counters->histogram[OperationProfiler::get_bucket(elapsed_ns)], 1);
+}
+//-----------------------------------------------------------------------------
+
+} // namespace timing
+} // namespace dunedaq
@@ -7,6 +7,7 @@
  */
 
 #include "timing/PC059IONode.hpp"
+#include "timing/DeviceTransactionScheduler.hpp"
 
 #include "logging/Logging.hpp"
 
@@ -53,6 +54,8 @@ PC059IONode::get_status(bool print_out) const
 void
 PC059IONode::reset(const std::string& clock_config_file) const
 {
+  DeviceMuxLock mux_lock(getClient(), kControlTransaction);
+
   // Soft reset
   write_soft_reset_register();
 
@@ -153,6 +156,7 @@ PC059IONode::switch_sfp_i2c_mux_channel(uint32_t sfp_id) const // NOLINT(build/u
 std::string
 PC059IONode::get_sfp_status(uint32_t sfp_id, bool print_out) const // NOLINT(build/unsigned)
 {
+  DeviceMuxLock mux_lock(getClient(), kMonitoringTransaction);
   // on this board the upstream sfp has its own i2c bus, and the 8 downstream sfps are muxed onto the main i2c bus
   std::stringstream status;
   uint32_t sfp_bus_index; // NOLINT(build/unsigned)
@@ -176,10 +180,31 @@ PC059IONode::get_sfp_status(uint32_t sfp_id, bool print_out) const // NOLINT(bui
 }
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+void
+PC059IONode::get_sfp_info(uint32_t sfp_id, timinghardwareinfo::TimingSFPMonitorData& mon_data) const // NOLINT(build/unsigned)
+{
+  DeviceMuxLock mux_lock(getClient(), kMonitoringTransaction);
+
+  uint32_t sfp_bus_index; // NOLINT(build/unsigned)
+  if (sfp_id == 0) {
+    sfp_bus_index = 0;
+  } else if (sfp_id > 0 && sfp_id < 9) {
+    switch_sfp_i2c_mux_channel(sfp_id - 1);
+    sfp_bus_index = 1;
+  } else {
+    throw InvalidSFPId(ERS_HERE, format_reg_value(sfp_id));
+  }
+  auto sfp = get_i2c_device<I2CSFPSlave>(m_sfp_i2c_buses.at(sfp_bus_index), "SFP_EEProm");
+  sfp->get_info(mon_data);
+}
+//-----------------------------------------------------------------------------
+
 //-----------------------------------------------------------------------------
 void
 PC059IONode::switch_sfp_soft_tx_control_bit(uint32_t sfp_id, bool turn_on) const // NOLINT(build/unsigned)
 {
+  DeviceMuxLock mux_lock(getClient(), kControlTransaction);
   // on this board the upstream sfp has its own i2c bus, and the 8 downstream sfps are muxed onto the main i2c bus
   uint32_t sfp_bus_index; // NOLINT(build/unsigned)
   if (sfp_id == 0) {
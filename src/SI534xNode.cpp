@@ -12,6 +12,9 @@
 #include "ers/ers.hpp"
 #include "logging/Logging.hpp"
 
+#include "timing/DeviceTransactionScheduler.hpp"
+#include "timing/IssueThrottle.hpp"
+#include "timing/OperationProfiler.hpp"
 #include "timing/toolbox.hpp"
 
 #include <boost/algorithm/string/predicate.hpp>
@@ -187,6 +190,8 @@ SI534xSlave::read_config_section(std::ifstream& file, std::string tag) const
 void
 SI534xSlave::configure(const std::string& filename) const
 {
+  static const auto operation = OperationProfiler::add_operation("SI534xSlave::configure");
+  ProfiledOperation profile(operation);
 
   throw_if_not_file(filename);
 
@@ -256,6 +261,9 @@ SI534xSlave::upload_config(const std::vector<SI534xSlave::RegisterSetting_t>& co
   size_t k(0), notify_percent(10);
   size_t notify_every = (notify_percent < config.size() ? config.size() / notify_percent : 1);
 
+  // a failing bus fails every register, so the retries of one chip are throttled together
+  std::string issue_context = get_master_uri() + " " + get_master_id() + " " + format_reg_value(get_i2c_address());
+
   for (const auto& setting : config) {
     std::stringstream debug_stream;
     debug_stream << std::showbase << std::hex << "Writing to " << (uint32_t)setting.get<0>() // NOLINT(build/unsigned)
@@ -266,13 +274,15 @@ SI534xSlave::upload_config(const std::vector<SI534xSlave::RegisterSetting_t>& co
     while (attempt < max_attempts) {
       TLOG_DEBUG(9) << "Attempt " << attempt;
       if (attempt > 0) {
-        ers::warning(SI534xRegWriteRetry(ERS_HERE,
-                                         format_reg_value(attempt, 10),
-                                         format_reg_value((uint32_t)setting.get<0>()))); // NOLINT(build/unsigned)
+        IssueThrottle::get().warning(SI534xRegWriteRetry(ERS_HERE,
+                                                         format_reg_value(attempt, 10),
+                                                         format_reg_value((uint32_t)setting.get<0>())), // NOLINT(build/unsigned)
+                                     issue_context);
       }
       try {
         this->write_clock_register(setting.get<0>(), setting.get<1>());
       } catch (const std::exception& e) {
+        // every failure is reported, as each one leaves a register of the configuration unwritten
         ers::error(SI534xRegWriteFailed(ERS_HERE,
                                         format_reg_value((uint32_t)setting.get<0>()), // NOLINT(build/unsigned)
                                         format_reg_value((uint32_t)setting.get<1>()), // NOLINT(build/unsigned)
@@ -288,6 +298,9 @@ SI534xSlave::upload_config(const std::vector<SI534xSlave::RegisterSetting_t>& co
       TLOG_DEBUG(9) << (k / notify_every) * notify_percent << "%";
     }
   }
+
+  // the retries of this upload are summarised now, not at the next issue of the process
+  IssueThrottle::get().flush();
 }
 //-----------------------------------------------------------------------------
 
@@ -342,6 +355,9 @@ SI534xSlave::registers() const
  void
  SI534xSlave::get_info(timinghardwareinfo::TimingPLLMonitorData& mon_data) const
  {
+  // the I2C sequences yield to control transactions between bytes
+  DeviceTransaction transaction(get_i2c_master().getClient(), kMonitoringTransaction);
+
   mon_data.config_id = this->read_config_id();
 
   //lPLLVersion["Part number"] = pll->read_device_version();
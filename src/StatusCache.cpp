@@ -0,0 +1,310 @@
+/**
+ * @file StatusCache.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "timing/StatusCache.hpp"
+
+#include "timing/toolbox.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dunedaq {
+namespace timing {
+
+namespace {
+
+constexpr uint32_t kStatusCacheMagic = 0x54534331; // "TSC1" // NOLINT(build/unsigned)
+constexpr uint32_t kStatusCacheLayout = 2;         // NOLINT(build/unsigned)
+constexpr size_t kStatusCacheReadAttempts = 1000;
+
+struct alignas(64) SegmentHeader
+{
+  std::atomic<uint32_t> magic;                 // NOLINT(build/unsigned)
+  uint32_t layout;                             // NOLINT(build/unsigned)
+  uint64_t capacity;                           // NOLINT(build/unsigned)
+  std::atomic<uint64_t> sequence;              // NOLINT(build/unsigned)
+  std::atomic<uint64_t> version;               // NOLINT(build/unsigned)
+  std::atomic<int64_t> published_realtime_ns;
+  std::atomic<uint64_t> size;                  // NOLINT(build/unsigned)
+  std::atomic<int32_t> writer_pid;
+};
+
+inline bool
+is_process_alive(pid_t pid)
+{
+  // EPERM means the process exists but belongs to someone else
+  return pid > 0 && (kill(pid, 0) == 0 || errno == EPERM);
+}
+
+/// pid of the live writer of a segment, or 0 if there is none
+pid_t
+get_live_writer(const std::string& name)
+{
+  int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd < 0)
+    return 0;
+
+  pid_t pid = 0;
+  struct stat info;
+  if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(SegmentHeader)) {
+    void* segment = mmap(nullptr, sizeof(SegmentHeader), PROT_READ, MAP_SHARED, fd, 0);
+    if (segment != MAP_FAILED) {
+      auto header = static_cast<const SegmentHeader*>(segment);
+      // segments of an older layout have no pid, they are left to their readers
+      if (header->magic.load(std::memory_order_acquire) == kStatusCacheMagic && header->layout == kStatusCacheLayout)
+        pid = header->writer_pid.load(std::memory_order_relaxed);
+      munmap(segment, sizeof(SegmentHeader));
+    }
+  }
+  close(fd);
+  return is_process_alive(pid) ? pid : 0;
+}
+
+inline uint8_t* // NOLINT(build/unsigned)
+get_payload(void* segment)
+{
+  return static_cast<uint8_t*>(segment) + sizeof(SegmentHeader); // NOLINT(build/unsigned)
+}
+
+inline const uint8_t* // NOLINT(build/unsigned)
+get_payload(const void* segment)
+{
+  return static_cast<const uint8_t*>(segment) + sizeof(SegmentHeader); // NOLINT(build/unsigned)
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+std::string
+get_status_cache_name(const std::string& device)
+{
+  std::string name = "/timing_status." + device;
+  std::replace(name.begin() + 1, name.end(), '/', '_');
+  return name;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+StatusCacheWriter::StatusCacheWriter(const std::string& device, size_t capacity)
+  : m_name(get_status_cache_name(device))
+  , m_capacity(capacity)
+  , m_segment(nullptr)
+  , m_segment_size(sizeof(SegmentHeader) + capacity)
+  , m_version(0)
+{
+  auto live_writer = get_live_writer(m_name);
+  if (live_writer)
+    throw StatusCacheError(ERS_HERE, m_name, "already published by running process " + std::to_string(live_writer));
+
+  // a segment left by a writer which died stays with the readers attached to it, until they see it is stale
+  shm_unlink(m_name.c_str());
+
+  int fd = shm_open(m_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0)
+    throw StatusCacheError(ERS_HERE, m_name, std::string("shm_open failed: ") + std::strerror(errno));
+
+  if (ftruncate(fd, m_segment_size) < 0) {
+    std::string reason = std::string("ftruncate failed: ") + std::strerror(errno);
+    close(fd);
+    shm_unlink(m_name.c_str());
+    throw StatusCacheError(ERS_HERE, m_name, reason);
+  }
+
+  m_segment = mmap(nullptr, m_segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (m_segment == MAP_FAILED) {
+    shm_unlink(m_name.c_str());
+    throw StatusCacheError(ERS_HERE, m_name, std::string("mmap failed: ") + std::strerror(errno));
+  }
+
+  // the segment is zero filled, so readers see no snapshot until the magic is set
+  auto header = new (m_segment) SegmentHeader();
+  header->layout = kStatusCacheLayout;
+  header->capacity = capacity;
+  header->writer_pid.store(getpid(), std::memory_order_relaxed);
+  header->magic.store(kStatusCacheMagic, std::memory_order_release);
+
+  TLOG_DEBUG(2) << "Created status cache " << m_name << " of " << capacity << " bytes";
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+StatusCacheWriter::~StatusCacheWriter()
+{
+  static_cast<SegmentHeader*>(m_segment)->writer_pid.store(0, std::memory_order_relaxed);
+  munmap(m_segment, m_segment_size);
+  shm_unlink(m_name.c_str());
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+uint64_t // NOLINT(build/unsigned)
+StatusCacheWriter::publish(const nlohmann::json& data)
+{
+  // serialise before taking the lock, so that readers only wait for the copy
+  m_buffer.clear();
+  nlohmann::json::to_msgpack(data, m_buffer);
+  if (m_buffer.size() > m_capacity)
+    throw StatusCacheSnapshotTooLarge(ERS_HERE, m_name, m_buffer.size(), m_capacity);
+
+  auto header = static_cast<SegmentHeader*>(m_segment);
+  auto sequence = header->sequence.load(std::memory_order_relaxed);
+
+  header->sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  std::memcpy(get_payload(m_segment), m_buffer.data(), m_buffer.size());
+  header->size.store(m_buffer.size(), std::memory_order_relaxed);
+  header->version.store(++m_version, std::memory_order_relaxed);
+  header->published_realtime_ns.store(get_nanoseconds_since_epoch(), std::memory_order_relaxed);
+
+  header->sequence.store(sequence + 2, std::memory_order_release);
+  return m_version;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+StatusCacheReader::StatusCacheReader(const std::string& device)
+  : m_name(get_status_cache_name(device))
+  , m_inode(0)
+  , m_segment(nullptr)
+  , m_segment_size(0)
+{
+  int fd = shm_open(m_name.c_str(), O_RDONLY, 0);
+  if (fd < 0)
+    throw StatusCacheError(ERS_HERE, m_name, std::string("shm_open failed: ") + std::strerror(errno));
+
+  struct stat info;
+  if (fstat(fd, &info) < 0 || static_cast<size_t>(info.st_size) < sizeof(SegmentHeader)) {
+    close(fd);
+    throw StatusCacheError(ERS_HERE, m_name, "segment not initialised");
+  }
+  m_segment_size = info.st_size;
+  m_inode = info.st_ino;
+
+  m_segment = mmap(nullptr, m_segment_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (m_segment == MAP_FAILED)
+    throw StatusCacheError(ERS_HERE, m_name, std::string("mmap failed: ") + std::strerror(errno));
+
+  auto header = static_cast<const SegmentHeader*>(m_segment);
+  if (header->magic.load(std::memory_order_acquire) != kStatusCacheMagic || header->layout != kStatusCacheLayout ||
+      sizeof(SegmentHeader) + header->capacity > m_segment_size) {
+    munmap(const_cast<void*>(m_segment), m_segment_size);
+    throw StatusCacheError(ERS_HERE, m_name, "segment not initialised, or of an unknown layout");
+  }
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+StatusCacheReader::~StatusCacheReader()
+{
+  munmap(const_cast<void*>(m_segment), m_segment_size);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+StatusSnapshot
+StatusCacheReader::read() const
+{
+  auto header = static_cast<const SegmentHeader*>(m_segment);
+  StatusSnapshot snapshot;
+
+  for (size_t attempt = 0; attempt < kStatusCacheReadAttempts; ++attempt) {
+    auto sequence = header->sequence.load(std::memory_order_acquire);
+    if (!sequence)
+      throw StatusCacheError(ERS_HERE, m_name, "nothing published yet");
+    if (sequence & 0x1) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    auto size = std::min<uint64_t>(header->size.load(std::memory_order_relaxed), header->capacity); // NOLINT(build/unsigned)
+    snapshot.version = header->version.load(std::memory_order_relaxed);
+    snapshot.published_realtime_ns = header->published_realtime_ns.load(std::memory_order_relaxed);
+    m_buffer.resize(size);
+    std::memcpy(m_buffer.data(), get_payload(m_segment), size);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (header->sequence.load(std::memory_order_relaxed) == sequence) {
+      snapshot.data = nlohmann::json::from_msgpack(m_buffer);
+      return snapshot;
+    }
+  }
+  throw StatusCacheError(ERS_HERE, m_name, "snapshot kept changing while being read");
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+bool
+StatusCacheReader::read_if_newer(uint64_t version, StatusSnapshot& snapshot) const // NOLINT(build/unsigned)
+{
+  if (get_version() <= version)
+    return false;
+  snapshot = read();
+  return true;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+timingfirmwareinfo::TimingDeviceInfo
+StatusCacheReader::read_info() const
+{
+  return read().data.at("info").get<timingfirmwareinfo::TimingDeviceInfo>();
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+uint64_t // NOLINT(build/unsigned)
+StatusCacheReader::get_version() const
+{
+  return static_cast<const SegmentHeader*>(m_segment)->version.load(std::memory_order_relaxed);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+int
+StatusCacheReader::get_writer_pid() const
+{
+  return static_cast<const SegmentHeader*>(m_segment)->writer_pid.load(std::memory_order_relaxed);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+bool
+StatusCacheReader::is_stale() const
+{
+  if (!is_process_alive(get_writer_pid()))
+    return true;
+
+  // a new writer may have replaced the segment under the same name
+  int fd = shm_open(m_name.c_str(), O_RDONLY, 0);
+  if (fd < 0)
+    return true;
+  struct stat info;
+  bool replaced = fstat(fd, &info) < 0 || info.st_ino != m_inode;
+  close(fd);
+  return replaced;
+}
+//-----------------------------------------------------------------------------
+
+} // namespace timing
+} // namespace dunedaq
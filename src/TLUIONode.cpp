@@ -146,6 +146,14 @@ TLUIONode::get_sfp_status(uint32_t /*sfp_id*/, bool /*print_out*/) const // NOLI
 }
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+void
+TLUIONode::get_sfp_info(uint32_t /*sfp_id*/, timinghardwareinfo::TimingSFPMonitorData& mon_data) const // NOLINT(build/unsigned)
+{
+  mon_data.data_valid = false;
+}
+//-----------------------------------------------------------------------------
+
 //-----------------------------------------------------------------------------
 void
 TLUIONode::switch_sfp_soft_tx_control_bit(uint32_t /*sfp_id*/, bool /*turn_on*/) const // NOLINT(build/unsigned)
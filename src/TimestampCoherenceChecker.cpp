@@ -0,0 +1,243 @@
+/**
+ * @file TimestampCoherenceChecker.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "timing/TimestampCoherenceChecker.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace timing {
+
+//-----------------------------------------------------------------------------
+TimestampCoherenceChecker::TimestampCoherenceChecker(const MasterNode& master,
+                                                     uint32_t clock_frequency_hz, // NOLINT(build/unsigned)
+                                                     int64_t tolerance_ns)
+  : m_master(master)
+  , m_clock_frequency_hz(clock_frequency_hz)
+  , m_tolerance_ns(tolerance_ns)
+  , m_check_generation(0)
+  , m_boards_pending(0)
+  , m_readers_stop(false)
+  , m_number_of_checks(0)
+  , m_number_of_incoherent(0)
+  , m_stop(false)
+{
+  // the master is always the first timestamp of the first board
+  m_boards.push_back({ &master.getClient(), { &master.getNode("tstamp.ctr") }, {}, true });
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+TimestampCoherenceChecker::~TimestampCoherenceChecker()
+{
+  stop();
+  {
+    std::lock_guard<std::mutex> lock(m_readers_mutex);
+    m_readers_stop = true;
+  }
+  m_readers_cv.notify_all();
+  for (auto& reader : m_readers)
+    reader.join();
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+TimestampCoherenceChecker::add_endpoint(const std::string& name, const EndpointNode& endpoint, int64_t cable_delay_ns)
+{
+  std::lock_guard<std::mutex> check_lock(m_check_mutex);
+  m_endpoints.push_back({ name, &endpoint, cable_delay_ns });
+
+  auto board = m_boards.begin();
+  while (board != m_boards.end() && board->client != &endpoint.getClient())
+    ++board;
+  if (board == m_boards.end())
+    board = m_boards.insert(board, { &endpoint.getClient(), {}, {}, false });
+
+  board->timestamp_nodes.push_back(&endpoint.getNode("tstamp"));
+  board->endpoints.push_back(m_endpoints.size() - 1);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+std::vector<TimestampCoherenceResult>
+TimestampCoherenceChecker::check()
+{
+  std::lock_guard<std::mutex> check_lock(m_check_mutex);
+
+  std::vector<std::vector<TimestampSample>> board_samples;
+  {
+    // one reader thread and one dispatch per board
+    std::unique_lock<std::mutex> lock(m_readers_mutex);
+    while (m_readers.size() < m_boards.size())
+      m_readers.emplace_back(&TimestampCoherenceChecker::read_board, this, m_readers.size());
+
+    m_board_samples.assign(m_boards.size(), {});
+    m_boards_pending = m_boards.size();
+    ++m_check_generation;
+    m_readers_cv.notify_all();
+    m_readers_done_cv.wait(lock, [this]() { return m_boards_pending == 0; });
+    board_samples.swap(m_board_samples);
+  }
+
+  std::vector<TimestampCoherenceResult> results(m_endpoints.size());
+  for (size_t i = 0; i < m_endpoints.size(); ++i)
+    results.at(i).name = m_endpoints.at(i).name;
+
+  const auto& master_samples = board_samples.front();
+  if (!master_samples.empty()) {
+    const TimestampSample& master = master_samples.front();
+    const int64_t master_time = master.monotonic_before_ns + master.round_trip_ns / 2;
+
+    for (size_t b = 0; b < m_boards.size(); ++b) {
+      const auto& board = m_boards.at(b);
+      const auto& samples = board_samples.at(b);
+      if (samples.empty())
+        continue;
+
+      // the master occupies the first slot of its own board
+      size_t first = board.has_master ? 1 : 0;
+      for (size_t j = 0; j < board.endpoints.size(); ++j) {
+        const TimestampSample& sample = samples.at(first + j);
+        const Endpoint& endpoint = m_endpoints.at(board.endpoints.at(j));
+        TimestampCoherenceResult& result = results.at(board.endpoints.at(j));
+
+        // endpoint minus master time, less the host time which passed between the two reads
+        const int64_t skew_ns = sample.monotonic_before_ns + sample.round_trip_ns / 2 - master_time;
+        const int64_t difference_ticks = static_cast<int64_t>(sample.timestamp - master.timestamp);
+        const double difference_ns = difference_ticks * 1e9 / m_clock_frequency_hz;
+
+        result.sampled = true;
+        result.timestamp = sample.timestamp;
+        result.offset_ns = static_cast<int64_t>(difference_ns) - skew_ns + endpoint.cable_delay_ns;
+        result.uncertainty_ns = (sample.round_trip_ns + master.round_trip_ns) / 2;
+        result.round_trip_ns = sample.round_trip_ns;
+        result.in_tolerance = std::llabs(result.offset_ns) <= m_tolerance_ns + result.uncertainty_ns;
+      }
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(m_results_mutex);
+  ++m_number_of_checks;
+  for (auto& result : results)
+    if (result.sampled && !result.in_tolerance)
+      ++m_number_of_incoherent;
+  m_last_results = results;
+  return results;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+TimestampCoherenceChecker::read_board(size_t board)
+{
+  std::unique_lock<std::mutex> lock(m_readers_mutex);
+  // started inside a check, which this reader takes part in
+  uint64_t generation = m_check_generation - 1; // NOLINT(build/unsigned)
+  while (true) {
+    m_readers_cv.wait(lock, [this, generation]() { return m_readers_stop || m_check_generation != generation; });
+    if (m_readers_stop)
+      return;
+    generation = m_check_generation;
+    lock.unlock();
+
+    // m_boards is not modified while a check is running
+    std::vector<TimestampSample> samples;
+    try {
+      samples = TimingNode::sample_timestamps(m_boards.at(board).timestamp_nodes);
+    } catch (const std::exception& e) {
+      TLOG_DEBUG(3) << "Failed to sample timestamps through " << m_boards.at(board).client->uri() << ": " << e.what();
+    }
+
+    lock.lock();
+    m_board_samples.at(board).swap(samples);
+    if (--m_boards_pending == 0)
+      m_readers_done_cv.notify_all();
+  }
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+TimestampCoherenceChecker::start(std::chrono::milliseconds period)
+{
+  stop();
+  m_stop = false;
+  m_worker = std::thread(&TimestampCoherenceChecker::run, this, period);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+TimestampCoherenceChecker::stop()
+{
+  if (!m_worker.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(m_run_mutex);
+    m_stop = true;
+  }
+  m_run_cv.notify_all();
+  m_worker.join();
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+TimestampCoherenceChecker::run(std::chrono::milliseconds period)
+{
+  std::unique_lock<std::mutex> lock(m_run_mutex);
+  while (!m_stop) {
+    lock.unlock();
+    for (auto& result : check()) {
+      if (!result.sampled)
+        ers::warning(EndpointTimestampNotSampled(ERS_HERE, result.name));
+      else if (!result.in_tolerance)
+        ers::warning(EndpointTimestampIncoherent(ERS_HERE, result.name, result.offset_ns, m_tolerance_ns));
+    }
+    lock.lock();
+    m_run_cv.wait_for(lock, period, [this]() { return m_stop; });
+  }
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+std::vector<TimestampCoherenceResult>
+TimestampCoherenceChecker::get_last_results() const
+{
+  std::lock_guard<std::mutex> lock(m_results_mutex);
+  return m_last_results;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+TimestampCoherenceChecker::get_info(timingfirmwareinfo::TimestampCoherenceMonitorData& mon_data) const
+{
+  std::lock_guard<std::mutex> lock(m_results_mutex);
+  mon_data.checks = m_number_of_checks;
+  mon_data.incoherent = m_number_of_incoherent;
+  mon_data.endpoints.clear();
+  for (auto& result : m_last_results) {
+    timingfirmwareinfo::TimestampCoherenceEndpoint endpoint;
+    endpoint.name = result.name;
+    endpoint.sampled = result.sampled;
+    endpoint.offset_ns = result.offset_ns;
+    endpoint.uncertainty_ns = result.uncertainty_ns;
+    endpoint.in_tolerance = result.in_tolerance;
+    mon_data.endpoints.push_back(endpoint);
+  }
+}
+//-----------------------------------------------------------------------------
+
+} // namespace timing
+} // namespace dunedaq
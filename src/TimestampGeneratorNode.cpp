@@ -8,10 +8,13 @@
 
 #include "timing/TimestampGeneratorNode.hpp"
 
+#include "timing/DeviceTransactionScheduler.hpp"
 #include "timing/toolbox.hpp"
 #include "logging/Logging.hpp"
 
+#include <algorithm>
 #include <string>
+#include <vector>
 
 namespace dunedaq {
 namespace timing {
@@ -69,6 +72,14 @@ TimestampGeneratorNode::read_timestamp() const
 }
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+TimestampSample
+TimestampGeneratorNode::sample_timestamp() const
+{
+  return sample_timestamps({ "ctr" }).at(0);
+}
+//-----------------------------------------------------------------------------
+
 //-----------------------------------------------------------------------------
 uint64_t // NOLINT(build/unsigned)
 TimestampGeneratorNode::read_start_timestamp() const
@@ -95,6 +106,8 @@ TimestampGeneratorNode::read_sw_init_timestamp() const
 void
 TimestampGeneratorNode::set_timestamp(TimestampSource source) const // NOLINT(build/unsigned)
 {
+  DeviceTransaction transaction(getClient(), kControlTransaction);
+
   // TODO put somewhere more accessible
   const uint clock_frequency_hz = 62500000;
 
@@ -131,6 +144,21 @@ TimestampGeneratorNode::set_timestamp(TimestampSource source) const // NOLINT(bu
   getNode("csr.ctrl.load").write(0x0);
   getClient().dispatch();
 
+  wait_for_timestamp_load();
+  const uint64_t start_ts = read_start_timestamp(); // NOLINT(build/unsigned)
+  TLOG() << "Timestamp initialised with: " << format_reg_value(start_ts) << ", " << format_timestamp(start_ts, clock_frequency_hz);
+
+  const uint64_t new_timestamp = read_timestamp(); // NOLINT(build/unsigned)
+  TLOG() << "Reading new timestamp: " << format_reg_value(new_timestamp) << ", " << format_timestamp(new_timestamp, clock_frequency_hz);
+
+  getClient().dispatch();
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+void
+TimestampGeneratorNode::wait_for_timestamp_load() const
+{
   auto start = std::chrono::high_resolution_clock::now();
   while (true) {
     auto ts_loaded = getNode("csr.stat.tstamp_loaded").read();
@@ -141,8 +169,6 @@ TimestampGeneratorNode::set_timestamp(TimestampSource source) const // NOLINT(bu
 
     if (ts_loaded.value() && !ts_error.value())
     {
-      const uint64_t start_ts = read_start_timestamp();
-      TLOG() << "Timestamp initialised with: " << format_reg_value(start_ts) << ", " << format_timestamp(start_ts, clock_frequency_hz);
       break;
     }
 
@@ -154,11 +180,82 @@ TimestampGeneratorNode::set_timestamp(TimestampSource source) const // NOLINT(bu
 
     std::this_thread::sleep_for(std::chrono::microseconds(10));
   }
+}
+//-----------------------------------------------------------------------------
 
-  const uint64_t new_timestamp = read_timestamp(); // NOLINT(build/unsigned)
-  TLOG() << "Reading new timestamp: " << format_reg_value(new_timestamp) << ", " << format_timestamp(new_timestamp, clock_frequency_hz);
+//-----------------------------------------------------------------------------
+TimestampSyncResult
+TimestampGeneratorNode::set_timestamp_compensated(uint32_t clock_frequency_hz,     // NOLINT(build/unsigned)
+                                                  uint32_t number_of_samples) const // NOLINT(build/unsigned)
+{
+  DeviceTransaction transaction(getClient(), kControlTransaction);
+
+  TimestampSyncResult result;
+  result.clock_frequency_hz = clock_frequency_hz;
 
+  getNode("csr.ctrl.rst").write(0x1);
+  getNode("csr.ctrl.tstamp_source_sel").write(kSoftware);
   getClient().dispatch();
+
+  // round trips of the same kind of write packet as the load below
+  std::vector<int64_t> round_trips;
+  for (uint32_t i = 0; i < std::max<uint32_t>(number_of_samples, 1); ++i) { // NOLINT(build/unsigned)
+    auto start = get_nanoseconds_since_epoch();
+    getNode("csr.tstamp_sw_init_l").write(0x0);
+    getNode("csr.tstamp_sw_init_h").write(0x0);
+    getClient().dispatch();
+    round_trips.push_back(get_nanoseconds_since_epoch() - start);
+  }
+  std::sort(round_trips.begin(), round_trips.end());
+  result.write_rtt_min_ns = round_trips.front();
+  result.write_rtt_median_ns = round_trips.at(round_trips.size() / 2);
+  result.write_rtt_max_ns = round_trips.back();
+
+  // the load takes effect when the request reaches the board, about half a round trip after the clock read
+  result.compensation_ns = result.write_rtt_median_ns / 2;
+
+  uint64_t now_timestamp = // NOLINT(build/unsigned)
+    nanoseconds_to_timestamp(get_nanoseconds_since_epoch() + result.compensation_ns, clock_frequency_hz);
+  getNode("csr.tstamp_sw_init_l").write(now_timestamp & 0xffffffff);
+  getNode("csr.tstamp_sw_init_h").write(now_timestamp >> 32);
+  getNode("csr.ctrl.rst").write(0x0);
+  getNode("csr.ctrl.load").write(0x1);
+  getNode("csr.ctrl.load").write(0x0);
+  getClient().dispatch();
+
+  wait_for_timestamp_load();
+  result.loaded_timestamp = read_start_timestamp();
+
+  result.residual_ns = measure_offset(clock_frequency_hz, 8, result.residual_uncertainty_ns);
+
+  TLOG() << "Timestamp initialised with: " << format_reg_value(result.loaded_timestamp) << ", "
+         << format_timestamp(result.loaded_timestamp, clock_frequency_hz) << ", write rtt median: "
+         << result.write_rtt_median_ns << " ns (min: " << result.write_rtt_min_ns << ", max: " << result.write_rtt_max_ns
+         << "), residual offset: " << result.residual_ns << " +/- " << result.residual_uncertainty_ns << " ns";
+
+  return result;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+int64_t
+TimestampGeneratorNode::measure_offset(uint32_t clock_frequency_hz, // NOLINT(build/unsigned)
+                                       uint32_t number_of_samples,  // NOLINT(build/unsigned)
+                                       int64_t& uncertainty_ns) const
+{
+  int64_t offset = 0;
+  int64_t best_width = -1;
+  for (uint32_t i = 0; i < std::max<uint32_t>(number_of_samples, 1); ++i) { // NOLINT(build/unsigned)
+    auto sample = sample_timestamp();
+
+    int64_t width = sample.realtime_after_ns - sample.realtime_before_ns;
+    if (best_width < 0 || width < best_width) {
+      best_width = width;
+      offset = timestamp_to_nanoseconds(sample.timestamp, clock_frequency_hz) - (sample.realtime_before_ns + width / 2);
+    }
+  }
+  uncertainty_ns = best_width / 2;
+  return offset;
 }
 //-----------------------------------------------------------------------------
 
@@ -8,8 +8,12 @@
 
 #include "timing/TimingNode.hpp"
 
+#include "timing/toolbox.hpp"
+
+#include <algorithm>
 #include <map>
 #include <string>
+#include <vector>
 
 namespace dunedaq {
 namespace timing {
@@ -55,5 +59,66 @@ TimingNode::reset_sub_nodes(const uhal::Node& node, uint32_t aValue, bool dispat
 }
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+std::vector<TimestampSample>
+TimingNode::sample_timestamps(const std::vector<std::string>& paths) const
+{
+  std::vector<const uhal::Node*> timestamp_nodes;
+  for (auto& path : paths)
+    timestamp_nodes.push_back(&getNode(path));
+  return sample_timestamps(timestamp_nodes);
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+std::vector<TimestampSample>
+TimingNode::sample_timestamps(const std::vector<const uhal::Node*>& timestamp_nodes)
+{
+  if (timestamp_nodes.empty())
+    return {};
+
+  struct PendingRead
+  {
+    bool split;
+    uhal::ValVector<uint32_t> block; // NOLINT(build/unsigned)
+    uhal::ValWord<uint32_t> low;     // NOLINT(build/unsigned)
+    uhal::ValWord<uint32_t> high;    // NOLINT(build/unsigned)
+  };
+
+  // queue everything first, so that only the dispatch falls inside the bracket
+  std::vector<PendingRead> reads;
+  for (auto node : timestamp_nodes) {
+    auto children = node->getNodes();
+    PendingRead read;
+    read.split = std::find(children.begin(), children.end(), "ts_l") != children.end() &&
+                 std::find(children.begin(), children.end(), "ts_h") != children.end();
+    if (read.split) {
+      read.low = node->getNode("ts_l").read();
+      read.high = node->getNode("ts_h").read();
+    } else {
+      read.block = node->readBlock(2);
+    }
+    reads.push_back(read);
+  }
+
+  TimestampSample bracket;
+  bracket.monotonic_before_ns = get_monotonic_nanoseconds();
+  bracket.realtime_before_ns = get_nanoseconds_since_epoch();
+  timestamp_nodes.front()->getClient().dispatch();
+  bracket.realtime_after_ns = get_nanoseconds_since_epoch();
+  bracket.monotonic_after_ns = get_monotonic_nanoseconds();
+  bracket.round_trip_ns = bracket.monotonic_after_ns - bracket.monotonic_before_ns;
+
+  std::vector<TimestampSample> samples;
+  for (auto& read : reads) {
+    TimestampSample sample = bracket;
+    sample.timestamp = read.split ? (static_cast<uint64_t>(read.high.value()) << 32) + read.low.value() // NOLINT(build/unsigned)
+                                  : tstamp2int(read.block);
+    samples.push_back(sample);
+  }
+  return samples;
+}
+//-----------------------------------------------------------------------------
+
 } // namespace timing
 } // namespace dunedaq
\ No newline at end of file
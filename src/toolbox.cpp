@@ -214,6 +214,47 @@ get_milliseconds_since_epoch()
 }
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+int64_t
+get_nanoseconds_since_epoch()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  return static_cast<int64_t>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+int64_t
+get_monotonic_nanoseconds()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<int64_t>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+uint64_t // NOLINT(build/unsigned)
+nanoseconds_to_timestamp(int64_t nanoseconds, uint32_t clock_frequency_hz) // NOLINT(build/unsigned)
+{
+  // split into seconds and nanoseconds, the product with the frequency would overflow otherwise
+  uint64_t seconds = nanoseconds / 1000000000LL;   // NOLINT(build/unsigned)
+  uint64_t remainder = nanoseconds % 1000000000LL; // NOLINT(build/unsigned)
+  return seconds * clock_frequency_hz + remainder * clock_frequency_hz / 1000000000ULL;
+}
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+int64_t
+timestamp_to_nanoseconds(uint64_t timestamp, uint32_t clock_frequency_hz) // NOLINT(build/unsigned)
+{
+  uint64_t seconds = timestamp / clock_frequency_hz;   // NOLINT(build/unsigned)
+  uint64_t remainder = timestamp % clock_frequency_hz; // NOLINT(build/unsigned)
+  return static_cast<int64_t>(seconds * 1000000000ULL + remainder * 1000000000ULL / clock_frequency_hz);
+}
+//-----------------------------------------------------------------------------
+
 //-----------------------------------------------------------------------------
 std::string
 format_timestamp(uint64_t raw_timestamp, uint32_t clock_frequency_hz) // NOLINT(build/unsigned)
@@ -0,0 +1,505 @@
+/**
+ * @file hsi_readout_benchmark.cxx
+ *
+ * Sweeps the HSI emulation-mode trigger rate and measures the readout
+ * performance of the available buffer readout strategies. Results are
+ * written as JSON so that they can be compared across firmware and
+ * software versions.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "timing/EndpointNode.hpp"
+#include "timing/FLCmdGeneratorNode.hpp"
+#include "timing/HSINode.hpp"
+#include "timing/IssueThrottle.hpp"
+#include "timing/toolbox.hpp"
+
+#include "uhal/ConnectionManager.hpp"
+#include "uhal/log/log.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace dunedaq;
+
+namespace {
+
+using steady_clock = std::chrono::steady_clock;
+
+struct Options
+{
+  std::string connections;
+  std::string device;
+  std::string uri;
+  std::string address_table;
+  std::string hsi_node = "endpoint0.hsi";
+  std::string endpoint_node = "endpoint0";
+  uint32_t clock_frequency_hz = 62500000; // NOLINT(build/unsigned)
+  std::vector<double> rates = { 1e2, 1e3, 1e4, 1e5, 1e6 };
+  std::vector<std::string> strategies = { "polling", "fused", "streaming" };
+  double duration_s = 5.;
+  uint32_t poll_interval_us = 0; // NOLINT(build/unsigned)
+  std::string output;
+};
+
+struct RunStats
+{
+  uint64_t events = 0;             // NOLINT(build/unsigned)
+  uint64_t words = 0;              // NOLINT(build/unsigned)
+  uint64_t dispatches = 0;         // NOLINT(build/unsigned)
+  uint64_t reads = 0;              // NOLINT(build/unsigned)
+  uint64_t empty_reads = 0;        // NOLINT(build/unsigned)
+  uint64_t buffer_warnings = 0;    // NOLINT(build/unsigned)
+  uint64_t buffer_errors = 0;      // NOLINT(build/unsigned)
+  uint32_t max_occupancy = 0;      // NOLINT(build/unsigned)
+  size_t max_queue_depth = 0;
+  std::vector<double> latencies_us;
+};
+
+/**
+ * @brief      Maps HSI event timestamps onto the host steady clock, using a
+ *             single reference sample of the endpoint timestamp.
+ */
+class EventClock
+{
+public:
+  EventClock(uint64_t reference_timestamp, steady_clock::time_point reference_time, uint32_t clock_frequency_hz) // NOLINT
+    : m_reference_timestamp(reference_timestamp)
+    , m_reference_time(reference_time)
+    , m_clock_frequency_hz(clock_frequency_hz)
+  {}
+
+  double latency_us(uint64_t event_timestamp, steady_clock::time_point read_time) const // NOLINT(build/unsigned)
+  {
+    double ticks = static_cast<double>(event_timestamp) - static_cast<double>(m_reference_timestamp);
+    double event_us = ticks * 1e6 / m_clock_frequency_hz;
+    double read_us = std::chrono::duration<double, std::micro>(read_time - m_reference_time).count();
+    return read_us - event_us;
+  }
+
+private:
+  uint64_t m_reference_timestamp;            // NOLINT(build/unsigned)
+  steady_clock::time_point m_reference_time;
+  uint32_t m_clock_frequency_hz;             // NOLINT(build/unsigned)
+};
+
+double
+cpu_time_us()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e6 + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+std::vector<std::string>
+split(const std::string& list)
+{
+  std::vector<std::string> items;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ','))
+    if (!item.empty())
+      items.push_back(item);
+  return items;
+}
+
+void
+print_usage(const char* name)
+{
+  std::cerr << "Usage: " << name << " (--connections <file> --device <id> | --uri <uri> --address-table <file>)\n" // NOLINT
+            << "  [--hsi-node <path>]          HSI node path (default endpoint0.hsi)\n"
+            << "  [--endpoint-node <path>]     endpoint node used for latency reference (default endpoint0, '' to disable)\n"
+            << "  [--clock-frequency <hz>]     DTS clock frequency (default 62500000)\n"
+            << "  [--rates <r1,r2,...>]        emulated trigger rates in Hz\n"
+            << "  [--strategies <s1,...>]      any of polling,fused,streaming\n"
+            << "  [--duration <s>]             time per rate point (default 5)\n"
+            << "  [--poll-interval <us>]       sleep after an empty read (default 0)\n"
+            << "  [--output <file>]            JSON output file (default stdout)\n"
+            << "A local IPbus stand-in can be targeted with e.g.\n"
+            << "  --uri ipbusudp-2.0://localhost:50010 --address-table file://<addrtab>/top.xml" << std::endl;
+}
+
+Options
+parse_options(int argc, char const* argv[])
+{
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "-h" || arg == "--help") {
+      print_usage(argv[0]);
+      exit(0);
+    }
+    if (i + 1 >= argc) {
+      print_usage(argv[0]);
+      exit(1);
+    }
+    std::string value = argv[++i];
+    if (arg == "--connections") {
+      options.connections = value;
+    } else if (arg == "--device") {
+      options.device = value;
+    } else if (arg == "--uri") {
+      options.uri = value;
+    } else if (arg == "--address-table") {
+      options.address_table = value;
+    } else if (arg == "--hsi-node") {
+      options.hsi_node = value;
+    } else if (arg == "--endpoint-node") {
+      options.endpoint_node = value;
+    } else if (arg == "--clock-frequency") {
+      options.clock_frequency_hz = std::stoul(value);
+    } else if (arg == "--rates") {
+      options.rates.clear();
+      for (auto& rate : split(value))
+        options.rates.push_back(std::stod(rate));
+    } else if (arg == "--strategies") {
+      options.strategies = split(value);
+    } else if (arg == "--duration") {
+      options.duration_s = std::stod(value);
+    } else if (arg == "--poll-interval") {
+      options.poll_interval_us = std::stoul(value);
+    } else if (arg == "--output") {
+      options.output = value;
+    } else {
+      print_usage(argv[0]);
+      exit(1);
+    }
+  }
+
+  if (options.connections.empty() == options.uri.empty() || (options.uri.empty() ? options.device.empty() : options.address_table.empty())) {
+    print_usage(argv[0]);
+    exit(1);
+  }
+  return options;
+}
+
+/**
+ * @brief      Account for a block of buffer words: count the complete events and their latency.
+ */
+void
+process_words(const std::vector<uint32_t>& data, // NOLINT(build/unsigned)
+              steady_clock::time_point read_time,
+              const EventClock* event_clock,
+              RunStats& stats)
+{
+  const size_t event_words = timing::HSINode::hsi_buffer_event_words_number;
+  stats.words += data.size();
+  for (size_t i = 0; i + event_words <= data.size(); i += event_words) {
+    ++stats.events;
+    if (event_clock) {
+      uint64_t timestamp = (static_cast<uint64_t>(data.at(i + 2)) << 32) | data.at(i + 1); // NOLINT(build/unsigned)
+      stats.latencies_us.push_back(event_clock->latency_us(timestamp, read_time));
+    }
+  }
+}
+
+void
+account_state(uint32_t buffer_state, RunStats& stats) // NOLINT(build/unsigned)
+{
+  if (buffer_state & 0x1)
+    ++stats.buffer_errors;
+  if (buffer_state & 0x2)
+    ++stats.buffer_warnings;
+  stats.max_occupancy = std::max(stats.max_occupancy, buffer_state >> 0x10);
+}
+
+void
+idle(const Options& options)
+{
+  if (options.poll_interval_us)
+    std::this_thread::sleep_for(std::chrono::microseconds(options.poll_interval_us));
+}
+
+/**
+ * @brief      Strategy 1: the read_data_buffer pattern, i.e. a state read followed by a data read.
+ *
+ * The two reads are issued here rather than through read_data_buffer, so
+ * that the buffer state is accounted for as in the other strategies.
+ */
+void
+run_polling(const timing::HSINode& hsi, const Options& options, const EventClock* event_clock, RunStats& stats)
+{
+  const uint32_t event_words = timing::HSINode::hsi_buffer_event_words_number; // NOLINT(build/unsigned)
+  auto deadline = steady_clock::now() + std::chrono::duration<double>(options.duration_s);
+  while (steady_clock::now() < deadline) {
+    uint32_t buffer_state = hsi.read_buffer_state(); // NOLINT(build/unsigned)
+    account_state(buffer_state, stats);
+    ++stats.dispatches;
+    ++stats.reads;
+
+    uint32_t words_to_read = std::min<uint32_t>(buffer_state >> 0x10, 1024); // NOLINT(build/unsigned)
+    words_to_read = (words_to_read / event_words) * event_words;
+    if (!words_to_read) {
+      ++stats.empty_reads;
+      idle(options);
+      continue;
+    }
+
+    auto data = hsi.getNode("buf.data").readBlock(words_to_read);
+    hsi.getClient().dispatch();
+    auto read_time = steady_clock::now();
+    ++stats.dispatches;
+    process_words(data.value(), read_time, event_clock, stats);
+  }
+}
+
+/**
+ * @brief      Strategy 2: read_data_buffer_fused, one dispatch per iteration.
+ */
+void
+run_fused(const timing::HSINode& hsi, const Options& options, const EventClock* event_clock, RunStats& stats)
+{
+  const uint32_t event_words = timing::HSINode::hsi_buffer_event_words_number; // NOLINT(build/unsigned)
+  uint32_t buffer_state = 0;                                                     // NOLINT(build/unsigned)
+  auto deadline = steady_clock::now() + std::chrono::duration<double>(options.duration_s);
+  while (steady_clock::now() < deadline) {
+    uint32_t words_to_read = ((buffer_state >> 0x10) / event_words) * event_words; // NOLINT(build/unsigned)
+    auto data = hsi.read_data_buffer_fused(words_to_read, buffer_state);
+    auto read_time = steady_clock::now();
+    account_state(buffer_state, stats);
+    ++stats.dispatches;
+    ++stats.reads;
+    if (data.size() == 0) {
+      ++stats.empty_reads;
+      if ((buffer_state >> 0x10) < event_words)
+        idle(options);
+      continue;
+    }
+    process_words(data.value(), read_time, event_clock, stats);
+  }
+}
+
+/**
+ * @brief      Strategy 3: a reader thread doing fused reads and handing the blocks to a consumer thread.
+ */
+void
+run_streaming(const timing::HSINode& hsi, const Options& options, const EventClock* event_clock, RunStats& stats)
+{
+  typedef std::pair<std::vector<uint32_t>, steady_clock::time_point> Block; // NOLINT(build/unsigned)
+
+  std::mutex queue_mutex;
+  std::condition_variable queue_cv;
+  std::deque<Block> queue;
+  std::atomic<bool> reading(true);
+
+  std::thread consumer([&]() {
+    while (true) {
+      std::unique_lock<std::mutex> lock(queue_mutex);
+      queue_cv.wait(lock, [&]() { return !queue.empty() || !reading; });
+      if (queue.empty())
+        break;
+      Block block = std::move(queue.front());
+      queue.pop_front();
+      lock.unlock();
+      process_words(block.first, block.second, event_clock, stats);
+    }
+  });
+
+  const uint32_t event_words = timing::HSINode::hsi_buffer_event_words_number; // NOLINT(build/unsigned)
+  uint32_t buffer_state = 0;                                                     // NOLINT(build/unsigned)
+  auto deadline = steady_clock::now() + std::chrono::duration<double>(options.duration_s);
+  while (steady_clock::now() < deadline) {
+    uint32_t words_to_read = ((buffer_state >> 0x10) / event_words) * event_words; // NOLINT(build/unsigned)
+    auto data = hsi.read_data_buffer_fused(words_to_read, buffer_state);
+    auto read_time = steady_clock::now();
+    account_state(buffer_state, stats);
+    ++stats.dispatches;
+    ++stats.reads;
+    if (data.size() == 0) {
+      ++stats.empty_reads;
+      if ((buffer_state >> 0x10) < event_words)
+        idle(options);
+      continue;
+    }
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex);
+      queue.emplace_back(data.value(), read_time);
+      stats.max_queue_depth = std::max(stats.max_queue_depth, queue.size());
+    }
+    queue_cv.notify_one();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    reading = false;
+  }
+  queue_cv.notify_one();
+  consumer.join();
+}
+
+double
+percentile(std::vector<double>& values, double fraction)
+{
+  if (values.empty())
+    return 0.;
+  size_t index = std::min(values.size() - 1, static_cast<size_t>(fraction * values.size()));
+  std::nth_element(values.begin(), values.begin() + index, values.end());
+  return values.at(index);
+}
+
+nlohmann::json
+run_point(const timing::HSINode& hsi,
+          const timing::EndpointNode* endpoint,
+          const Options& options,
+          const std::string& strategy,
+          double rate)
+{
+  nlohmann::json point;
+  point["strategy"] = strategy;
+  point["requested_rate_hz"] = rate;
+
+  double actual_rate;
+  uint32_t divisor;  // NOLINT(build/unsigned)
+  uint32_t prescale; // NOLINT(build/unsigned)
+  try {
+    timing::FLCmdGeneratorNode::parse_periodic_fl_cmd_rate(rate, options.clock_frequency_hz, actual_rate, divisor, prescale);
+  } catch (const timing::BadRequestedFakeTriggerRate& e) {
+    point["error"] = e.what();
+    return point;
+  }
+  point["actual_rate_hz"] = actual_rate;
+  point["rate_div_d"] = divisor;
+  point["rate_div_p"] = prescale;
+
+  hsi.reset_hsi();
+  hsi.configure_hsi(0x1, 0x1, 0x0, 0x0, rate, options.clock_frequency_hz);
+
+  std::unique_ptr<EventClock> event_clock;
+  if (endpoint) {
+    uint64_t reference_timestamp = endpoint->read_timestamp(); // NOLINT(build/unsigned)
+    event_clock.reset(new EventClock(reference_timestamp, steady_clock::now(), options.clock_frequency_hz));
+  }
+
+  RunStats stats;
+  hsi.start_hsi();
+
+  double cpu_start = cpu_time_us();
+  auto start = steady_clock::now();
+
+  if (strategy == "polling") {
+    run_polling(hsi, options, event_clock.get(), stats);
+  } else if (strategy == "fused") {
+    run_fused(hsi, options, event_clock.get(), stats);
+  } else {
+    run_streaming(hsi, options, event_clock.get(), stats);
+  }
+  // the buffer issues repeated at the end of the run are summarised before the results
+  timing::IssueThrottle::get().flush();
+
+  double elapsed_s = std::chrono::duration<double>(steady_clock::now() - start).count();
+  double cpu_us = cpu_time_us() - cpu_start;
+
+  hsi.stop_hsi();
+
+  point["duration_s"] = elapsed_s;
+  point["events"] = stats.events;
+  point["words"] = stats.words;
+  point["reads"] = stats.reads;
+  point["empty_reads"] = stats.empty_reads;
+  point["dispatches"] = stats.dispatches;
+  point["event_rate_hz"] = stats.events / elapsed_s;
+  point["dispatches_per_event"] = stats.events ? static_cast<double>(stats.dispatches) / stats.events : 0.;
+  point["cpu_us_per_event"] = stats.events ? cpu_us / stats.events : 0.;
+  point["cpu_utilisation"] = cpu_us / (elapsed_s * 1e6);
+  point["buffer_warnings"] = stats.buffer_warnings;
+  point["buffer_errors"] = stats.buffer_errors;
+  point["max_occupancy_words"] = stats.max_occupancy;
+  point["overflow"] = stats.buffer_errors > 0 || stats.max_occupancy > 1024;
+  if (strategy == "streaming")
+    point["max_queue_depth"] = stats.max_queue_depth;
+
+  if (!stats.latencies_us.empty()) {
+    nlohmann::json latency;
+    latency["p50_us"] = percentile(stats.latencies_us, 0.5);
+    latency["p90_us"] = percentile(stats.latencies_us, 0.9);
+    latency["p99_us"] = percentile(stats.latencies_us, 0.99);
+    latency["max_us"] = *std::max_element(stats.latencies_us.begin(), stats.latencies_us.end());
+    point["latency"] = latency;
+  }
+  return point;
+}
+
+} // namespace
+
+// ----------------------------------------------------------
+int
+main(int argc, char const* argv[])
+{
+  Options options = parse_options(argc, argv);
+
+  uhal::setLogLevelTo(uhal::WarningLevel());
+
+  std::unique_ptr<uhal::HwInterface> hw;
+  if (options.uri.empty()) {
+    uhal::ConnectionManager cm(options.connections);
+    hw.reset(new uhal::HwInterface(cm.getDevice(options.device)));
+  } else {
+    hw.reset(new uhal::HwInterface(uhal::ConnectionManager::getDevice("hsi_benchmark", options.uri, options.address_table)));
+  }
+
+  const timing::HSINode& hsi = hw->getNode<timing::HSINode>(options.hsi_node);
+
+  const timing::EndpointNode* endpoint = nullptr;
+  if (!options.endpoint_node.empty()) {
+    try {
+      endpoint = &hw->getNode<timing::EndpointNode>(options.endpoint_node);
+    } catch (const std::exception& e) {
+      std::cerr << "Endpoint node " << options.endpoint_node << " not available, latency disabled: " << e.what() << std::endl; // NOLINT
+    }
+  }
+
+  nlohmann::json report;
+  report["device"] = hw->id();
+  report["uri"] = hw->uri();
+  report["clock_frequency_hz"] = options.clock_frequency_hz;
+  report["duration_per_point_s"] = options.duration_s;
+  report["poll_interval_us"] = options.poll_interval_us;
+  report["points"] = nlohmann::json::array();
+
+  nlohmann::json overflow_onset = nlohmann::json::object();
+
+  for (auto& strategy : options.strategies) {
+    if (strategy != "polling" && strategy != "fused" && strategy != "streaming") {
+      std::cerr << "Unknown strategy " << strategy << std::endl; // NOLINT
+      return 1;
+    }
+
+    overflow_onset[strategy] = nullptr;
+    for (auto rate : options.rates) {
+      std::cerr << "Running " << strategy << " @ " << rate << " Hz" << std::endl; // NOLINT
+      auto point = run_point(hsi, endpoint, options, strategy, rate);
+      if (overflow_onset[strategy].is_null() && point.value("overflow", false))
+        overflow_onset[strategy] = point["actual_rate_hz"];
+      report["points"].push_back(point);
+    }
+  }
+  report["overflow_onset_hz"] = overflow_onset;
+
+  if (options.output.empty()) {
+    std::cout << report.dump(2) << std::endl; // NOLINT
+  } else {
+    std::ofstream out(options.output);
+    out << report.dump(2) << std::endl;
+  }
+  return 0;
+}
@@ -1,21 +1,73 @@
 /**
  * @file pdtguardian.cxx
  *
+ * Watches the timing boards of a connections file with a FleetGuardian,
+ * reporting faults and recovering them, optionally as a daemon.
+ *
  * This is part of the DUNE DAQ Software Suite, copyright 2020.
  * Licensing/copyright details are in the COPYING file that you should have
  * received with this code.
  */
 
+#include "timing/FleetGuardian.hpp"
+#include "timing/TopDesignInterface.hpp"
+
+#include "uhal/ConnectionManager.hpp"
+#include "uhal/log/log.hpp"
+
 #include <fcntl.h>
 #include <iostream>
+#include <limits.h>
+#include <memory>
+#include <regex>
 #include <signal.h>
+#include <sstream>
 #include <stdexcept>
+#include <stdlib.h>
 #include <string.h>
 #include <string>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <syslog.h>
 #include <unistd.h>
+#include <vector>
+
+using namespace dunedaq;
+
+namespace {
+
+timing::FleetGuardian* g_guardian = nullptr;
+
+void
+handle_signal(int)
+{
+  if (g_guardian)
+    g_guardian->stop();
+}
+
+// daemonize changes the working directory, and the address tables are only loaded when the devices are
+// created, relative to the connections file; creating the devices before forking is not an option, as
+// the uhal clients may have started threads, which would not survive the fork
+std::string
+canonicalise_connections(const std::string& connections)
+{
+  const std::string file_prefix = "file://";
+  std::stringstream canonical;
+  std::stringstream files(connections);
+  std::string file;
+  while (std::getline(files, file, ';')) {
+    bool has_prefix = file.compare(0, file_prefix.size(), file_prefix) == 0;
+    std::string path = has_prefix ? file.substr(file_prefix.size()) : file;
+    char resolved[PATH_MAX];
+    // anything realpath cannot resolve, e.g. a glob, is left for uhal to report
+    if (realpath(path.c_str(), resolved))
+      path = resolved;
+    canonical << (canonical.tellp() ? ";" : "") << (has_prefix ? file_prefix : "") << path;
+  }
+  return canonical.str();
+}
+
+} // namespace
 
 int
 createFile(const std::string& filename, bool truncate)
@@ -163,22 +215,145 @@ daemonize(const std::string& out, const std::string& err)
 #endif
 }
 
-/**
- * @brief      { function_description }
- *
- * @param[in]  argc  The argc
- * @param      argv  The argv
- *
- * @return     { description_of_the_return_value }
- */
+struct Options
+{
+  std::string connections;
+  std::string devices = ".*";
+  uint32_t fast_period_ms = 1000;     // NOLINT(build/unsigned)
+  uint32_t slow_period_ms = 10000;    // NOLINT(build/unsigned)
+  uint32_t debounce = 3;              // NOLINT(build/unsigned)
+  uint32_t report_interval_s = 60;    // NOLINT(build/unsigned)
+  uint32_t max_backoff_ms = 60000;    // NOLINT(build/unsigned)
+  uint32_t recovery_holdoff_s = 30;   // NOLINT(build/unsigned)
+  uint32_t max_recovery_attempts = 3; // NOLINT(build/unsigned)
+  uint32_t pll_los_mask = 0x0;        // NOLINT(build/unsigned)
+  bool watch_upstream = false;
+  bool recover = true;
+  bool daemon = false;
+};
+
+void
+print_usage(const char* name)
+{
+  std::cerr << "Usage: " << name << " --connections <file>\n" // NOLINT
+            << "  [--devices <regex>]          devices of the connections file to guard (default: all)\n"
+            << "  [--fast-period <ms>]         period of the register polls (default 1000)\n"
+            << "  [--slow-period <ms>]         period of the PLL polls (default 10000)\n"
+            << "  [--debounce <polls>]         polls needed to raise or clear a condition (default 3)\n"
+            << "  [--report-interval <s>]      minimum interval between reports of a condition (default 60)\n"
+            << "  [--max-backoff <ms>]         longest interval between polls of an unreachable board (default 60000)\n"
+            << "  [--recovery-holdoff <s>]     minimum interval between recoveries of a condition (default 30)\n"
+            << "  [--max-recoveries <n>]       recoveries of a condition before giving up (default 3)\n"
+            << "  [--pll-los-mask <mask>]      PLL inputs whose loss of signal is a fault (default none)\n"
+            << "  [--watch-upstream]           watch the upstream endpoint of masters\n"
+            << "  [--no-recovery]              only report faults\n"
+            << "  [--daemon]                   run in the background, logging to pdt.out and pdt.err" << std::endl;
+}
+
+Options
+parse_options(int argc, char const* argv[])
+{
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "-h" || arg == "--help") {
+      print_usage(argv[0]);
+      exit(0);
+    } else if (arg == "--watch-upstream") {
+      options.watch_upstream = true;
+      continue;
+    } else if (arg == "--no-recovery") {
+      options.recover = false;
+      continue;
+    } else if (arg == "--daemon") {
+      options.daemon = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      print_usage(argv[0]);
+      exit(1);
+    }
+    std::string value = argv[++i];
+    if (arg == "--connections") {
+      options.connections = value;
+    } else if (arg == "--devices") {
+      options.devices = value;
+    } else if (arg == "--fast-period") {
+      options.fast_period_ms = std::stoul(value);
+    } else if (arg == "--slow-period") {
+      options.slow_period_ms = std::stoul(value);
+    } else if (arg == "--debounce") {
+      options.debounce = std::stoul(value);
+    } else if (arg == "--report-interval") {
+      options.report_interval_s = std::stoul(value);
+    } else if (arg == "--max-backoff") {
+      options.max_backoff_ms = std::stoul(value);
+    } else if (arg == "--recovery-holdoff") {
+      options.recovery_holdoff_s = std::stoul(value);
+    } else if (arg == "--max-recoveries") {
+      options.max_recovery_attempts = std::stoul(value);
+    } else if (arg == "--pll-los-mask") {
+      options.pll_los_mask = std::stoul(value, nullptr, 0);
+    } else {
+      print_usage(argv[0]);
+      exit(1);
+    }
+  }
+
+  if (options.connections.empty()) {
+    print_usage(argv[0]);
+    exit(1);
+  }
+  return options;
+}
+
 int
 main(int argc, char const* argv[])
 {
+  Options options = parse_options(argc, argv);
+
   std::cout << "PDT Guardian" << std::endl; // NOLINT
 
-  daemonize("pdt.out", "pdt.err");
+  // the connections file is read before daemonizing, which changes the working directory
+  uhal::ConnectionManager cm(canonicalise_connections(options.connections));
+  std::regex device_pattern(options.devices);
+
+  if (options.daemon)
+    daemonize("pdt.out", "pdt.err");
+
+  uhal::setLogLevelTo(uhal::WarningLevel());
+
+  timing::FleetGuardian guardian;
+  guardian.set_fast_period(std::chrono::milliseconds(options.fast_period_ms));
+  guardian.set_slow_period(std::chrono::milliseconds(options.slow_period_ms));
+  guardian.set_debounce(options.debounce);
+  guardian.set_report_interval(std::chrono::seconds(options.report_interval_s));
+  guardian.set_max_unreachable_backoff(std::chrono::milliseconds(options.max_backoff_ms));
+  guardian.set_recovery_holdoff(std::chrono::seconds(options.recovery_holdoff_s));
+  guardian.set_max_recovery_attempts(options.max_recovery_attempts);
+  guardian.set_pll_los_mask(options.pll_los_mask);
+  guardian.set_watched(timing::kUpstreamEndpointNotReady, options.watch_upstream);
+  if (!options.recover) {
+    guardian.set_recovery(timing::kEndpointNotReady, timing::kNoRecovery);
+    guardian.set_recovery(timing::kUpstreamEndpointNotReady, timing::kNoRecovery);
+  }
+
+  // the guardian keeps references to the designs, so the devices live until it returns
+  std::vector<std::unique_ptr<uhal::HwInterface>> devices;
+  for (auto& device : cm.getDevices()) {
+    if (!std::regex_match(device, device_pattern))
+      continue;
+    devices.emplace_back(new uhal::HwInterface(cm.getDevice(device)));
+    guardian.add_board(device, devices.back()->getNode<timing::TopDesignInterface>(""));
+  }
+  std::cout << "Guarding " << devices.size() << " devices" << std::endl; // NOLINT
+
+  g_guardian = &guardian;
+  signal(SIGINT, handle_signal);
+  signal(SIGTERM, handle_signal);
 
-  std::cout << "Test stdout" << std::endl; // NOLINT
-  std::cerr << "Test stderr" << std::endl; // NOLINT
+  guardian.run();
+
+  g_guardian = nullptr;
   return 0;
-}
\ No newline at end of file
+}
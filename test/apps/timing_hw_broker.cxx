@@ -0,0 +1,126 @@
+/**
+ * @file timing_hw_broker.cxx
+ *
+ * Owns the IPbus connection to one timing device and serves logical
+ * operations to local processes through a HardwareBroker, so that they
+ * no longer interleave their bus and I2C traffic.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "timing/HardwareBroker.hpp"
+
+#include "uhal/ConnectionManager.hpp"
+#include "uhal/log/log.hpp"
+
+#include <signal.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+using namespace dunedaq;
+
+namespace {
+
+volatile sig_atomic_t g_stop = 0;
+
+void
+handle_signal(int)
+{
+  g_stop = 1;
+}
+
+struct Options
+{
+  std::string connections;
+  std::string device;
+  std::string uri;
+  std::string address_table;
+  std::string socket_path;
+};
+
+void
+print_usage(const char* name)
+{
+  std::cerr << "Usage: " << name << " (--connections <file> --device <id> | --uri <uri> --address-table <file>)\n" // NOLINT
+            << "  [--socket <path>]            socket to serve (default: /tmp/timing_broker.<device id>.sock)"
+            << std::endl;
+}
+
+Options
+parse_options(int argc, char const* argv[])
+{
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "-h" || arg == "--help") {
+      print_usage(argv[0]);
+      exit(0);
+    }
+    if (i + 1 >= argc) {
+      print_usage(argv[0]);
+      exit(1);
+    }
+    std::string value = argv[++i];
+    if (arg == "--connections") {
+      options.connections = value;
+    } else if (arg == "--device") {
+      options.device = value;
+    } else if (arg == "--uri") {
+      options.uri = value;
+    } else if (arg == "--address-table") {
+      options.address_table = value;
+    } else if (arg == "--socket") {
+      options.socket_path = value;
+    } else {
+      print_usage(argv[0]);
+      exit(1);
+    }
+  }
+
+  if (options.connections.empty() == options.uri.empty() || (options.uri.empty() ? options.device.empty() : options.address_table.empty())) {
+    print_usage(argv[0]);
+    exit(1);
+  }
+  return options;
+}
+
+} // namespace
+
+int
+main(int argc, char const* argv[])
+{
+  Options options = parse_options(argc, argv);
+
+  uhal::setLogLevelTo(uhal::WarningLevel());
+
+  std::unique_ptr<uhal::HwInterface> hw;
+  if (options.uri.empty()) {
+    uhal::ConnectionManager cm(options.connections);
+    hw.reset(new uhal::HwInterface(cm.getDevice(options.device)));
+  } else {
+    hw.reset(new uhal::HwInterface(uhal::ConnectionManager::getDevice("timing_broker", options.uri, options.address_table)));
+  }
+  if (options.socket_path.empty())
+    options.socket_path = timing::get_hardware_broker_path(hw->id());
+
+  timing::HardwareBroker broker(*hw, options.socket_path);
+
+  signal(SIGINT, handle_signal);
+  signal(SIGTERM, handle_signal);
+
+  broker.start();
+  std::cerr << "Serving " << hw->id() << " on " << broker.get_socket_path() << std::endl; // NOLINT
+
+  while (!g_stop)
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  broker.stop();
+  return 0;
+}
@@ -0,0 +1,214 @@
+/**
+ * @file timing_status_publisher.cxx
+ *
+ * Monitors one timing device with a MonitoringScheduler and publishes
+ * its snapshots into a shared memory status cache, so that any number
+ * of read-only consumers can follow the device without bus traffic.
+ * Optionally, the device information is also streamed as change-driven
+ * OpMonDeltaEncoder messages, one json document per line.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "timing/MonitoringScheduler.hpp"
+#include "timing/OpMonDeltaEncoder.hpp"
+#include "timing/StatusCache.hpp"
+#include "timing/TopDesignInterface.hpp"
+
+#include "uhal/ConnectionManager.hpp"
+#include "uhal/log/log.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <signal.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+using namespace dunedaq;
+
+namespace {
+
+volatile sig_atomic_t g_stop = 0;
+
+void
+handle_signal(int)
+{
+  g_stop = 1;
+}
+
+struct Options
+{
+  std::string connections;
+  std::string device;
+  std::string uri;
+  std::string address_table;
+  std::string name;
+  uint32_t fast_period_ms = 1000;    // NOLINT(build/unsigned)
+  uint32_t slow_period_ms = 10000;   // NOLINT(build/unsigned)
+  uint32_t publish_period_ms = 1000; // NOLINT(build/unsigned)
+  size_t capacity = 1 << 20;
+  std::string opmon_output;
+  uint32_t keyframe_interval = 60; // NOLINT(build/unsigned)
+};
+
+void
+print_usage(const char* name)
+{
+  std::cerr << "Usage: " << name << " (--connections <file> --device <id> | --uri <uri> --address-table <file>)\n" // NOLINT
+            << "  [--name <name>]              status cache name (default: the device id)\n"
+            << "  [--fast-period <ms>]         period of the register reads (default 1000)\n"
+            << "  [--slow-period <ms>]         period of the I2C reads (default 10000)\n"
+            << "  [--publish-period <ms>]      period of the snapshots (default 1000)\n"
+            << "  [--capacity <bytes>]         size of the snapshot area (default 1048576)\n"
+            << "  [--opmon-output <file>]      append change-driven monitoring messages, - for stdout\n"
+            << "  [--keyframe-interval <n>]    messages between full keyframes (default 60)" << std::endl;
+}
+
+Options
+parse_options(int argc, char const* argv[])
+{
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "-h" || arg == "--help") {
+      print_usage(argv[0]);
+      exit(0);
+    }
+    if (i + 1 >= argc) {
+      print_usage(argv[0]);
+      exit(1);
+    }
+    std::string value = argv[++i];
+    if (arg == "--connections") {
+      options.connections = value;
+    } else if (arg == "--device") {
+      options.device = value;
+    } else if (arg == "--uri") {
+      options.uri = value;
+    } else if (arg == "--address-table") {
+      options.address_table = value;
+    } else if (arg == "--name") {
+      options.name = value;
+    } else if (arg == "--fast-period") {
+      options.fast_period_ms = std::stoul(value);
+    } else if (arg == "--slow-period") {
+      options.slow_period_ms = std::stoul(value);
+    } else if (arg == "--publish-period") {
+      options.publish_period_ms = std::stoul(value);
+    } else if (arg == "--capacity") {
+      options.capacity = std::stoul(value);
+    } else if (arg == "--opmon-output") {
+      options.opmon_output = value;
+    } else if (arg == "--keyframe-interval") {
+      options.keyframe_interval = std::stoul(value);
+    } else {
+      print_usage(argv[0]);
+      exit(1);
+    }
+  }
+
+  if (options.connections.empty() == options.uri.empty() || (options.uri.empty() ? options.device.empty() : options.address_table.empty())) {
+    print_usage(argv[0]);
+    exit(1);
+  }
+  return options;
+}
+
+} // namespace
+
+int
+main(int argc, char const* argv[])
+{
+  Options options = parse_options(argc, argv);
+
+  uhal::setLogLevelTo(uhal::WarningLevel());
+
+  std::unique_ptr<uhal::HwInterface> hw;
+  if (options.uri.empty()) {
+    uhal::ConnectionManager cm(options.connections);
+    hw.reset(new uhal::HwInterface(cm.getDevice(options.device)));
+  } else {
+    hw.reset(new uhal::HwInterface(uhal::ConnectionManager::getDevice("timing_status", options.uri, options.address_table)));
+  }
+  if (options.name.empty())
+    options.name = hw->id();
+
+  const timing::TopDesignInterface& design = hw->getNode<timing::TopDesignInterface>("");
+
+  timing::MonitoringScheduler scheduler;
+  scheduler.set_period(timing::kFastMonitoring, std::chrono::milliseconds(options.fast_period_ms));
+  scheduler.set_period(timing::kSlowMonitoring, std::chrono::milliseconds(options.slow_period_ms));
+  scheduler.set_transaction_scheduler(&timing::DeviceTransactionScheduler::get(hw->getClient()));
+  design.register_monitoring(scheduler);
+
+  timing::StatusCacheWriter cache(options.name, options.capacity);
+  std::cerr << "Publishing " << hw->id() << " to " << cache.get_name() << std::endl; // NOLINT
+
+  // only the fields which changed go to the opmon stream, counters as deltas, with a full keyframe now and then
+  timing::OpMonDeltaEncoder encoder(options.keyframe_interval, timing::OpMonDeltaEncoder::get_device_info_counters());
+  std::ofstream opmon_file;
+  std::ostream* opmon_stream = nullptr;
+  if (options.opmon_output == "-") {
+    opmon_stream = &std::cout;
+  } else if (!options.opmon_output.empty()) {
+    opmon_file.open(options.opmon_output, std::ios::app);
+    if (!opmon_file) {
+      std::cerr << "Failed to open " << options.opmon_output << std::endl; // NOLINT
+      return 1;
+    }
+    opmon_stream = &opmon_file;
+  }
+
+  signal(SIGINT, handle_signal);
+  signal(SIGTERM, handle_signal);
+
+  scheduler.start();
+  auto next = std::chrono::steady_clock::now();
+  while (!g_stop) {
+    next += std::chrono::milliseconds(options.publish_period_ms);
+
+    timing::timingfirmwareinfo::MonitoringSchedulerMonitorData scheduler_data;
+    scheduler.get_info(scheduler_data);
+
+    auto info = scheduler.get_info();
+
+    if (opmon_stream) {
+      auto message = encoder.encode_info(info);
+      if (!message.is_null()) {
+        message["device"] = hw->id();
+        *opmon_stream << message.dump() << std::endl;
+      }
+    }
+
+    nlohmann::json snapshot;
+    snapshot["device"] = hw->id();
+    snapshot["info"] = info;
+    snapshot["scheduler"] = scheduler_data;
+    if (opmon_stream) {
+      timing::timingfirmwareinfo::OpMonDeltaEncoderMonitorData encoder_data;
+      encoder.get_info(encoder_data);
+      snapshot["opmon_encoder"] = encoder_data;
+    }
+    try {
+      cache.publish(snapshot);
+    } catch (const std::exception& e) {
+      std::cerr << "Failed to publish: " << e.what() << std::endl; // NOLINT
+    }
+
+    // sleep in short steps, so that signals are handled promptly
+    while (!g_stop && std::chrono::steady_clock::now() < next)
+      std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(next - std::chrono::steady_clock::now(),
+                                                                                std::chrono::milliseconds(100)));
+  }
+  scheduler.stop();
+  return 0;
+}